@@ -5,7 +5,7 @@ import QtQuick.Layouts
 ZBorderlessWindow {
     id: root
     width: 300
-    height: 400
+    height: 440
     backgroundColor: "#606060"
     minimumWidth: width
     minimumHeight: height
@@ -77,6 +77,43 @@ ZBorderlessWindow {
             verticalAlignment: Text.AlignVCenter
             Layout.alignment: Qt.AlignHCenter | Qt.AlignVCenter
         }
+        //thumbnail cache statistics
+        Text {
+            id: cacheStats
+            property var cache: root.backend ? root.backend.thumbCache : null
+            font.family: "Roboto"
+            Layout.preferredHeight: 40
+            Layout.preferredWidth: 260
+            color: "#dedede"
+            font.pointSize: 10 * FontScale * FontScale
+            font.weight: 200
+            text: cache
+                  ? "Cache: " + (cache.totalBytes / 1048576).toFixed(1) + " / "
+                    + (cache.quotaBytes / 1048576).toFixed(0) + " MB, " + cache.entryCount + " entries\n"
+                    + "Hit rate " + (cache.hitRate * 100).toFixed(0) + "%, " + cache.evictions + " evictions"
+                  : ""
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+            Layout.alignment: Qt.AlignHCenter | Qt.AlignVCenter
+        }
+        //metadata compression statistics, only when enabled
+        Text {
+            property var packer: root.backend ? root.backend.metadataCompression : null
+            visible: packer ? packer.enabled : false
+            font.family: "Roboto"
+            Layout.preferredHeight: 20
+            Layout.preferredWidth: 260
+            color: "#dedede"
+            font.pointSize: 10 * FontScale * FontScale
+            font.weight: 200
+            text: packer
+                  ? "Metadata: " + packer.ratio.toFixed(1) + "x compressed, decode "
+                    + packer.averageDecodeMs.toFixed(2) + " ms"
+                  : ""
+            horizontalAlignment: Text.AlignHCenter
+            verticalAlignment: Text.AlignVCenter
+            Layout.alignment: Qt.AlignHCenter | Qt.AlignVCenter
+        }
         ZButtonIcon {
             id: clearAndQuit
             defaultColor: "#6a6a6a"
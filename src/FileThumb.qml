@@ -17,6 +17,7 @@ Rectangle {
         
     signal thumbClicked() //Signal to notify when the thumbnail is clicked
     signal revealFile() //Signal to reveal current file in its location
+    signal removeFile() //Signal to remove current file from the list
 
     //Content Properties
     default property alias content: contentItem.data //the second child is the content area
@@ -24,6 +25,7 @@ Rectangle {
     property string nameLabel: "" // Primary text, default blank
     property string typeLabel: "" //secondary text
     property url imageUrl: "" //QUrl for image
+    property url previewUrl: "" //QUrl for placeholder preview
 
     //State Properties
     property bool hovered: false
@@ -36,16 +38,33 @@ Rectangle {
             Layout.fillWidth: true
             Layout.fillHeight: true
             color: "transparent"
-            Image {
-                id: sourceImage
-                source: root.imageUrl
+            Item {
+                id: tileImage
                 anchors.fill: parent
-                fillMode: Image.PreserveAspectCrop
                 visible: false //let mask render
+                //tiny blurred preview, painted on first frame until thumbnail is decoded
+                Image {
+                    id: placeholderImage
+                    anchors.fill: parent
+                    source: root.previewUrl
+                    fillMode: Image.Stretch
+                    smooth: true
+                    visible: sourceImage.status !== Image.Ready
+                }
+                Image {
+                    id: sourceImage
+                    source: root.imageUrl
+                    anchors.fill: parent
+                    fillMode: Image.PreserveAspectCrop
+                    asynchronous: true //decode off GUI thread, placeholder shows meanwhile
+                    //request the thumbnail level nearest to display size in device pixels
+                    sourceSize.width: Math.ceil(width * Screen.devicePixelRatio)
+                    sourceSize.height: Math.ceil(height * Screen.devicePixelRatio)
+                }
             }
             Rectangle {
                 id: maskShape
-                anchors.fill: sourceImage
+                anchors.fill: tileImage
                 radius: root.radius + 1 //hardcoded: +1 to fix rendering glitch
                 color: "white"
                 visible: false
@@ -53,8 +72,8 @@ Rectangle {
             }
 
             MultiEffect {
-                anchors.fill: sourceImage
-                source: sourceImage
+                anchors.fill: tileImage
+                source: tileImage
                 maskEnabled: true
                 maskSource: maskShape
             }
@@ -159,7 +178,7 @@ Rectangle {
         //copy menu
         Menu {
             id: fileMenu
-            implicitHeight: 40
+            implicitHeight: 80
             implicitWidth: 150
             background: Rectangle {
                 radius: 4
@@ -201,6 +220,41 @@ Rectangle {
                     }
                 }
             }
+
+            MenuItem {
+                id: removeItem
+                onTriggered: {
+                    menuLoader.active = false;
+                    root.removeFile();
+                }
+                background: Rectangle {
+                    radius: 4
+                    color: removeItem.hovered? "#BBBBBB":"#acacac"
+                }
+                contentItem: Rectangle {
+                    color: "transparent"
+                    implicitHeight: 20
+                    implicitWidth: 150
+                    Image {
+                        id: removeIcon
+                        source: "qrc:/img/resources/remove.svg"
+                        anchors.left: parent.left
+                        anchors.margins: 2 //hardcoded
+                        anchors.verticalCenter: parent.verticalCenter
+                        fillMode: Image.PreserveAspectFit
+                        width: 20
+                        height: 20
+                    }
+                    Label {
+                        text: "Remove from List"
+                        color: "#1A1A1A"
+                        font.pointSize: 10 * FontScale
+                        anchors.left: removeIcon.right
+                        anchors.margins: 6 //hardcoded
+                        anchors.verticalCenter: parent.verticalCenter
+                    }
+                }
+            }
         }
     }
 }
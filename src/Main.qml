@@ -63,6 +63,223 @@ ZBorderlessWindow {
         }
     }
 
+    FolderDialog {
+        id: openFolderDialog
+        title: "Choose a folder to import recursively"
+        onAccepted: {
+            exiftool.importFolder(selectedFolder);
+        }
+    }
+
+    //Export metadata of all files (Ctrl+E), format from the file suffix
+    FileDialog {
+        id: exportDialog
+        title: "Export metadata of all files"
+        fileMode: FileDialog.SaveFile
+        nameFilters: ["CSV table (*.csv)", "NDJSON, all entries (*.ndjson)", "Columnar binary (*.zvcols)"]
+        onAccepted: {
+            const path = selectedFile.toString();
+            const format = path.endsWith(".ndjson") ? "ndjson" : (path.endsWith(".zvcols") ? "columnar" : "csv");
+            exiftool.exportSession(selectedFile, format);
+        }
+    }
+
+    Shortcut {
+        sequence: "Ctrl+E"
+        enabled: exiftool.fileCount > 0 && !exiftool.exporting
+        onActivated: exportDialog.open()
+    }
+
+    //Edit a tag of the current file or of all files (Ctrl+T), an empty value removes the tag
+    Dialog {
+        id: tagEditDialog
+        title: "Edit tag"
+        anchors.centerIn: parent
+        modal: true
+        standardButtons: Dialog.Ok | Dialog.Cancel
+
+        ColumnLayout {
+            spacing: 8
+            TextField {
+                id: tagNameField
+                Layout.preferredWidth: 320
+                placeholderText: "Group:Tag or Tag, e.g. EXIF:Artist"
+            }
+            TextField {
+                id: tagValueField
+                Layout.preferredWidth: 320
+                placeholderText: "New value, empty to remove"
+            }
+            CheckBox {
+                id: allFilesBox
+                text: "All " + exiftool.fileCount + " files"
+            }
+        }
+
+        onAccepted: {
+            const name = tagNameField.text.trim();
+            if (name.length === 0)
+                return;
+            let indices = [exiftool.currentIndex];
+            if (allFilesBox.checked) {
+                indices = [];
+                for (let i = 0; i < exiftool.fileCount; ++i)
+                    indices.push(i);
+            }
+            let tags = {};
+            tags[name] = tagValueField.text;
+            exiftool.writeTags(indices, tags);
+        }
+    }
+
+    Shortcut {
+        sequence: "Ctrl+T"
+        enabled: exiftool.fileCount > 0
+        onActivated: tagEditDialog.open()
+    }
+
+    //Batch rename of all files by a template (Ctrl+R), preview follows the typing
+    Dialog {
+        id: renameDialog
+        title: "Rename files"
+        anchors.centerIn: parent
+        modal: true
+        width: Math.min(mainWindow.width - 80, 640)
+        height: Math.min(mainWindow.height - 80, 480)
+        standardButtons: Dialog.Ok | Dialog.Cancel
+
+        property int renameCount: 0
+        property int conflicts: 0
+        property string templateError: ""
+
+        onOpened: planTimer.restart()
+        onAccepted: exiftool.applyRename()
+        Component.onCompleted: standardButton(Dialog.Ok).enabled = Qt.binding(function() {
+            return !exiftool.renaming && renameDialog.templateError === ""
+                && renameDialog.conflicts === 0 && renameDialog.renameCount > 0;
+        })
+
+        Timer {
+            id: planTimer
+            interval: 250
+            onTriggered: {
+                renameDialog.templateError = exiftool.checkRenameTemplate(templateField.text);
+                if (renameDialog.templateError === "")
+                    exiftool.planRename(templateField.text);
+            }
+        }
+
+        Connections {
+            target: exiftool
+            function onRenamePlanned(renameCount, conflicts) {
+                renameDialog.renameCount = renameCount;
+                renameDialog.conflicts = conflicts;
+            }
+        }
+
+        ColumnLayout {
+            anchors.fill: parent
+            spacing: 8
+            TextField {
+                id: templateField
+                Layout.fillWidth: true
+                text: "{DateTimeOriginal}_{Model}_{seq}"
+                placeholderText: "{DateTimeOriginal|yyyy-MM-dd}_{camera}_{seq|3}"
+                onTextChanged: planTimer.restart()
+            }
+            Label {
+                text: renameDialog.templateError !== "" ? renameDialog.templateError
+                    : renameDialog.renameCount + " files renamed, " + renameDialog.conflicts + " conflicts"
+                color: (renameDialog.templateError !== "" || renameDialog.conflicts > 0) ? "#d05050" : "#bdbdbd"
+            }
+            ListView {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                clip: true
+                model: exiftool.renamePreview
+                delegate: Row {
+                    required property string oldName
+                    required property string newName
+                    required property string status
+                    required property string message
+                    spacing: 10
+                    Text {
+                        width: 220
+                        elide: Text.ElideMiddle
+                        text: parent.oldName
+                        color: "#bdbdbd"
+                    }
+                    Text {
+                        text: parent.status === "ok" || parent.status === "unchanged"
+                            ? parent.newName : parent.newName + "  (" + parent.message + ")"
+                        color: parent.status === "ok" ? "#dedede"
+                             : parent.status === "unchanged" || parent.status === "missing" ? "#8a8a8a" : "#d05050"
+                    }
+                }
+            }
+        }
+    }
+
+    Shortcut {
+        sequence: "Ctrl+R"
+        enabled: exiftool.fileCount > 0 && !exiftool.renaming
+        onActivated: renameDialog.open()
+    }
+
+    //Metrics overlay, toggled with Ctrl+Shift+M (or ZVIEWER_METRICS_OVERLAY=1 on start)
+    Shortcut {
+        sequence: "Ctrl+Shift+M"
+        onActivated: exiftool.metricsOverlay = !exiftool.metricsOverlay
+    }
+
+    //file switch latency ends with the first frame presented after setCurrentIndex
+    Connections {
+        target: mainWindow
+        enabled: exiftool.fileSwitchPending
+        function onFrameSwapped() {
+            exiftool.fileSwitchPresented()
+        }
+    }
+
+    Rectangle {
+        id: metricsOverlay
+        visible: exiftool.metricsOverlay
+        z: 100 //above all panels
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 12
+        width: metricsColumn.implicitWidth + 20
+        height: metricsColumn.implicitHeight + 16
+        radius: 6
+        color: "#cc2a2a2a"
+
+        Column {
+            id: metricsColumn
+            anchors.centerIn: parent
+            spacing: 2
+            Repeater {
+                model: exiftool.metrics
+                delegate: Row {
+                    required property string name
+                    required property string value
+                    spacing: 10
+                    Text {
+                        width: 140
+                        text: parent.name
+                        color: "#bdbdbd"
+                        font.pointSize: 9*FontScale
+                    }
+                    Text {
+                        text: parent.value
+                        color: "#dedede"
+                        font.pointSize: 9*FontScale
+                        font.family: "Roboto Mono"
+                    }
+                }
+            }
+        }
+    }
+
     //Thumbnail Area
     Rectangle { //thumbnail area
         id: thumbnailArea
@@ -88,6 +305,12 @@ ZBorderlessWindow {
             onRevealFilePath:  function(tpPath){//pass tpPath to function
                 exiftool.revealInFileManager(tpPath); //Invokable method of Backend class
             }
+            onRemoveRequested: function(removeIndex){
+                exiftool.removeFile(removeIndex); //only this row is removed, other thumbnails stay
+            }
+            onVisibleRangeChanged: function(first, last){
+                exiftool.setVisibleRange(first, last); //queued metadata of these rows is read first
+            }
         }
     }
 
@@ -324,6 +547,9 @@ ZBorderlessWindow {
                     onClicked: {
                         openDialog.open()
                     }
+                    onPressAndHold: { //hold to import a whole folder
+                        openFolderDialog.open()
+                    }
                 }
                 /*
                 ZButton {
@@ -20,12 +20,29 @@ Rectangle {
     signal selected(int selectedIndex) //define result as selectedIndex
     //send out reveal file
     signal revealFilePath(string tpPath)
+    //send out remove request of a file
+    signal removeRequested(int removeIndex)
+    //send out rows on screen, debounced while scrolling
+    signal visibleRangeChanged(int first, int last)
     ListView {
         id: thumbList
         anchors.fill: parent
         spacing: 4
         model: root.displayModel //for testing, number of thumbnails to display
         ScrollBar.vertical: ScrollBar {}
+        onContentYChanged: visibleRangeTimer.restart()
+        onHeightChanged: visibleRangeTimer.restart()
+        onCountChanged: visibleRangeTimer.restart()
+        Timer {
+            id: visibleRangeTimer
+            interval: 100
+            onTriggered: {
+                const first = thumbList.indexAt(0, thumbList.contentY);
+                const last = thumbList.indexAt(0, thumbList.contentY + thumbList.height - 1);
+                if (first >= 0)
+                    root.visibleRangeChanged(first, last >= 0 ? last : thumbList.count - 1);
+            }
+        }
         delegate: 
         FileThumb {
             id: thumbItem
@@ -35,12 +52,14 @@ Rectangle {
             required property string baseName
             required property string fileType
             required property url thumbUrl
+            required property url placeholderUrl
             required property string filePath
             //set content
             itemIndex: fileIndex
             nameLabel: baseName
             typeLabel: fileType
             imageUrl: thumbUrl
+            previewUrl: placeholderUrl
             selected: (fileIndex === root.currentIndex) //displays selected status when matched with selected item
 
             //send index when left clicked
@@ -54,6 +73,9 @@ Rectangle {
                     root.revealFilePath(thumbItem.filePath);
                 }
             }
+            onRemoveFile: {
+                root.removeRequested(thumbItem.itemIndex);
+            }
         }
     }
 }
@@ -0,0 +1,307 @@
+#include "areaScaler.h"
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+//x86 SIMD paths, compiled with per-function target attributes so the rest of
+//the program keeps the default instruction set
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define ZV_SCALER_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define ZV_TARGET_SSE41
+        #define ZV_TARGET_AVX2
+    #else
+        #define ZV_TARGET_SSE41 __attribute__((target("sse4.1")))
+        #define ZV_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#endif
+
+namespace AreaScaler {
+
+//fixed point coverage: one source pixel = 256 units
+static constexpr int kShift = 8;
+static constexpr uint32_t kOne = 1u << kShift;
+
+//coverage of one destination pixel along one axis
+struct Span {
+    int first = 0;        //first source index
+    int last = 0;         //last source index (inclusive)
+    uint32_t wFirst = 0;  //coverage of first source index
+    uint32_t wLast = 0;   //coverage of last source index, 0 if last == first
+    uint32_t total = 0;   //sum of all coverages
+};
+
+//precompute spans of all destination pixels, dstLen <= srcLen
+static std::vector<Span> buildSpans(int srcLen, int dstLen)
+{
+    std::vector<Span> spans(dstLen);
+    for (int i = 0; i < dstLen; ++i) {
+        const int64_t s = int64_t(i) * srcLen * kOne / dstLen;
+        const int64_t e = int64_t(i + 1) * srcLen * kOne / dstLen;
+        Span& sp = spans[i];
+        sp.first = int(s >> kShift);
+        sp.last = int((e - 1) >> kShift);
+        sp.total = uint32_t(e - s);
+        if (sp.first == sp.last) {
+            sp.wFirst = sp.total;
+        } else {
+            sp.wFirst = uint32_t((int64_t(sp.first + 1) << kShift) - s);
+            sp.wLast = uint32_t(e - (int64_t(sp.last) << kShift));
+        }
+    }
+    return spans;
+}
+
+//vertical pass kernels: acc[i] += src[i] * w, w <= 256
+//this touches every source byte once and dominates the runtime
+using AccumulateFn = void (*)(uint32_t* acc, const uint8_t* src, int n, uint32_t w);
+
+static void accumulateScalar(uint32_t* acc, const uint8_t* src, int n, uint32_t w)
+{
+    for (int i = 0; i < n; ++i)
+        acc[i] += uint32_t(src[i]) * w;
+}
+
+#ifdef ZV_SCALER_X86
+//8 bytes per step: widen to u16, multiply (255 * 256 still fits u16), widen to u32 and add
+ZV_TARGET_SSE41 static void accumulateSSE41(uint32_t* acc, const uint8_t* src, int n, uint32_t w)
+{
+    const __m128i wv = _mm_set1_epi16(short(w));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i px = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+        const __m128i prod = _mm_mullo_epi16(px, wv);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_cvtepu16_epi32(prod)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_cvtepu16_epi32(_mm_srli_si128(prod, 8))));
+    }
+    accumulateScalar(acc + i, src + i, n - i, w);
+}
+
+//16 bytes per step, same scheme on 256 bit registers
+ZV_TARGET_AVX2 static void accumulateAVX2(uint32_t* acc, const uint8_t* src, int n, uint32_t w)
+{
+    const __m256i wv = _mm256_set1_epi16(short(w));
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m256i px = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        const __m256i prod = _mm256_mullo_epi16(px, wv);
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a, _mm256_add_epi32(_mm256_loadu_si256(a),
+            _mm256_cvtepu16_epi32(_mm256_castsi256_si128(prod))));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1),
+            _mm256_cvtepu16_epi32(_mm256_extracti128_si256(prod, 1))));
+    }
+    accumulateScalar(acc + i, src + i, n - i, w);
+}
+#endif
+
+//horizontal pass on the accumulated row, one output row at a time (scalar, small)
+static void reduceRow(const uint32_t* acc, const std::vector<Span>& xs, uint32_t totalY,
+                      uint8_t* dst, int channels)
+{
+    for (size_t ox = 0; ox < xs.size(); ++ox) {
+        const Span& sp = xs[ox];
+        const uint64_t total = uint64_t(sp.total) * totalY;
+        for (int c = 0; c < channels; ++c) {
+            const uint32_t* col = acc + c;
+            uint64_t sum = uint64_t(col[sp.first * channels]) * sp.wFirst;
+            if (sp.last != sp.first) {
+                uint64_t inner = 0;
+                for (int x = sp.first + 1; x < sp.last; ++x)
+                    inner += col[x * channels];
+                sum += (inner << kShift) + uint64_t(col[sp.last * channels]) * sp.wLast;
+            }
+            dst[ox * channels + c] = uint8_t((sum + total / 2) / total);
+        }
+    }
+}
+
+//CPU feature detection
+bool isaSupported(Isa isa)
+{
+    switch (isa) {
+    case Isa::Auto:
+    case Isa::Scalar:
+        return true;
+#ifdef ZV_SCALER_X86
+  #if defined(_MSC_VER) && !defined(__clang__)
+    case Isa::SSE41: {
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+    }
+    case Isa::AVX2: {
+        int info[4];
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) //OS must save YMM state
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+  #else
+    case Isa::SSE41:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.1");
+    case Isa::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+  #endif
+#else
+    case Isa::SSE41:
+    case Isa::AVX2:
+        return false;
+#endif
+    }
+    return false;
+}
+
+const char* isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Auto:   return "auto";
+    case Isa::Scalar: return "scalar";
+    case Isa::SSE41:  return "sse4.1";
+    case Isa::AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+static std::atomic<int> s_override{ static_cast<int>(Isa::Auto) };
+
+void setIsaOverride(Isa isa)
+{
+    s_override.store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+static Isa detectIsa()
+{
+    //env override for comparisons on the same machine
+    const QByteArray env = qgetenv("ZVIEWER_SCALER_ISA").trimmed().toLower();
+    Isa wanted = Isa::Auto;
+    if (env == "scalar")
+        wanted = Isa::Scalar;
+    else if (env == "sse41" || env == "sse4.1")
+        wanted = Isa::SSE41;
+    else if (env == "avx2")
+        wanted = Isa::AVX2;
+
+    if (wanted != Isa::Auto)
+        return isaSupported(wanted) ? wanted : Isa::Scalar;
+
+    if (isaSupported(Isa::AVX2))
+        return Isa::AVX2;
+    if (isaSupported(Isa::SSE41))
+        return Isa::SSE41;
+    return Isa::Scalar;
+}
+
+Isa activeIsa()
+{
+    const Isa forced = static_cast<Isa>(s_override.load(std::memory_order_relaxed));
+    if (forced != Isa::Auto)
+        return isaSupported(forced) ? forced : Isa::Scalar;
+
+    static const Isa detected = detectIsa(); //thread-safe static init, detect once
+    return detected;
+}
+
+static AccumulateFn accumulateFor(Isa isa)
+{
+    switch (isa) {
+#ifdef ZV_SCALER_X86
+    case Isa::AVX2:  return &accumulateAVX2;
+    case Isa::SSE41: return &accumulateSSE41;
+#endif
+    default:         return &accumulateScalar;
+    }
+}
+
+QSize fitSize(const QSize& src, const QSize& bound)
+{
+    if (!src.isValid() || !bound.isValid() || src.isEmpty())
+        return src;
+    if (src.width() <= bound.width() && src.height() <= bound.height())
+        return src; //never upscale
+
+    QSize out = src.scaled(bound, Qt::KeepAspectRatio);
+    return out.expandedTo(QSize(1, 1));
+}
+
+void resample(const uint8_t* src, int srcW, int srcH, std::ptrdiff_t srcStride,
+              uint8_t* dst, int dstW, int dstH, std::ptrdiff_t dstStride,
+              int channels)
+{
+    if (!src || !dst || srcW <= 0 || srcH <= 0 || dstW <= 0 || dstH <= 0)
+        return;
+    if (dstW > srcW || dstH > srcH || (channels != 3 && channels != 4))
+        return; //reduction only, RGB(A) only
+
+    const AccumulateFn accumulate = accumulateFor(activeIsa());
+    const std::vector<Span> xs = buildSpans(srcW, dstW);
+    const std::vector<Span> ys = buildSpans(srcH, dstH);
+
+    const int rowLen = srcW * channels;
+    std::vector<uint32_t> acc(rowLen);
+
+    for (int oy = 0; oy < dstH; ++oy) {
+        const Span& sp = ys[oy];
+        std::fill(acc.begin(), acc.end(), 0u);
+        for (int y = sp.first; y <= sp.last; ++y) {
+            const uint32_t w = (y == sp.first) ? sp.wFirst : (y == sp.last ? sp.wLast : kOne);
+            accumulate(acc.data(), src + y * srcStride, rowLen, w);
+        }
+        reduceRow(acc.data(), xs, sp.total, dst + oy * dstStride, channels);
+    }
+}
+
+QImage downscale(const QImage& src, const QSize& bound)
+{
+    if (src.isNull())
+        return {};
+
+    const QSize target = fitSize(src.size(), bound);
+    if (target == src.size())
+        return src;
+
+    //formats the kernel reads directly, everything else is converted once
+    QImage in = src;
+    int channels = 4;
+    switch (src.format()) {
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        channels = 4;
+        break;
+    case QImage::Format_RGB888:
+    case QImage::Format_BGR888:
+        channels = 3;
+        break;
+    default:
+        //average alpha in premultiplied space, otherwise edges get color fringes
+        in = src.convertToFormat(src.hasAlphaChannel()
+            ? QImage::Format_ARGB32_Premultiplied
+            : QImage::Format_RGB32);
+        channels = 4;
+        break;
+    }
+
+    QImage out(target, in.format());
+    if (out.isNull())
+        return {};
+
+    resample(in.constBits(), in.width(), in.height(), in.bytesPerLine(),
+             out.bits(), out.width(), out.height(), out.bytesPerLine(), channels);
+    out.setColorSpace(in.colorSpace());
+    return out;
+}
+
+}
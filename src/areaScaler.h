@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <cstdint>
+#include <cstddef>
+
+/*
+This file contains the area-averaging (box filter) downscaler used by the
+thumbnail pipelines. Every destination pixel is the exact coverage-weighted
+mean of the source pixels under it, which gives QImage::scaled(Smooth) level
+quality for large reduction ratios at a fraction of its cost.
+
+The kernel works on 8-bit interleaved RGB (3 channels) or RGBA (4 channels).
+The hot loop (vertical accumulation of full resolution rows) has SSE4.1 and
+AVX2 paths and a scalar fallback, selected once at runtime by CPU features.
+The ISA can be forced with env ZVIEWER_SCALER_ISA=scalar|sse41|avx2 or
+setIsaOverride() for benchmarking.
+*/
+
+namespace AreaScaler {
+
+enum class Isa {
+    Auto = -1, //only used for override, pick best supported
+    Scalar = 0,
+    SSE41,
+    AVX2
+};
+
+//best ISA supported by current CPU, respecting overrides
+Isa activeIsa();
+const char* isaName(Isa isa);
+//check if current CPU can run the given ISA
+bool isaSupported(Isa isa);
+//force an ISA (Auto to restore runtime detection), unsupported ISA falls back to scalar
+void setIsaOverride(Isa isa);
+
+//aspect preserving fit of src into bound, never upscales
+QSize fitSize(const QSize& src, const QSize& bound);
+
+//raw kernel: downscale srcW x srcH into dstW x dstH, dst must not be larger than src
+//channels: 3 (RGB) or 4 (RGBA / premultiplied ARGB)
+void resample(const uint8_t* src, int srcW, int srcH, std::ptrdiff_t srcStride,
+              uint8_t* dst, int dstW, int dstH, std::ptrdiff_t dstStride,
+              int channels);
+
+//QImage wrapper: aspect preserving fit into bound
+//returns src unchanged when it already fits
+QImage downscale(const QImage& src, const QSize& bound);
+
+}
@@ -1,9 +1,15 @@
 #include "backend.h"
+#include "trace.h"
+#include "metrics.h"
 
 #include <QUrl>
 #include <QProcess>
 #include <QFileInfo>
 #include <QDir>
+#include <QDateTime>
+#include <QTimer>
+#include <QGuiApplication>
+#include <algorithm>
 //
 /*
 Implementation of Backend class methods
@@ -12,7 +18,78 @@ Implementation of Backend class methods
 Backend::Backend(QObject *parent)
     : QObject{parent}
     , m_fileListModel(this)//set Backend object as parent of m_fileListModel
-{}
+{
+    //background import, all signals arrive on GUI thread
+    connect(&m_importPipeline, &ImportPipeline::basicExtracted, this, &Backend::onBasicExtracted);
+    connect(&m_importPipeline, &ImportPipeline::fileExtracted, this, &Backend::onFileExtracted);
+    connect(&m_importPipeline, &ImportPipeline::fileFailed, this, [this](const QString& localPath, int) {
+        m_awaitingFullPass.remove(QDir::cleanPath(localPath));
+        Metrics::counter("import.failed").add();
+        qWarning() << "Failed to load model from pipeline. Local path: " << localPath;
+    });
+    connect(&m_importPipeline, &ImportPipeline::pendingChanged, this, &Backend::pendingImportsChanged);
+    //watch mode, events are debounced and coalesced by the watcher
+    m_folderWatcher.setExtensions(FolderScanner::mediaExtensions());
+    connect(&m_folderWatcher, &FolderWatcher::filesAdded, this,
+        [this](const QStringList& paths) { onWatchedFilesChanged(paths, false); });
+    connect(&m_folderWatcher, &FolderWatcher::filesModified, this,
+        [this](const QStringList& paths) { onWatchedFilesChanged(paths, false); });
+    connect(&m_folderWatcher, &FolderWatcher::filesRemoved, this,
+        [this](const QStringList& paths) { onWatchedFilesChanged(paths, true); });
+    connect(&m_folderScanner, &FolderScanner::finished, this,
+        [this](quint64, const QString& root, int fileCount, int) {
+            emit scanningChanged();
+            emit folderScanFinished(root, fileCount);
+        });
+
+    connect(&m_entryCompressor, &EntryCompressor::enabledChanged, this, &Backend::onCompressionToggled);
+    m_importPipeline.setProfile(m_profiles.profile(m_profiles.active()));
+
+    //loaded files reach the list in batches, at most one layout pass per frame
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kFlushIntervalMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &Backend::flushLoadedFiles);
+
+    //models of at most this many recently shown files are kept, plus the neighbours of the current one
+    bool ok = false;
+    const int workingSet = qEnvironmentVariableIntValue("ZVIEWER_WORKING_SET", &ok);
+    if (ok && workingSet > 0)
+        m_workingSetSize = workingSet;
+
+    //session export, progress is coalesced by the exporter
+    connect(&m_exporter, &SessionExporter::runningChanged, this, &Backend::exportingChanged);
+    connect(&m_exporter, &SessionExporter::progressChanged, this, &Backend::exportProgressChanged);
+    connect(&m_exporter, &SessionExporter::finished, this, &Backend::exportFinished);
+
+    //tag writes, results are patched into the session without a new extraction
+    connect(&m_metadataWriter, &MetadataWriter::pendingChanged, this, &Backend::pendingWritesChanged);
+    connect(&m_metadataWriter, &MetadataWriter::written, this, &Backend::onTagsWritten);
+
+    //batch rename, paths are updated in place
+    connect(&m_renamePlanner, &RenamePlanner::busyChanged, this, &Backend::renamingChanged);
+    connect(&m_renamePlanner, &RenamePlanner::planned, this, &Backend::onRenamePlanned);
+    connect(&m_renamePlanner, &RenamePlanner::applied, this, &Backend::onRenameApplied);
+
+    //catalog of imported files, ZVIEWER_CATALOG=<file> to use another database, =0 to turn it off
+    connect(&m_catalog, &Catalog::openChanged, this, &Backend::catalogEnabledChanged);
+    connect(&m_catalog, &Catalog::queryFinished, this, &Backend::onCatalogQueryFinished);
+    const QString catalogPath = qEnvironmentVariable("ZVIEWER_CATALOG");
+    if (Catalog::isCompiledIn() && catalogPath != "0")
+        m_catalog.open(catalogPath.isEmpty() ? Catalog::defaultPath() : catalogPath);
+
+    //runtime metrics, refreshed while the overlay is shown and written as a log line every n seconds if set
+    m_metricsOverlay = qEnvironmentVariableIntValue("ZVIEWER_METRICS_OVERLAY") != 0;
+    m_metricsLogSeconds = std::max(0, qEnvironmentVariableIntValue("ZVIEWER_METRICS_LOG"));
+    m_metricsTimer.setInterval(1000);
+    connect(&m_metricsTimer, &QTimer::timeout, this, &Backend::updateMetrics);
+    updateMetricsTimer();
+
+    //session persistence, restore once QML is up so the list fills the visible view
+    if (s_autoSession) {
+        QTimer::singleShot(0, this, [this] { restoreSession(); });
+        connect(qApp, &QCoreApplication::aboutToQuit, this, [this] { saveSession(); });
+    }
+}
 
 //all file-level models retrievals need to check index legitimacy
 ExifModel* Backend::exifModel() const
@@ -34,7 +111,8 @@ QVariantMap Backend::basicInfo() const
 {
     if (m_currentIndex < 0 || m_currentIndex >= static_cast<int>(exifList.size()))
         return QVariantMap();
-    return exifList[m_currentIndex].exifModel->getBasicInfo();
+    const ExifModel* model = exifList[m_currentIndex].exifModel.get();
+    return model ? model->getBasicInfo() : QVariantMap(); //empty state if its metadata is gone
 }
 
 //Search model setting methods
@@ -93,12 +171,222 @@ void Backend::importFiles(const QList<QUrl>& urls, bool setCurrent)
     if (paths.isEmpty())
         return;
 
-    const int last = paths.size() - 1;
+    //one request id for the whole drop, its first arriving file becomes current
+    const int requestId = ++m_nextImportRequest;
+    if (setCurrent)
+        m_requestsAwaitingCurrent.insert(requestId);
+
+    QStringList files;
+    for (const QString& p : std::as_const(paths)) {
+        if (QFileInfo(p).isDir()) {
+            startFolderScan(p, requestId); //files stream into the pipeline while scanning
+            m_folderWatcher.watchFolder(p);
+            if (!m_importedFolders.contains(p))
+                m_importedFolders << p;
+        } else {
+            files << p;
+            m_folderWatcher.watchFile(p);
+        }
+    }
+    m_importPipeline.enqueueFiles(files, requestId); //fast basic pass first, then full metadata
+}
+
+void Backend::importFolder(const QString& folderPath, bool setCurrent)
+{
+    QUrl url(folderPath);
+    const QString localPath = (url.isValid() && url.scheme().startsWith("file"))
+        ? url.toLocalFile()
+        : folderPath;
+
+    const int requestId = ++m_nextImportRequest;
+    if (setCurrent)
+        m_requestsAwaitingCurrent.insert(requestId);
+    startFolderScan(localPath, requestId);
+    m_folderWatcher.watchFolder(localPath);
+    if (!m_importedFolders.contains(localPath))
+        m_importedFolders << localPath;
+}
+
+void Backend::startFolderScan(const QString& localPath, int requestId)
+{
+    //sink runs in scanner workers, enqueue is thread-safe
+    ImportPipeline* pipeline = &m_importPipeline;
+    const quint64 scanId = m_folderScanner.scan(localPath, FolderScanner::defaultOptions(),
+        [pipeline, requestId](const QStringList& files) { pipeline->enqueueFiles(files, requestId); });
+    if (scanId != 0)
+        emit scanningChanged();
+}
+
+void Backend::cancelImport()
+{
+    m_folderScanner.cancel();
+    m_importPipeline.cancel();
+    m_requestsAwaitingCurrent.clear();
+    m_awaitingFullPass.clear(); //cancelled passes never report back
+}
+
+void Backend::setVisibleRange(int first, int last)
+{
+    first = std::max(first, 0);
+    last = std::min(last, static_cast<int>(exifList.size()) - 1);
+    for (int row = first; row <= last; ++row)
+        m_importPipeline.promote(exifList[row].filePath, ImportPipeline::Priority::Visible);
+}
+
+void Backend::prioritiseAround(int index)
+{
+    m_importPipeline.promote(exifList[index].filePath, ImportPipeline::Priority::Selected);
+    for (int d = 1; d <= kPrefetchRadius; ++d) {
+        if (index + d < exifList.size())
+            m_importPipeline.promote(exifList[index + d].filePath, ImportPipeline::Priority::Neighbour);
+        if (index - d >= 0)
+            m_importPipeline.promote(exifList[index - d].filePath, ImportPipeline::Priority::Neighbour);
+    }
+}
+
+QVariantMap Backend::importLatency() const
+{
+    static const std::pair<const char*, ImportPipeline::Priority> classes[] = {
+        { "selected", ImportPipeline::Priority::Selected },
+        { "visible", ImportPipeline::Priority::Visible },
+        { "neighbour", ImportPipeline::Priority::Neighbour },
+        { "bulk", ImportPipeline::Priority::Bulk },
+    };
+    QVariantMap out;
+    for (const auto& [name, priority] : classes) {
+        const ImportPipeline::LatencyStats s = m_importPipeline.latency(priority);
+        out.insert(name, QVariantMap{ { "count", s.count }, { "averageMs", s.averageMs }, { "maxMs", s.maxMs } });
+    }
+    return out;
+}
+
+void Backend::setExtractionProfile(const QString& name)
+{
+    if (!m_profiles.contains(name) || m_profiles.active() == name)
+        return;
+    m_profiles.setActive(name);
+    m_importPipeline.setProfile(m_profiles.profile(name));
+    emit extractionProfileChanged();
+    requeueRestricted();
+
+    //built models follow the new filter: others are released, the viewed file is rebuilt in place
+    const QSet<FileId> resident = m_residentFiles;
+    for (const FileId& id : resident) {
+        const int row = exifList.rowOf(id);
+        if (row >= 0 && row != m_currentIndex)
+            releaseModels(row);
+    }
+    if (m_currentIndex >= 0 && exifList[m_currentIndex].isMaterialised()) {
+        ExifFileInfo& info = exifList[m_currentIndex];
+        info.exifModel->setEntries(m_importPipeline.profile()->filter(entriesOf(info)));
+        info.exifModel->rebuildBasicInfo();
+        info.exifGroupsModel->rebuildFromExifModel(*info.exifModel);
+        emit basicInfoChanged();
+    }
+}
+
+bool Backend::saveExtractionProfile(const QString& name, const QStringList& patterns)
+{
+    if (!m_profiles.insert(name, patterns))
+        return false;
+    emit extractionProfilesChanged();
+    if (m_profiles.active() == name.trimmed()) { //edited the active one
+        m_importPipeline.setProfile(m_profiles.profile(name.trimmed()));
+        requeueRestricted();
+    }
+    return true;
+}
+
+bool Backend::removeExtractionProfile(const QString& name)
+{
+    const bool wasActive = m_profiles.active() == name;
+    if (!m_profiles.remove(name))
+        return false;
+    emit extractionProfilesChanged();
+    if (wasActive) {
+        m_importPipeline.setProfile(m_profiles.profile(m_profiles.active()));
+        emit extractionProfileChanged();
+        requeueRestricted();
+    }
+    return true;
+}
+
+//entries of a restricted profile lack the tags of any other one, filtering cannot bring them back
+void Backend::requeueRestricted()
+{
+    int queued = 0;
+    for (int row = 0; row < exifList.size(); ++row) {
+        if (exifList[row].restricted) {
+            m_importPipeline.enqueue(exifList[row].filePath, kWatchRequest); //replaced in place
+            ++queued;
+        }
+    }
+    for (const PendingFile& f : std::as_const(m_pendingFiles)) {
+        if (f.restricted) {
+            m_importPipeline.enqueue(f.filePath, kWatchRequest); //updates the pending entry or the row
+            ++queued;
+        }
+    }
+    if (queued > 0)
+        qDebug() << "Backend: extraction profile changed," << queued << "files are read again";
+}
+
+void Backend::setWatchFolders(bool enabled)
+{
+    if (m_folderWatcher.isEnabled() == enabled)
+        return;
+    m_folderWatcher.setEnabled(enabled);
+    emit watchFoldersChanged();
+}
+
+//fast pass of a two-phase import: the file is listed with its basic info, full metadata follows
+void Backend::onBasicExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId)
+{
+    const bool setCurrent = m_requestsAwaitingCurrent.remove(requestId);
+    m_awaitingFullPass.insert(QDir::cleanPath(localPath));
+    queueLoadedFile(localPath, entries, setCurrent, true);
+}
+
+void Backend::onFileExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId, bool restricted)
+{
+    static Metrics::Counter& extracted = Metrics::counter("import.files");
+    extracted.add();
+    if (!restricted)
+        addToCatalog(localPath, entries);
+    else if (m_importPipeline.profile()->isFull())
+        m_importPipeline.enqueue(localPath, kWatchRequest); //profile widened while it was read, this one stands in meanwhile
+    const bool fullPass = requestId != kWatchRequest && m_awaitingFullPass.remove(QDir::cleanPath(localPath));
+    const int index = indexOfPath(localPath);
+    if (index >= 0) {
+        //watcher refresh of a file in session: update in place, never append a duplicate
+        if (requestId == kWatchRequest) {
+            refreshFileAt(index, entries, restricted);
+            return;
+        }
+        //second phase of a two-phase import
+        if (exifList[index].basicOnly) {
+            completeFileAt(index, entries, restricted);
+            return;
+        }
+        if (fullPass)
+            return; //a watcher refresh completed the file already, its metadata is newer
+    }
 
-    for (int i = 0; i < paths.size(); ++i) {
-        const bool setCurForThis = setCurrent && (i == last);
-        loadExifFromFile(paths[i], setCurForThis); // 直接调用原有函数
+    //file still waiting for its batch: newest metadata wins
+    const auto pending = m_pendingIndex.constFind(QDir::cleanPath(localPath));
+    if (pending != m_pendingIndex.constEnd()
+        && (requestId == kWatchRequest || m_pendingFiles[pending.value()].basicOnly)) {
+        m_pendingFiles[pending.value()].entries = entries;
+        m_pendingFiles[pending.value()].basicOnly = false;
+        m_pendingFiles[pending.value()].restricted = restricted;
+        return;
     }
+    if (fullPass)
+        return; //updated by the watcher while waiting, or removed from the session since the fast pass
+
+    //first file of a request takes the display, later ones are appended quietly
+    const bool setCurrent = m_requestsAwaitingCurrent.remove(requestId);
+    queueLoadedFile(localPath, entries, setCurrent, false, restricted);
 }
 
 
@@ -111,6 +399,7 @@ void Backend::myFunction()
 //if QML does not specify, new file will be set on current display
 void Backend::loadExifFromFile(const QString& filePath, bool setCurrent)
 {
+    ZV_TRACE_SCOPE("backend.loadExifFromFile");
     //step 1: file path processing
     //filePath may contain file// heading, parsing needed
     QUrl url(filePath);
@@ -127,37 +416,208 @@ void Backend::loadExifFromFile(const QString& filePath, bool setCurrent)
              <<", localPath = " << localPath; //for debug purposes
 
 
-    //step 2: reading exif data using pipeline
-    std::unique_ptr<ExifModel> loadModel = getExifModelFromFile(localPath);//use local path to run exiftool and load Model
-    //when pipeline fails to read, nullptr will be returned
-    if (!loadModel) {
+    //step 2: reading exif data using pipeline, restricted to the active profile
+    const auto profile = m_importPipeline.profile();
+    QVector<TagEntry> entries;
+    //when pipeline fails to read, false will be returned
+    if (!extractExifEntries(localPath, &entries, profile->exifToolArgs())) {
+        Metrics::counter("import.failed").add();
         qWarning() << "Failed to load model from pipeline. Local path: " << localPath;
         return;
     }
+    Metrics::counter("import.files").add();
+    entries = profile->filter(entries);
+    addToCatalog(localPath, entries);
 
-    //step 3: create new ExifFileInfo object and fill up
-    auto groupsModel = std::make_unique<ExifGroupsModel>();
-    groupsModel->rebuildFromExifModel(*loadModel);
-    ExifFileInfo info(filePath);
-    info.exifModel = std::move(loadModel);
-    info.exifGroupsModel = std::move(groupsModel);
+    //appended together with files already waiting, keeps the import order
+    queueLoadedFile(localPath, std::move(entries), setCurrent, false, !profile->isFull());
+    flushLoadedFiles();
+    m_folderWatcher.watchFile(localPath);
+}
 
-    //step 4: push back into exifList, update file count and fileListModel
-    //qml UI will update thumbnail panel
-    exifList.push_back(std::move(info));
-    m_fileListModel.addFile(exifList.back());// add file to fileListModel, which also creates thumb image
-    emit fileCountChanged();
-    
-    //step 5: if setCurrent enabled, update m_exifModel and change current index
-    if (setCurrent)
-    {
-        //when setting current index, the setCurrentIndex method would emit change signals
-        setCurrentIndex(static_cast<int>(exifList.size()) - 1);
+void Backend::queueLoadedFile(const QString& filePath, QVector<TagEntry> entries, bool setCurrent, bool basicOnly,
+                              bool restricted)
+{
+    m_pendingIndex.insert(QDir::cleanPath(filePath), m_pendingFiles.size());
+    m_pendingFiles.push_back({ filePath, std::move(entries), setCurrent, basicOnly, restricted });
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start(); //not restarted by later files, so a steady stream still flushes every frame
+}
+
+void Backend::flushLoadedFiles()
+{
+    m_flushTimer.stop();
+    if (m_pendingFiles.isEmpty())
+        return;
+    ZV_TRACE_SCOPE("backend.flushLoadedFiles");
+
+    //step 3: create new ExifFileInfo objects and fill up
+    //only the entries are kept, models are built when the file is shown
+    const int firstRow = exifList.size();
+    int newCurrent = -1;
+    exifList.reserve(firstRow + m_pendingFiles.size());
+    for (PendingFile& f : m_pendingFiles) {
+        ExifFileInfo info(f.filePath);
+        storeEntries(info, std::move(f.entries));
+        info.basicOnly = f.basicOnly;
+        info.restricted = f.restricted;
+        const QString cleanPath = QDir::cleanPath(info.filePath);
+        m_pathIndex.insert(cleanPath, exifList.push_back(std::move(info)));
+        if (f.setCurrent)
+            newCurrent = exifList.size() - 1; //last request of the batch wins, as if appended one by one
     }
+    m_pendingFiles.clear();
+    m_pendingIndex.clear();
+
+    //step 4: one contiguous insert, qml UI lays out the thumbnail panel once per batch
+    m_fileListModel.appendFrom(exifList, firstRow); //thumbnails are generated in background
+    emit fileCountChanged();
+
+    //step 5: change current index once
+    if (newCurrent >= 0)
+        setCurrentIndex(newCurrent); //emits the change signals
     else if (m_currentIndex < 0) //no current file yet, initialize to first file
-    {   
         setCurrentIndex(0);
+}
+
+//watch mode: added and modified files are (re-)extracted in background, removed files leave the session
+void Backend::onWatchedFilesChanged(const QStringList& paths, bool removed)
+{
+    if (!removed) {
+        for (const QString& p : paths)
+            m_importPipeline.enqueue(p, kWatchRequest);
+        return;
+    }
+    QList<int> indices;
+    for (const QString& p : paths) {
+        const int index = indexOfPath(p);
+        if (index >= 0)
+            indices << index;
+        m_folderWatcher.unwatchFile(p);
     }
+    removeFiles(indices); //one batch, contiguous rows are removed together
+}
+
+int Backend::indexOfPath(const QString& localPath) const
+{
+    const auto it = m_pathIndex.constFind(QDir::cleanPath(localPath));
+    if (it == m_pathIndex.constEnd())
+        return -1;
+    return exifList.rowOf(it.value());
+}
+
+//replace metadata of one file, model objects stay the same so QML bindings stay valid
+void Backend::refreshFileAt(int index, const QVector<TagEntry>& entries, bool restricted)
+{
+    if (index < 0 || index >= static_cast<int>(exifList.size()))
+        return;
+    ExifFileInfo& info = exifList[index];
+    //the compact record always takes the fresh entries, snapshot data is stale now
+    clearEntries(info);
+    storeEntries(info, entries);
+    info.basicOnly = false;
+    info.restricted = restricted;
+    if (!info.isMaterialised()) {
+        m_fileListModel.refreshFile(index); //models are built from the new entries when shown
+        return;
+    }
+    info.exifModel->setEntries(entries);
+    info.exifModel->rebuildBasicInfo();
+    info.exifGroupsModel->rebuildFromExifModel(*info.exifModel); //fold status kept by group name
+    m_fileListModel.refreshFile(index); //thumbnail of this row only
+
+    if (index == m_currentIndex)
+        emit basicInfoChanged(); //proxy follows the reset of its source model
+}
+
+//full metadata of a file listed by the fast pass, the file itself did not change
+void Backend::completeFileAt(int index, const QVector<TagEntry>& entries, bool restricted)
+{
+    ExifFileInfo& info = exifList[index];
+    clearEntries(info);
+    storeEntries(info, entries);
+    info.basicOnly = false;
+    info.restricted = restricted;
+    if (!info.isMaterialised())
+        return;
+    if (index != m_currentIndex) {
+        releaseModels(index); //rebuilt from the full record when shown, no reset nobody sees
+        return;
+    }
+    //the viewed file: one model reset, groups keep their fold state
+    info.exifModel->setEntries(entries);
+    info.exifModel->rebuildBasicInfo();
+    info.exifGroupsModel->rebuildFromExifModel(*info.exifModel);
+    emit basicInfoChanged();
+}
+
+void Backend::removeFile(int index)
+{
+    removeFiles({ index });
+}
+
+//remove files from the session, other rows and their thumbnails are untouched
+void Backend::removeFiles(const QList<int>& indices)
+{
+    const int count = static_cast<int>(exifList.size());
+    QList<int> rows;
+    for (int i : indices) {
+        if (i >= 0 && i < count)
+            rows << i;
+    }
+    if (rows.isEmpty())
+        return;
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    //current file is followed by id, rows shift under it
+    const FileId currentId = exifList.idAt(m_currentIndex);
+    const int removedAbove = static_cast<int>(std::lower_bound(rows.begin(), rows.end(), m_currentIndex) - rows.begin());
+    if (std::binary_search(rows.begin(), rows.end(), m_currentIndex))
+        m_exifProxyModel.setSourceModel(nullptr); //detach before the model is destroyed
+
+    //contiguous runs from the bottom up, so the rows of the remaining runs stay valid
+    int last = rows.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && rows[first - 1] == rows[first] - 1)
+            --first;
+        removeRowRange(rows[first], rows[last]);
+        last = first - 1;
+    }
+    emit fileCountChanged();
+
+    if (exifList.contains(currentId)) {
+        const int row = exifList.rowOf(currentId);
+        if (row != m_currentIndex) {
+            m_currentIndex = row; //same file, new index
+            emit currentIndexChanged();
+        }
+    } else if (m_currentIndex >= 0) {
+        //current file removed: show its successor, or the new last file
+        const int successor = m_currentIndex - removedAbove;
+        m_currentIndex = -1;
+        if (!exifList.empty()) {
+            setCurrentIndex(std::min(successor, static_cast<int>(exifList.size()) - 1));
+        } else {
+            emit currentIndexChanged();
+            emit exifModelChanged();
+            emit basicInfoChanged();
+            emit exifGroupsModelChanged();
+        }
+    }
+}
+
+void Backend::removeRowRange(int first, int last)
+{
+    for (int r = first; r <= last; ++r) {
+        clearEntries(exifList[r]); //compression statistics
+        const auto it = m_pathIndex.find(QDir::cleanPath(exifList[r].filePath));
+        if (it != m_pathIndex.end() && it.value() == exifList.idAt(r))
+            m_pathIndex.erase(it); //entry of a newer import of the same path is kept
+    }
+    m_fileListModel.removeFiles(first, last);
+    exifList.removeRows(first, last);
 }
 
 //change current index and update m_exifModel
@@ -175,9 +635,24 @@ void Backend::setCurrentIndex(int index)
     if (m_currentIndex == index)
         return;
 
+    //models are built on demand, files out of the working set release theirs
+    //the current row always has its models, views and patches rely on it
+    if (!ensureMaterialised(index)) {
+        qWarning() << "Set index failed. " << index << " has no metadata. ";
+        return;
+    }
+
+    //file switch latency runs until QML reports the next frame, see fileSwitchPresented
+    const bool wasPending = m_switchClock.isValid();
+    m_switchClock.start();
+    if (!wasPending)
+        emit fileSwitchPendingChanged();
+
     //update index, notify qml to refresh thumb panel
     m_currentIndex = index;
     emit currentIndexChanged();
+    touchWorkingSet(index);
+    prioritiseAround(index);
 
     //set source of exifProxyModel to exifModel of current file
     m_exifProxyModel.setSourceModel(exifList[m_currentIndex].exifModel.get());
@@ -199,6 +674,8 @@ void Backend::toggleFoldStatus(int fileIndex, int groupIndex)
         qWarning() << "Illegal file index " << fileIndex ;
         return;
     }
+    if (!ensureMaterialised(fileIndex))
+        return;
     exifList[fileIndex].exifGroupsModel->toggleFoldStatus(groupIndex);
 }
 
@@ -255,45 +732,627 @@ void Backend::revealInFileManager(const QString& filePath)
 
 bool Backend::clearCacheFolder()
 {
-    const QString m_cacheDir = QCoreApplication::applicationDirPath() + "/cache/zviewer_thumbs";
-    if (m_cacheDir.isEmpty()) {
-        qWarning() << "Cache directory path is empty.";
+    //cache manager also resets its index and statistics
+    return m_fileListModel.cacheManager()->clearNow();
+}
+
+void Backend::cleanUpCache()
+{
+    m_fileListModel.cacheManager()->cleanUp();
+}
+
+//management of fileListModel
+
+
+void Backend::rebuildFileListModel()
+{
+    m_fileListModel.rebuildFrom(exifList);
+}
+
+bool Backend::ensureMaterialised(int index)
+{
+    ExifFileInfo& info = exifList[index];
+    if (info.isMaterialised())
+        return true;
+    ZV_TRACE_SCOPE("backend.materialise");
+    const bool fromSnapshot = info.snapshotIndex >= 0;
+    if (fromSnapshot && !m_snapshot.isOpen()) {
+        qWarning() << "Backend::ensureMaterialised: no metadata for" << info.filePath;
         return false;
     }
+    //the active profile applies to cached metadata as well as to fresh extractions
+    info.exifModel = makeExifModel(m_importPipeline.profile()->filter(entriesOf(info)));
+    info.exifGroupsModel = std::make_unique<ExifGroupsModel>();
+    info.exifGroupsModel->rebuildFromExifModel(*info.exifModel);
+    info.exifGroupsModel->setFoldedGroups(info.foldedGroups);
+    m_residentFiles.insert(exifList.idAt(index));
+    return true;
+}
 
-    QDir dir(m_cacheDir);
+//drop the Qt models of a file, entries and fold state stay in the compact record
+void Backend::releaseModels(int index)
+{
+    ExifFileInfo& info = exifList[index];
+    if (!info.isMaterialised())
+        return;
+    info.foldedGroups = info.exifGroupsModel->foldedGroups();
+    //QML may still hold the pointers until its bindings settle
+    info.exifModel.release()->deleteLater();
+    info.exifGroupsModel.release()->deleteLater();
+    m_residentFiles.remove(exifList.idAt(index));
+}
+
+//LRU of displayed files plus the neighbours of the current one keep their models
+void Backend::touchWorkingSet(int index)
+{
+    const FileId id = exifList.idAt(index);
+    m_recentFiles.removeAll(id);
+    m_recentFiles.prepend(id);
+    while (m_recentFiles.size() > m_workingSetSize)
+        m_recentFiles.removeLast();
 
-    if (!dir.exists()) {
-        qDebug() << "Cache directory does not exist:" << m_cacheDir;
-        return true; // if non-exist, reture complete
+    QSet<FileId> keep(m_recentFiles.cbegin(), m_recentFiles.cend());
+    for (int d = 1; d <= kPrefetchRadius; ++d) {
+        keep.insert(exifList.idAt(index - d)); //invalid ids past the ends are harmless
+        keep.insert(exifList.idAt(index + d));
     }
+    const QSet<FileId> resident = m_residentFiles;
+    for (const FileId& r : resident) {
+        const int row = exifList.rowOf(r);
+        if (row < 0)
+            m_residentFiles.remove(r); //removed from the session
+        else if (!keep.contains(r))
+            releaseModels(row);
+    }
+
+    //neighbours are built after the switch has been painted
+    QTimer::singleShot(0, this, [this, id] {
+        const int row = exifList.rowOf(id);
+        if (row < 0 || row != m_currentIndex)
+            return; //user moved on, the next switch prefetches
+        for (int d = 1; d <= kPrefetchRadius; ++d) {
+            if (row + d < exifList.size())
+                ensureMaterialised(row + d);
+            if (row - d >= 0)
+                ensureMaterialised(row - d);
+        }
+    });
+}
+
+bool Backend::saveSession(const QString& path)
+{
+    const QString target = path.isEmpty() ? SessionSnapshot::defaultPath() : path;
+    flushLoadedFiles(); //files waiting for their batch belong to the session
+    m_renamePlanner.waitForDone(); //a rename plan may be reading the mapping
 
-    // avoid deleting program main dir
-    if (dir.absolutePath() == QCoreApplication::applicationDirPath()) {
-        qCritical() << "Refusing to delete application directory!";
+    //restored files are copied from the mapped snapshot, nothing is re-extracted
+    auto source = [this](int row) {
+        const ExifFileInfo& info = exifList[row];
+        SessionSnapshot::FileData d;
+        d.filePath = info.filePath;
+        d.viewX = info.viewX;
+        d.viewY = info.viewY;
+        d.partial = info.basicOnly;
+        d.restricted = info.restricted;
+        d.entries = entriesOf(info);
+        d.foldedGroups = info.isMaterialised() ? info.exifGroupsModel->foldedGroups() : info.foldedGroups;
+        return d;
+    };
+
+    //a mapped file cannot be replaced on every platform, write aside and swap after unmapping
+    const QString written = target + ".new";
+    //restricted files were read with the active profile, earlier ones are queued again on every change
+    const QString profile = m_importPipeline.profile()->key();
+    if (!SessionSnapshot::write(written, exifList.size(), source, m_currentIndex, m_importedFolders, profile))
         return false;
-    }
 
-    bool ok = dir.removeRecursively();//delete all files in dir
-    if (!ok) {
-        qWarning() << "Failed to remove cache directory:" << m_cacheDir;
+    const bool remapped = m_snapshot.isOpen() && QFileInfo(m_snapshot.path()) == QFileInfo(target);
+    if (remapped)
+        m_snapshot.close();
+    if (!SessionSnapshot::replace(written, target)) {
+        qWarning() << "Backend::saveSession: cannot replace" << target;
+        if (remapped && !m_snapshot.open(target)) { //the old file is back, records keep reading it
+            qWarning() << "Backend::saveSession: previous session lost" << target;
+            detachSnapshot();
+        }
+        return false;
+    }
+    if (!remapped)
+        return true;
+    if (!m_snapshot.open(target)) {
+        qWarning() << "Backend::saveSession: cannot map the saved session" << target;
+        detachSnapshot();
         return false;
     }
+    //the new file holds every file in row order, records drop their entries and read the mapping
+    for (int row = 0; row < exifList.size(); ++row) {
+        clearEntries(exifList[row]);
+        exifList[row].snapshotIndex = row;
+    }
+    return true;
+}
 
-    // 重新创建空目录，方便后续继续用
-    if (!dir.mkpath(".")) {
-        qWarning() << "Failed to recreate cache directory:" << m_cacheDir;
+//the mapping is gone: records that read it keep what their models hold and are extracted again
+void Backend::detachSnapshot()
+{
+    int lost = 0;
+    for (int row = 0; row < exifList.size(); ++row) {
+        ExifFileInfo& info = exifList[row];
+        if (info.snapshotIndex < 0)
+            continue;
+        QVector<TagEntry> kept = info.isMaterialised() ? info.exifModel->entries() : QVector<TagEntry>();
+        clearEntries(info);
+        storeEntries(info, std::move(kept));
+        info.basicOnly = true; //saved as partial until the refresh arrives
+        m_importPipeline.enqueue(info.filePath, kWatchRequest); //replaces the record in place
+        ++lost;
+    }
+    if (lost > 0)
+        qWarning() << "Backend: session mapping lost," << lost << "files are read again";
+}
+
+bool Backend::restoreSession(const QString& path)
+{
+    if (!exifList.empty()) {
+        qWarning() << "Backend::restoreSession: session is not empty";
         return false;
     }
+    const QString source = path.isEmpty() ? SessionSnapshot::defaultPath() : path;
+    m_renamePlanner.waitForDone(); //a rename plan may be reading the mapping
+    if (!m_snapshot.open(source))
+        return false; //no saved session
+
+    //records only, models are built from the mapping when a file is shown
+    const int count = m_snapshot.fileCount();
+    const int savedCurrent = m_snapshot.currentIndex();
+    int current = -1;
+    QHash<QString, FolderWatcher::Stamp> saved; //clean path -> stamp when saved, checked in background
+    QStringList partial;
+    QStringList restricted; //read with another profile than the active one, tags are missing
+    const bool otherProfile = m_snapshot.profile() != m_importPipeline.profile()->key();
+    exifList.reserve(count);
+    //no file system access here, files deleted or edited meanwhile are found by verifyFiles() below
+    for (int i = 0; i < count; ++i) {
+        const QString filePath = m_snapshot.filePath(i);
+        if (i == savedCurrent)
+            current = exifList.size();
+
+        ExifFileInfo info(filePath);
+        info.snapshotIndex = i;
+        info.viewX = m_snapshot.viewX(i);
+        info.viewY = m_snapshot.viewY(i);
+        info.foldedGroups = m_snapshot.foldedGroups(i);
+        info.basicOnly = m_snapshot.isPartial(i);
+        info.restricted = m_snapshot.isRestricted(i);
+        const QString cleanPath = QDir::cleanPath(filePath);
+        m_pathIndex.insert(cleanPath, exifList.push_back(std::move(info)));
+        saved.insert(cleanPath, { m_snapshot.fileSize(i), m_snapshot.fileMtime(i) });
+
+        if (m_snapshot.isPartial(i)) {
+            partial << filePath; //quit before the full pass reached it
+            m_awaitingFullPass.insert(cleanPath); //a refresh arriving first completes it as well
+        } else if (m_snapshot.isRestricted(i) && otherProfile) {
+            restricted << filePath;
+        }
+    }
+    if (exifList.empty())
+        return true;
 
-    qDebug() << "Cache folder cleared:" << m_cacheDir;
+    //one reset for the whole list instead of one insert per file
+    m_fileListModel.rebuildFrom(exifList);
+    emit fileCountChanged();
+
+    for (const QString& p : std::as_const(restricted))
+        m_importPipeline.enqueue(p, kWatchRequest); //read again with the active profile, replaced in place
+    const int completion = ++m_nextImportRequest; //never awaits current, completes in place
+    for (const QString& p : std::as_const(partial))
+        m_importPipeline.enqueue(p, completion);
+
+    //watch again what was watched before
+    m_importedFolders = m_snapshot.roots();
+    for (const QString& root : std::as_const(m_importedFolders))
+        m_folderWatcher.watchFolder(root);
+    for (int row = 0; row < exifList.size(); ++row) {
+        const QString& filePath = exifList[row].filePath;
+        const bool inFolder = std::any_of(m_importedFolders.cbegin(), m_importedFolders.cend(),
+            [&filePath](const QString& root) { return filePath.startsWith(QDir::cleanPath(root) + '/'); });
+        if (!inFolder)
+            m_folderWatcher.watchFile(filePath, saved.value(QDir::cleanPath(filePath)));
+    }
+    //files edited while the app was closed are refreshed in place, deleted ones leave the session
+    m_folderWatcher.verifyFiles(saved);
+
+    qDebug() << "Backend::restoreSession:" << exifList.size() << "files from" << source;
+    setCurrentIndex(current >= 0 ? current : 0);
     return true;
 }
 
-//management of fileListModel
+QVector<TagEntry> Backend::entriesOf(const ExifFileInfo& info)
+{
+    if (info.snapshotIndex >= 0)
+        return m_snapshot.entries(info.snapshotIndex);
+    if (!info.packedEntries.isEmpty())
+        return m_entryCompressor.unpack(info.packedEntries);
+    return info.entries;
+}
 
+void Backend::storeEntries(ExifFileInfo& info, QVector<TagEntry> entries)
+{
+    if (m_entryCompressor.isEnabled())
+        info.packedEntries = m_entryCompressor.pack(entries);
+    else
+        info.entries = std::move(entries);
+}
 
-void Backend::rebuildFileListModel()
+void Backend::clearEntries(ExifFileInfo& info)
 {
-    m_fileListModel.rebuildFrom(exifList);
+    if (!info.packedEntries.isEmpty())
+        m_entryCompressor.release(info.packedEntries);
+    info.packedEntries.clear();
+    info.entries = {};
+    info.snapshotIndex = -1;
+}
+
+//records backed by the snapshot stay as they are, the mapping is compact already
+void Backend::onCompressionToggled()
+{
+    const bool enabled = m_entryCompressor.isEnabled();
+    for (int row = 0; row < exifList.size(); ++row) {
+        ExifFileInfo& info = exifList[row];
+        if (info.snapshotIndex >= 0)
+            continue;
+        if (enabled && info.packedEntries.isEmpty()) {
+            info.packedEntries = m_entryCompressor.pack(info.entries);
+            info.entries = {};
+        } else if (!enabled && !info.packedEntries.isEmpty()) {
+            info.entries = m_entryCompressor.unpack(info.packedEntries);
+            m_entryCompressor.release(info.packedEntries);
+            info.packedEntries.clear();
+        }
+    }
+}
+
+//session export
+bool Backend::exportSession(const QString& path, const QString& format, const QStringList& columns)
+{
+    const QUrl url(path);
+    const QString localPath = (url.isValid() && url.scheme().startsWith("file")) ? url.toLocalFile() : path;
+
+    SessionExporter::Format parsed;
+    if (!SessionExporter::parseFormat(format, &parsed)) {
+        qWarning() << "Backend::exportSession: unknown format" << format;
+        return false;
+    }
+    if (exifList.empty())
+        return false;
+
+    //ids instead of rows, files removed during the export are skipped and later rows do not shift
+    QVector<FileId> ids;
+    ids.reserve(exifList.size());
+    for (int row = 0; row < exifList.size(); ++row)
+        ids << exifList.idAt(row);
+
+    //records share the entries of the session, only snapshot and compressed files are decoded, one at a time
+    return m_exporter.start(localPath, parsed, columns, ids.size(), [this, ids](int i) -> SessionExporter::Record {
+        const ExifFileInfo* info = exifList.get(ids[i]);
+        if (!info)
+            return {};
+        return { info->filePath, info->isMaterialised() ? info->exifModel->entries() : entriesOf(*info) };
+    });
+}
+
+double Backend::exportProgress() const
+{
+    const int total = m_exporter.total();
+    return total > 0 ? double(m_exporter.written()) / total : 0.0;
+}
+
+//tag editing
+int Backend::writeTags(const QList<int>& indices, const QVariantMap& tags)
+{
+    QVector<MetadataWriter::TagEdit> edits;
+    for (auto it = tags.constBegin(); it != tags.constEnd(); ++it) {
+        const QString tag = it.key().trimmed();
+        if (tag.isEmpty() || tag.startsWith('-') || tag.contains('=')) {
+            qWarning() << "Backend::writeTags: invalid tag name" << it.key();
+            return -1;
+        }
+        const QString value = it.value().toString();
+        edits.push_back({ tag, value, value.isEmpty() });
+    }
+    QStringList paths;
+    for (int i : indices) {
+        if (i >= 0 && i < exifList.size())
+            paths << exifList[i].filePath;
+    }
+    paths.removeDuplicates();
+    return m_metadataWriter.write(paths, edits);
+}
+
+//written files: the refreshed tags replace their old entries, models are patched row by row
+void Backend::onTagsWritten(int id, const QStringList& tags, const QHash<QString, QVector<TagEntry>>& updated,
+                            const QStringList& failed, const QString& error)
+{
+    m_folderWatcher.acknowledge(updated.keys()); //no re-extraction for our own change
+    for (auto it = updated.constBegin(); it != updated.constEnd(); ++it) {
+        const int index = indexOfPath(it.key());
+        if (index >= 0) //else removed from the session meanwhile
+            patchFileAt(index, tags, it.value());
+    }
+    emit tagsWritten(id, updated.size(), failed, error);
+}
+
+void Backend::patchFileAt(int index, const QStringList& tags, const QVector<TagEntry>& fresh)
+{
+    ExifFileInfo& info = exifList[index];
+    const QVector<TagEntry> kept = m_importPipeline.profile()->filter(fresh); //the session only holds profile tags
+    if (!info.isMaterialised() && info.snapshotIndex >= 0 && !m_snapshot.isOpen()) {
+        qWarning() << "Backend::patchFileAt: no metadata to patch for" << info.filePath;
+        return; //storing the fresh tags alone would drop all others
+    }
+    QVector<TagEntry> entries;
+    if (info.isMaterialised()) {
+        const QStringList groups = info.exifModel->patchTags(tags, kept);
+        info.exifGroupsModel->patchGroups(*info.exifModel, groups); //fold status of other groups untouched
+        entries = info.exifModel->entries();
+    } else {
+        entries = patchTagEntries(entriesOf(info), tags, kept);
+    }
+    clearEntries(info);
+    storeEntries(info, entries);
+    addToCatalog(info.filePath, entries);
+    if (index == m_currentIndex)
+        emit basicInfoChanged();
+}
+
+//batch rename
+bool Backend::planRename(const QString& pattern, const QList<int>& indices, int firstNumber)
+{
+    QList<int> rows = indices;
+    if (rows.isEmpty()) {
+        for (int row = 0; row < exifList.size(); ++row)
+            rows << row;
+    }
+    //captured here, read by the planner threads: shared entries of built and plain records,
+    //snapshot files are decoded from the mapping in parallel, compressed ones are decoded now
+    QStringList paths;
+    auto entries = std::make_shared<QVector<QVector<TagEntry>>>();
+    auto snapshotRows = std::make_shared<QVector<int>>();
+    for (int row : rows) {
+        if (row < 0 || row >= exifList.size())
+            continue;
+        const ExifFileInfo& info = exifList[row];
+        paths << info.filePath;
+        snapshotRows->push_back(info.isMaterialised() ? -1 : info.snapshotIndex);
+        entries->push_back(info.isMaterialised() ? info.exifModel->entries()
+                           : info.snapshotIndex >= 0 ? QVector<TagEntry>() : entriesOf(info));
+    }
+    const SessionSnapshot* snapshot = &m_snapshot;
+    return m_renamePlanner.plan(pattern, paths, [entries, snapshotRows, snapshot](int i) {
+        const int snapshotRow = snapshotRows->at(i);
+        return snapshotRow >= 0 ? snapshot->entries(snapshotRow) : entries->at(i);
+    }, firstNumber);
+}
+
+QString Backend::checkRenameTemplate(const QString& pattern) const
+{
+    QString error;
+    RenamePlanner::checkTemplate(pattern, &error);
+    return error;
+}
+
+void Backend::onRenamePlanned()
+{
+    static const char* const statusNames[] = { "ok", "unchanged", "missing", "collision", "exists" };
+    QVector<RenamePreviewModel::Row> rows;
+    rows.reserve(m_renamePlanner.items().size());
+    for (const RenamePlanner::Item& item : m_renamePlanner.items()) {
+        rows.push_back({ QFileInfo(item.oldPath).fileName(), QFileInfo(item.newPath).fileName(),
+                         QString::fromLatin1(statusNames[static_cast<int>(item.status)]), item.message });
+    }
+    m_renamePreview.setRows(std::move(rows));
+    emit renamePlanned(m_renamePlanner.renameCount(), m_renamePlanner.conflicts());
+}
+
+//renamed files keep their records, models and thumbnails, only paths and File:FileName change
+void Backend::onRenameApplied(bool ok, const QVector<QPair<QString, QString>>& renamed, const QString& error)
+{
+    m_folderWatcher.renameFiles(renamed);
+    thumbCache()->rename(renamed); //otherwise swept as orphans and generated again
+    m_catalog.rename(renamed);
+
+    //every file leaves the path index before any is added back, so swaps and chains find the right rows
+    QVector<FileId> ids;
+    ids.reserve(renamed.size());
+    for (const auto& move : renamed)
+        ids << m_pathIndex.take(QDir::cleanPath(move.first));
+    for (int i = 0; i < renamed.size(); ++i) {
+        const auto& move = renamed[i];
+        if (!ids[i].isValid() || !exifList.contains(ids[i]))
+            continue;
+        const int index = exifList.rowOf(ids[i]);
+        const QFileInfo fi(move.second);
+        ExifFileInfo& info = exifList[index];
+        m_pathIndex.insert(QDir::cleanPath(move.second), ids[i]);
+        info.filePath = move.second;
+        info.fileName = fi.fileName();
+        info.baseName = fi.baseName();
+        info.fileType = fi.suffix();
+        m_fileListModel.renameFile(index, move.second);
+        patchFileAt(index, { "File:FileName" }, { { "File", "FileName", fi.fileName() } });
+    }
+    if (ok)
+        m_renamePreview.setRows({});
+    emit renameApplied(ok, int(renamed.size()), error);
+}
+
+//catalog queries
+//entries of a restricted profile would replace the full metadata cataloged for the file
+void Backend::addToCatalog(const QString& filePath, const QVector<TagEntry>& entries)
+{
+    if (m_importPipeline.profile()->isFull())
+        m_catalog.add(filePath, entries);
+}
+
+int Backend::queryCatalog(const QString& query, const QStringList& columns, bool load, int limit)
+{
+    const int id = m_catalog.query(query, columns, limit, load);
+    if (id >= 0)
+        m_catalogRequests.insert(id, { columns, load });
+    return id;
+}
+
+void Backend::onCatalogQueryFinished(int id, const QVector<Catalog::Match>& matches, const QString& error)
+{
+    const CatalogRequest request = m_catalogRequests.take(id);
+    if (!error.isEmpty())
+        qWarning() << "Backend::queryCatalog:" << error;
+
+    QVariantList rows;
+    rows.reserve(matches.size());
+    for (const Catalog::Match& m : matches) {
+        QVariantMap row{ { "file", m.filePath } };
+        for (int c = 0; c < request.columns.size() && c < m.values.size(); ++c)
+            row.insert(request.columns[c], m.values[c]);
+        rows << row;
+    }
+
+    if (request.load) {
+        //unchanged files come from the catalog, changed ones are read again, deleted ones are skipped
+        const int requestId = ++m_nextImportRequest;
+        bool setCurrent = true;
+        for (const Catalog::Match& m : matches) {
+            const QFileInfo fi(m.filePath);
+            if (!fi.exists() || indexOfPath(m.filePath) >= 0 || m_pendingIndex.contains(QDir::cleanPath(m.filePath)))
+                continue;
+            if (fi.size() == m.size && fi.lastModified().toMSecsSinceEpoch() == m.mtime) {
+                queueLoadedFile(m.filePath, m_importPipeline.profile()->filter(m.entries), setCurrent, false);
+                setCurrent = false;
+            } else {
+                m_importPipeline.enqueue(m.filePath, requestId);
+            }
+            m_folderWatcher.watchFile(m.filePath);
+        }
+        if (setCurrent)
+            m_requestsAwaitingCurrent.insert(requestId); //nothing cached, first file read becomes current
+    }
+    emit catalogQueryFinished(id, rows, error);
+}
+
+//runtime metrics
+void Backend::setMetricsOverlay(bool shown)
+{
+    if (m_metricsOverlay == shown)
+        return;
+    m_metricsOverlay = shown;
+    updateMetricsTimer();
+    emit metricsOverlayChanged();
+}
+
+void Backend::updateMetricsTimer()
+{
+    const bool needed = m_metricsOverlay || m_metricsLogSeconds > 0;
+    if (needed == m_metricsTimer.isActive())
+        return;
+    if (needed) {
+        m_lastFileCount = Metrics::counter("import.files").value();
+        m_metricsClock.start();
+        m_metricsTimer.start();
+        updateMetrics(); //rows are shown right away, not after the first second
+    } else {
+        m_metricsTimer.stop();
+    }
+}
+
+void Backend::fileSwitchPresented()
+{
+    if (!m_switchClock.isValid())
+        return;
+    static Metrics::Histogram& switches = Metrics::histogram("fileSwitch");
+    switches.record(m_switchClock.nsecsElapsed() / 1000);
+    m_switchClock.invalidate();
+    emit fileSwitchPendingChanged();
+}
+
+//sizes of the record, its strings and its metadata in whatever form it is held, plus the models if built
+//entries shared with the models are counted once, allocator overhead is not counted
+static qint64 approxBytes(const ExifFileInfo& info)
+{
+    auto stringBytes = [](const QString& s) { return qint64(s.capacity()) * qint64(sizeof(QChar)); };
+    qint64 bytes = sizeof(ExifFileInfo);
+    bytes += stringBytes(info.filePath) + stringBytes(info.fileName) + stringBytes(info.baseName) + stringBytes(info.fileType);
+    for (const QString& group : info.foldedGroups)
+        bytes += qint64(sizeof(QString)) + stringBytes(group);
+    bytes += info.packedEntries.capacity();
+
+    const QVector<TagEntry>& entries = info.isMaterialised() ? info.exifModel->entries() : info.entries;
+    bytes += qint64(entries.capacity()) * qint64(sizeof(TagEntry));
+    for (const TagEntry& e : entries)
+        bytes += stringBytes(e.group) + stringBytes(e.tag) + stringBytes(e.value);
+
+    if (info.isMaterialised()) {
+        //group models hold their own vectors of the shared entries
+        bytes += sizeof(ExifModel) + sizeof(ExifGroupsModel);
+        bytes += qint64(entries.size()) * qint64(sizeof(TagEntry));
+        bytes += qint64(info.exifGroupsModel->rowCount()) * qint64(sizeof(EntryListModel));
+    }
+    return bytes;
+}
+
+qint64 Backend::approxBytesPerFile() const
+{
+    //evenly spaced sample, a tick stays cheap for any session size
+    constexpr int kSamples = 256;
+    const int count = exifList.size();
+    if (count == 0)
+        return 0;
+    const int step = std::max(1, count / kSamples);
+    qint64 total = 0;
+    int sampled = 0;
+    for (int row = 0; row < count; row += step, ++sampled)
+        total += approxBytes(exifList[row]);
+    return total / sampled;
+}
+
+void Backend::updateMetrics()
+{
+    auto latency = [](const char* name) {
+        const Metrics::Histogram& h = Metrics::histogram(name);
+        if (h.count() == 0)
+            return QString("-");
+        return QString("%1 / %2 ms").arg(h.percentileMs(0.5), 0, 'f', 1).arg(h.percentileMs(0.99), 0, 'f', 1);
+    };
+    auto megabytes = [](qint64 bytes) { return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1); };
+
+    const qint64 files = Metrics::counter("import.files").value();
+    const qint64 elapsedMs = m_metricsClock.restart();
+    const double filesPerSecond = elapsedMs > 0 ? (files - m_lastFileCount) * 1000.0 / elapsedMs : 0.0;
+    m_lastFileCount = files;
+    const qint64 resident = Metrics::residentBytes();
+
+    const QVector<QPair<QString, QString>> rows = {
+        { "files/s", QString::number(filesPerSecond, 'f', 1) },
+        { "imported", QString("%1 (%2 failed)").arg(files).arg(Metrics::counter("import.failed").value()) },
+        { "import queue", QString::number(m_importPipeline.pending()) },
+        { "queued sel/vis/nbr/basic/bulk", QString("%1 / %2 / %3 / %4 / %5")
+            .arg(Metrics::gauge("import.queue.selected").value()).arg(Metrics::gauge("import.queue.visible").value())
+            .arg(Metrics::gauge("import.queue.neighbour").value()).arg(Metrics::gauge("import.queue.basic").value())
+            .arg(Metrics::gauge("import.queue.bulk").value()) },
+        { "exiftool p50/p99", latency("exiftool") },
+        { "thumbnail p50/p99", latency("thumbnail") },
+        { "file switch p50/p99", latency("fileSwitch") },
+        { "files / with models", QString("%1 / %2").arg(exifList.size()).arg(m_residentFiles.size()) },
+        { "bytes per file", QString::number(approxBytesPerFile()) },
+        { "process memory", resident >= 0 ? megabytes(resident) : QString("-") },
+    };
+    if (m_metricsOverlay)
+        m_metricsModel.setRows(rows);
+
+    //qInfo is kept in release builds, unlike qDebug
+    if (m_metricsLogSeconds > 0 && ++m_metricsTicks % m_metricsLogSeconds == 0) {
+        QStringList parts;
+        for (const auto& row : rows)
+            parts << row.first + " " + row.second;
+        qInfo().noquote() << "metrics:" << parts.join(", ");
+    }
 }
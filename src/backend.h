@@ -5,10 +5,22 @@
 #include <vector>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QDebug> //only for debug and testing purposes
 
 #include "getExif.h"
 #include "frontEndModels.h"
+#include "folderScanner.h"
+#include "folderWatcher.h"
+#include "importPipeline.h"
+#include "sessionSnapshot.h"
+#include "entryCompressor.h"
+#include "extractionProfile.h"
+#include "sessionExporter.h"
+#include "catalog.h"
+#include "metadataWriter.h"
+#include "renamePlanner.h"
 
 /*
 This file contains the Backend class, which is the communication interface
@@ -20,7 +32,8 @@ Q_INVOKABLE method in Backend class and use it to forward class methods.
 
 /* Backend class definition
 Communication Interface between QML and C++. 
-Storage of all ExifModel objects and other data in vector. 
+Storage of all ExifFileInfo records in a SlotStore (row order + stable FileId). 
+Qt models of a file are built when it is shown and released when it leaves the working set. 
 Load new file by calling loadExifFromFile method. 
 Switch views between loaded files by calling setCurrentIndex method. 
 */
@@ -37,6 +50,22 @@ class Backend : public QObject
 	Q_PROPERTY(SearchField searchField READ searchField WRITE setSearchField NOTIFY searchFieldChanged) //search field
 	Q_PROPERTY(int fileCount READ fileCount NOTIFY fileCountChanged)// read only, number of all files
     Q_PROPERTY(QVariantMap basicInfo READ basicInfo NOTIFY basicInfoChanged) //display basic info in bottom panel
+    Q_PROPERTY(ThumbCacheManager* thumbCache READ thumbCache CONSTANT) //thumbnail cache statistics and maintenance
+    Q_PROPERTY(EntryCompressor* metadataCompression READ metadataCompression CONSTANT) //optional compressed records and statistics
+    Q_PROPERTY(int pendingImports READ pendingImports NOTIFY pendingImportsChanged) //files queued for metadata extraction
+    Q_PROPERTY(bool scanning READ scanning NOTIFY scanningChanged) //folder scan running
+    Q_PROPERTY(bool watchFolders READ watchFolders WRITE setWatchFolders NOTIFY watchFoldersChanged) //live refresh of imported folders and files
+    Q_PROPERTY(QStringList extractionProfiles READ extractionProfiles NOTIFY extractionProfilesChanged) //names, "Full" and "Audit" built in
+    Q_PROPERTY(QString extractionProfile READ extractionProfile WRITE setExtractionProfile NOTIFY extractionProfileChanged) //active profile
+    Q_PROPERTY(bool exporting READ exporting NOTIFY exportingChanged) //session export running
+    Q_PROPERTY(double exportProgress READ exportProgress NOTIFY exportProgressChanged) //0..1 of the running export
+    Q_PROPERTY(int pendingWrites READ pendingWrites NOTIFY pendingWritesChanged) //tag writes queued or running
+    Q_PROPERTY(RenamePreviewModel* renamePreview READ renamePreview CONSTANT) //rows of the last rename plan
+    Q_PROPERTY(bool renaming READ renaming NOTIFY renamingChanged) //rename plan or apply running
+    Q_PROPERTY(bool catalogEnabled READ catalogEnabled NOTIFY catalogEnabledChanged) //SQLite catalog of imported files open
+    Q_PROPERTY(MetricsModel* metrics READ metrics CONSTANT) //name/value rows, refreshed once per second while shown or logged
+    Q_PROPERTY(bool metricsOverlay READ metricsOverlay WRITE setMetricsOverlay NOTIFY metricsOverlayChanged) //overlay visible
+    Q_PROPERTY(bool fileSwitchPending READ fileSwitchPending NOTIFY fileSwitchPendingChanged) //file switched, waiting for the next frame
 
 public:
 	//define the search types
@@ -58,6 +87,10 @@ public:
     FileListModel* fileListModel() { return &m_fileListModel; }//load fileListModel for thumbnail view
 
 	ExifProxyModel* exifProxyModel() { return &m_exifProxyModel; } //load current search result model
+
+    ThumbCacheManager* thumbCache() { return m_fileListModel.cacheManager(); }
+
+    EntryCompressor* metadataCompression() { return &m_entryCompressor; }
 	
 	int currentIndex() const { return m_currentIndex; }//read currentIndex
 
@@ -73,7 +106,81 @@ public:
 
     QVariantMap basicInfo() const;
 
-    Q_INVOKABLE void importFiles(const QList<QUrl>& urls, bool setCurrent = true); //import method for multiple-file list
+    int pendingImports() const { return m_importPipeline.pending(); }
+    bool scanning() const { return m_folderScanner.runningScans() > 0; }
+
+    //import method for multiple-file list, directories are scanned recursively
+    //extraction runs in background, files are appended as their metadata arrives
+    Q_INVOKABLE void importFiles(const QList<QUrl>& urls, bool setCurrent = true);
+
+    //recursive import of media files in a folder, supports QUrl and local path
+    Q_INVOKABLE void importFolder(const QString& folderPath, bool setCurrent = true);
+
+    //stop running folder scans and drop files waiting for extraction
+    Q_INVOKABLE void cancelImport();
+
+    //rows shown in the thumbnail panel, their queued extractions are served before bulk import
+    Q_INVOKABLE void setVisibleRange(int first, int last);
+
+    //time to metadata per priority class (selected, visible, neighbour, bulk): count, averageMs, maxMs
+    Q_INVOKABLE QVariantMap importLatency() const;
+
+    //remove files from the session, only the affected rows are touched
+    Q_INVOKABLE void removeFile(int index);
+    Q_INVOKABLE void removeFiles(const QList<int>& indices);
+
+    //watch mode: new files in imported folders are appended, changed files refreshed in place, deleted files removed
+    bool watchFolders() const { return m_folderWatcher.isEnabled(); }
+    void setWatchFolders(bool enabled);
+
+    //extraction profiles: named group:tag pattern lists, the active one restricts what is read and shown
+    QStringList extractionProfiles() const { return m_profiles.names(); }
+    QString extractionProfile() const { return m_profiles.active(); }
+    void setExtractionProfile(const QString& name);
+    Q_INVOKABLE QStringList extractionProfileTags(const QString& name) const { return m_profiles.profile(name).patterns(); }
+    Q_INVOKABLE bool saveExtractionProfile(const QString& name, const QStringList& patterns);
+    Q_INVOKABLE bool removeExtractionProfile(const QString& name);
+
+    //bulk export of the metadata of all files, streamed by a background writer, see sessionExporter.h
+    //format "csv" (one column per tag), "ndjson" (all entries) or "columnar" (typed binary columns)
+    //columns are "Group:Tag" or tag names, empty: default columns (csv, columnar) or all entries (ndjson)
+    //returns false if the export could not start, exportFinished follows otherwise
+    Q_INVOKABLE bool exportSession(const QString& path, const QString& format, const QStringList& columns = QStringList());
+    Q_INVOKABLE void cancelExport() { m_exporter.cancel(); }
+    bool exporting() const { return m_exporter.isRunning(); }
+    double exportProgress() const;
+
+    //tag editing: tags maps "Group:Tag" or tag names to the new value, an empty value removes the tag
+    //the same edits go to all given files in one exiftool command, the session keeps one exiftool running
+    //afterwards only the edited entries are patched into the records and models, see metadataWriter.h
+    //returns the write id, -1 if there is nothing to write; tagsWritten follows
+    Q_INVOKABLE int writeTags(const QList<int>& indices, const QVariantMap& tags);
+    int pendingWrites() const { return m_metadataWriter.pending(); }
+
+    //batch rename by a file name template over the metadata in the session, see renamePlanner.h
+    //indices: files in {seq} order, empty for all files; the plan fills renamePreview, then renamePlanned
+    //applyRename renames all files of a plan without conflicts or none, then renameApplied
+    Q_INVOKABLE bool planRename(const QString& pattern, const QList<int>& indices = QList<int>(), int firstNumber = 1);
+    Q_INVOKABLE bool applyRename() { return m_renamePlanner.apply(); }
+    Q_INVOKABLE QString checkRenameTemplate(const QString& pattern) const; //error message, empty if valid
+    RenamePreviewModel* renamePreview() { return &m_renamePreview; }
+    bool renaming() const { return m_renamePlanner.isBusy(); }
+
+    //catalog of every imported file across sessions, see catalog.h for the query syntax
+    //results arrive through catalogQueryFinished as {"file", <column>: value ...} maps
+    //load: matching files are added to the session, unchanged ones straight from the catalog
+    //returns the query id, -1 if the catalog is off or the query does not parse
+    Q_INVOKABLE int queryCatalog(const QString& query, const QStringList& columns = QStringList(),
+                                 bool load = false, int limit = 1000);
+    bool catalogEnabled() const { return m_catalog.isOpen(); }
+
+    //runtime metrics: files/s, exiftool, thumbnail and file switch latency, memory per file
+    MetricsModel* metrics() { return &m_metricsModel; }
+    bool metricsOverlay() const { return m_metricsOverlay; }
+    void setMetricsOverlay(bool shown);
+    bool fileSwitchPending() const { return m_switchClock.isValid(); }
+    //called by QML on the first frame after a switch, ends the file switch measurement
+    Q_INVOKABLE void fileSwitchPresented();
 
     Q_INVOKABLE void myFunction(); //for testing purposes
 
@@ -98,9 +205,20 @@ public:
     //reveal source file in its location, adaptive to platform
     Q_INVOKABLE void revealInFileManager(const QString& filePath);
 
-    //clear cache foler of thumbnail images
+    //clear cache foler of thumbnail images, synchronous (used before quitting)
     Q_INVOKABLE bool clearCacheFolder();
 
+    //background cleanup of thumbnail cache: orphan sweep, then quota enforcement
+    Q_INVOKABLE void cleanUpCache();
+
+    //session snapshot: file list, metadata, folds and view positions, default path when empty
+    //metadata of restored files is decoded when first shown
+    Q_INVOKABLE bool saveSession(const QString& path = QString());
+    Q_INVOKABLE bool restoreSession(const QString& path = QString()); //only into an empty session
+    //the app's own Backend restores the default session on start and saves it on quit; set in main()
+    //before QML creates it, so other hosts (benchmarks, tools) never touch the user's session
+    static void setAutoSession(bool enabled) { s_autoSession = enabled; }
+
     //get ExifModel subset of a given group in current ExifModel
     //Q_INVOKABLE ExifModel* getGroupModel(QString groupName) const;
 
@@ -118,11 +236,73 @@ signals:
 	void searchFieldChanged();
 	void fileCountChanged();//notify qml frontend to refresh thumb panel when new file added, currently obsolete
     void basicInfoChanged();
+    void pendingImportsChanged();
+    void scanningChanged();
+    void folderScanFinished(const QString& folderPath, int fileCount);
+    void watchFoldersChanged();
+    void extractionProfilesChanged();
+    void extractionProfileChanged();
+    void exportingChanged();
+    void exportProgressChanged();
+    void exportFinished(bool ok, const QString& path, int fileCount);
+    void pendingWritesChanged();
+    void tagsWritten(int id, int fileCount, const QStringList& failedFiles, const QString& error);
+    void renamingChanged();
+    void renamePlanned(int renameCount, int conflicts);
+    void renameApplied(bool ok, int fileCount, const QString& error);
+    void catalogEnabledChanged();
+    void catalogQueryFinished(int id, const QVariantList& rows, const QString& error);
+    void metricsOverlayChanged();
+    void fileSwitchPendingChanged();
 
 private:
+    //GUI thread end of the import pipeline: build models and append to the session
+    void onBasicExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId);
+    void onFileExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId, bool restricted);
+    //loaded files are collected and appended as one contiguous range at most once per frame
+    void queueLoadedFile(const QString& filePath, QVector<TagEntry> entries, bool setCurrent, bool basicOnly,
+                         bool restricted = false);
+    void flushLoadedFiles(); //one insert, one count and one current index notification per batch
+    void startFolderScan(const QString& localPath, int requestId);
+
+    //watch mode helpers
+    int indexOfPath(const QString& localPath) const; //-1 if not in session, O(1)
+    void refreshFileAt(int index, const QVector<TagEntry>& entries, bool restricted); //models updated in place
+    void completeFileAt(int index, const QVector<TagEntry>& entries, bool restricted); //full pass after the fast pass
+    void removeRowRange(int first, int last); //store, list model and path index, no current index handling
+    void onWatchedFilesChanged(const QStringList& paths, bool removed);
+
+    //working set: Qt models only exist for recently shown files and the neighbours of the current one
+    bool ensureMaterialised(int index); //build from the compact record or the snapshot, no-op if built
+    void releaseModels(int index);
+    void touchWorkingSet(int index); //mark shown, release what fell out, prefetch neighbours
+    void prioritiseAround(int index); //queued extraction of current file and neighbours first
+
+    //metadata of the compact record, from snapshot, compressed payload or plain entries
+    QVector<TagEntry> entriesOf(const ExifFileInfo& info);
+    void storeEntries(ExifFileInfo& info, QVector<TagEntry> entries); //compressed if enabled
+    void clearEntries(ExifFileInfo& info);
+    void detachSnapshot(); //mapping lost: records leave it and their files are extracted again
+    void requeueRestricted(); //profile changed: files read under a restricted one are read again
+    void onCompressionToggled(); //convert existing records
+
+    void onTagsWritten(int id, const QStringList& tags, const QHash<QString, QVector<TagEntry>>& updated,
+                       const QStringList& failed, const QString& error);
+    //entries of some tags replaced after a write or rename, models patched row by row
+    void patchFileAt(int index, const QStringList& tags, const QVector<TagEntry>& fresh);
+    void onRenamePlanned();
+    void onRenameApplied(bool ok, const QVector<QPair<QString, QString>>& renamed, const QString& error);
+    void addToCatalog(const QString& filePath, const QVector<TagEntry>& entries); //full profile reads only
+    void onCatalogQueryFinished(int id, const QVector<Catalog::Match>& matches, const QString& error);
+
+    void updateMetrics(); //rows of the overlay, log line when due
+    void updateMetricsTimer(); //runs while the overlay is shown or logging is on
+    qint64 approxBytesPerFile() const; //sampled estimate over the store
+
 	//Storage of loaded data
-	//do not use QVector, imcompatible with unique_ptr
-	std::vector<ExifFileInfo> exifList; //a big vector to store all ExifFileInfo of current application session
+	//chunked store, records never move, rows for QML and FileId for everything that outlives a row
+	ExifFileStore exifList; //stores all ExifFileInfo of current application session
+    QHash<QString, FileId> m_pathIndex; //clean local path -> file, for watch events and dedup
     FileListModel m_fileListModel;//the FileListModel object
 	ExifProxyModel m_exifProxyModel;//the search result model, always linked to ExifModel of current file
 	QString m_searchKeyword;
@@ -131,4 +311,65 @@ private:
 	//use m_ to avoid confusion with Q_PROPERTY functions
 	int m_currentIndex = -1; //index of current item on display in exifList
 
+    //background import
+    ImportPipeline m_importPipeline;
+    FolderScanner m_folderScanner;
+    int m_nextImportRequest = 0;
+    QSet<int> m_requestsAwaitingCurrent; //import requests whose first arriving file becomes current
+
+    //batched appends of loaded files
+    struct PendingFile {
+        QString filePath;
+        QVector<TagEntry> entries;
+        bool setCurrent = false;
+        bool basicOnly = false; //fast pass result, full metadata follows
+        bool restricted = false; //read under a restricted profile
+    };
+    QVector<PendingFile> m_pendingFiles;
+    QHash<QString, int> m_pendingIndex; //clean path -> position in m_pendingFiles
+    QSet<QString> m_awaitingFullPass; //clean paths listed by the fast pass, their full pass still to come
+    QTimer m_flushTimer;
+    static constexpr int kFlushIntervalMs = 16; //about one frame
+
+    //live refresh of imported folders, re-extraction goes through the pipeline with this request id
+    FolderWatcher m_folderWatcher;
+    static constexpr int kWatchRequest = -1;
+
+    //saved session, stays mapped while restored files have no models
+    SessionSnapshot m_snapshot;
+    QStringList m_importedFolders; //folder roots, watched again after restore
+
+    EntryCompressor m_entryCompressor;
+    ExtractionProfiles m_profiles;
+
+    //files with built models, and the most recently shown ones first
+    QSet<FileId> m_residentFiles;
+    QList<FileId> m_recentFiles;
+    int m_workingSetSize = 16; //ZVIEWER_WORKING_SET
+    static constexpr int kPrefetchRadius = 1;
+    static inline bool s_autoSession = false;
+
+    SessionExporter m_exporter;
+    MetadataWriter m_metadataWriter;
+    RenamePlanner m_renamePlanner; //reads m_snapshot from its threads, declared after it
+    RenamePreviewModel m_renamePreview;
+
+    //catalog queries, columns and whether to load the matches
+    Catalog m_catalog;
+    struct CatalogRequest {
+        QStringList columns;
+        bool load = false;
+    };
+    QHash<int, CatalogRequest> m_catalogRequests;
+
+    //runtime metrics
+    MetricsModel m_metricsModel;
+    QTimer m_metricsTimer;
+    bool m_metricsOverlay = false; //ZVIEWER_METRICS_OVERLAY
+    int m_metricsLogSeconds = 0; //ZVIEWER_METRICS_LOG, 0 = no log line
+    int m_metricsTicks = 0;
+    qint64 m_lastFileCount = 0; //import.files at the previous tick
+    QElapsedTimer m_metricsClock; //since the previous tick
+    QElapsedTimer m_switchClock; //valid from setCurrentIndex until the switch is painted
+
 };
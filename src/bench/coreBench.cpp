@@ -0,0 +1,222 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+
+#include "getExif.h"
+#include "frontEndModels.h"
+#include "thumbImage.h"
+
+/*
+Microbenchmarks of the zviewer_core hot paths on the checked-in synthetic
+corpus (bench/corpus, regenerated by generateCorpus.py):
+parseExifTags, ExifModel::rebuildBasicInfo, ExifGroupsModel::rebuildFromExifModel,
+ExifProxyModel::filterAcceptsRow (one sweep over all rows) and
+QtThumbProvider::makeThumbnail.
+
+Each case is calibrated to at least 20 ms per run, min, median and mean time
+per call over all runs are written as JSON (stdout or --output), so results of
+releases can be compared by scripts. Build with -DZVIEWER_BUILD_BENCHMARKS=ON
+and run zviewer_core_bench [--corpus dir] [--runs n] [--filter text] [--output file].
+*/
+
+struct Stats {
+    int runs = 0;
+    qint64 iterations = 0; //calls per run
+    double minNs = 0.0;
+    double medianNs = 0.0;
+    double meanNs = 0.0;
+};
+
+template <typename Fn>
+static Stats measure(int runs, Fn&& fn)
+{
+    constexpr qint64 kMinRunNs = 20 * 1000 * 1000;
+    Stats s;
+    s.iterations = 1;
+    for (;;) {
+        QElapsedTimer t;
+        t.start();
+        for (qint64 i = 0; i < s.iterations; ++i)
+            fn();
+        if (t.nsecsElapsed() >= kMinRunNs || s.iterations >= (qint64(1) << 24))
+            break;
+        s.iterations *= 2;
+    }
+
+    QVector<double> perCall;
+    for (int r = 0; r < runs; ++r) {
+        QElapsedTimer t;
+        t.start();
+        for (qint64 i = 0; i < s.iterations; ++i)
+            fn();
+        perCall << double(t.nsecsElapsed()) / double(s.iterations);
+    }
+    std::sort(perCall.begin(), perCall.end());
+    s.runs = runs;
+    s.minNs = perCall.front();
+    s.medianNs = perCall.at(perCall.size() / 2);
+    double sum = 0.0;
+    for (double v : perCall)
+        sum += v;
+    s.meanNs = sum / perCall.size();
+    return s;
+}
+
+//filterAcceptsRow is protected, called directly so only the matching is timed
+class ProxyProbe : public ExifProxyModel
+{
+public:
+    using ExifProxyModel::filterAcceptsRow;
+};
+
+static QJsonObject readDump(const QString& path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return QJsonObject();
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+    return doc.isArray() ? doc.array().first().toObject() : doc.object(); //exiftool prints one object per file
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption corpusOption("corpus", "Corpus folder with exif/ and images/.", "dir", ZVIEWER_BENCH_CORPUS);
+    const QCommandLineOption runsOption("runs", "Timed runs per case.", "n", "15");
+    const QCommandLineOption filterOption("filter", "Only cases whose name contains text.", "text");
+    const QCommandLineOption outputOption("output", "Write the JSON report to file instead of stdout.", "file");
+    parser.addOptions({ corpusOption, runsOption, filterOption, outputOption });
+    parser.process(app);
+
+    const QDir corpus(parser.value(corpusOption));
+    const int runs = std::max(1, parser.value(runsOption).toInt());
+    const QString filter = parser.value(filterOption);
+    QTextStream err(stderr);
+
+    QJsonArray results;
+    auto report = [&](const QString& name, const QString& input, const Stats& s, const QJsonObject& extra) {
+        QJsonObject o{
+            { "name", name }, { "input", input },
+            { "runs", s.runs }, { "iterations", s.iterations },
+            { "minNs", s.minNs }, { "medianNs", s.medianNs }, { "meanNs", s.meanNs },
+        };
+        for (auto it = extra.begin(); it != extra.end(); ++it)
+            o.insert(it.key(), it.value());
+        results.append(o);
+        err << name << " [" << input << "] " << QString::number(s.medianNs / 1000.0, 'f', 2) << " us\n";
+        err.flush();
+    };
+    auto selected = [&](const QString& name) { return filter.isEmpty() || name.contains(filter); };
+
+    volatile qint64 sink = 0; //keeps results alive
+
+    const QStringList dumps = QDir(corpus.filePath("exif")).entryList({ "*.json" }, QDir::Files, QDir::Size | QDir::Reversed);
+    if (dumps.isEmpty())
+        err << "no exiftool dumps in " << corpus.filePath("exif") << "\n";
+
+    for (const QString& fileName : dumps) {
+        const QString input = QFileInfo(fileName).completeBaseName();
+        const QJsonObject json = readDump(corpus.filePath("exif/" + fileName));
+        const QVector<TagEntry> entries = parseExifTags(json);
+        const QJsonObject size{ { "entries", int(entries.size()) } };
+
+        if (selected("parseExifTags"))
+            report("parseExifTags", input, measure(runs, [&] { sink = sink + parseExifTags(json).size(); }), size);
+
+        ExifModel model;
+        model.setEntries(entries);
+        model.rebuildBasicInfo();
+        if (selected("ExifModel::rebuildBasicInfo"))
+            report("ExifModel::rebuildBasicInfo", input, measure(runs, [&] { model.rebuildBasicInfo(); }), size);
+
+        if (selected("ExifGroupsModel::rebuildFromExifModel")) {
+            ExifGroupsModel groups;
+            report("ExifGroupsModel::rebuildFromExifModel", input, measure(runs, [&] {
+                groups.rebuildFromExifModel(model);
+                QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete); //previous children, as the event loop would
+                sink = sink + groups.rowCount();
+            }), size);
+        }
+
+        if (selected("ExifProxyModel::filterAcceptsRow")) {
+            ProxyProbe proxy;
+            proxy.setSourceModel(&model);
+            const int rows = model.rowCount(QModelIndex());
+            const QVector<QPair<ExifProxyModel::SearchField, QString>> queries = {
+                { ExifProxyModel::SearchField::Tag, "date" },
+                { ExifProxyModel::SearchField::Value, "auto" },
+            };
+            for (const auto& [field, keyword] : queries) {
+                proxy.setSearchField(field);
+                proxy.setKeyword(keyword);
+                int hits = 0;
+                const Stats s = measure(runs, [&] {
+                    hits = 0;
+                    for (int r = 0; r < rows; ++r)
+                        hits += proxy.filterAcceptsRow(r, QModelIndex()) ? 1 : 0;
+                });
+                const QString label = field == ExifProxyModel::SearchField::Tag ? "tag" : "value";
+                report("ExifProxyModel::filterAcceptsRow", input + "/" + label + ":" + keyword, s,
+                       QJsonObject{ { "rows", rows }, { "hits", hits } });
+            }
+        }
+    }
+
+    if (selected("QtThumbProvider::makeThumbnail")) {
+        QTemporaryDir cacheDir;
+        QtThumbProvider provider;
+        const QSize target(ThumbLevels::TopEdge, ThumbLevels::TopEdge);
+        const QDir images(corpus.filePath("images"));
+        for (const QString& fileName : images.entryList({ "*.png", "*.jpg" }, QDir::Files, QDir::Size | QDir::Reversed)) {
+            const QString path = images.filePath(fileName);
+            const QSize size = QImageReader(path).size();
+            report("QtThumbProvider::makeThumbnail", QFileInfo(fileName).completeBaseName(), measure(runs, [&] {
+                sink = sink + provider.makeThumbnail(path, target, cacheDir.path()).size();
+            }), QJsonObject{ { "width", size.width() }, { "height", size.height() } });
+        }
+    }
+
+    const QJsonObject root{
+        { "benchmark", "zviewer_core_bench" },
+        { "qt", qVersion() },
+#ifdef QT_DEBUG
+        { "build", "debug" },
+#else
+        { "build", "release" },
+#endif
+        { "cpu", QSysInfo::currentCpuArchitecture() },
+        { "os", QSysInfo::prettyProductName() },
+        { "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+        { "results", results },
+    };
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    const QString output = parser.value(outputOption);
+    if (output.isEmpty()) {
+        QFile out;
+        out.open(stdout, QIODevice::WriteOnly);
+        out.write(json);
+    } else {
+        QFile out(output);
+        if (!out.open(QIODevice::WriteOnly)) {
+            err << "cannot write " << output << "\n";
+            return 1;
+        }
+        out.write(json);
+    }
+    return results.isEmpty() ? 1 : 0;
+}
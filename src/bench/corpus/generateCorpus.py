@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Regenerate the synthetic corpus of zviewer_core_bench.
+
+exif/*.json: exiftool -G -a -json style dumps of increasing size, with the
+basic info tags the models look for and filler groups like maker notes.
+images/*.png: gradients with a checker pattern, small on disk but full size to decode.
+
+Output is deterministic (fixed seeds), run from any directory:
+python3 generateCorpus.py
+"""
+
+import json
+import os
+import random
+import struct
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+BASIC = {
+    "File:FileName": "DSC_0001.NEF",
+    "File:FileSize": "48 MB",
+    "Composite:ImageSize": "8256x5504",
+    "EXIF:DateTimeOriginal": "2024:06:01 10:15:30",
+    "EXIF:FNumber": 2.8,
+    "EXIF:ExposureTime": "1/250",
+    "EXIF:ISO": 400,
+    "EXIF:FocalLength": "35.0 mm",
+    "EXIF:Model": "NIKON Z 8",
+    "EXIF:LensModel": "NIKKOR Z 35mm f/1.8 S",
+}
+
+GROUPS = ["File", "EXIF", "MakerNotes", "Composite", "XMP", "ICC_Profile", "IPTC", "QuickTime"]
+WORDS = ["Auto", "Manual", "Normal", "Off", "On", "Standard", "Vivid", "Landscape",
+         "Center-weighted", "Multi-segment", "Single-frame", "AF-S", "Daylight", "sRGB"]
+
+
+def dump(name, tag_count, seed):
+    rnd = random.Random(seed)
+    obj = {"SourceFile": "/corpus/%s.NEF" % name}
+    obj.update(BASIC)
+    i = 0
+    while len(obj) - 1 < tag_count:
+        group = GROUPS[rnd.randrange(len(GROUPS))] if rnd.random() < 0.4 else "MakerNotes"
+        key = "%s:Tag%s%04d" % (group, rnd.choice(WORDS).replace("-", ""), i)
+        i += 1
+        kind = rnd.random()
+        if kind < 0.45:
+            value = " ".join(rnd.choice(WORDS) for _ in range(rnd.randint(1, 4)))
+        elif kind < 0.75:
+            value = round(rnd.uniform(0, 10000), rnd.randint(0, 3))
+        elif kind < 0.85:
+            value = [rnd.randint(0, 255) for _ in range(rnd.randint(2, 8))]
+        elif kind < 0.95:
+            value = "(Binary data %d bytes, use -b option to extract)" % rnd.randint(100, 900000)
+        else:
+            value = "".join(rnd.choice("0123456789abcdef") for _ in range(rnd.randint(64, 512)))
+        obj[key] = value
+    path = os.path.join(HERE, "exif", name + ".json")
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump([obj], f, indent=2, ensure_ascii=False)
+        f.write("\n")
+
+
+def png(name, width, height):
+    rows = bytearray()
+    for y in range(height):
+        g = (y * 255) // max(1, height - 1)
+        line = bytearray()
+        for x in range(width):
+            r = (x * 255) // max(1, width - 1)
+            b = 96 + 64 * (((x >> 4) ^ (y >> 4)) & 1)  # 16 px checker
+            line += bytes((r, g, b))
+        # filter 1 (sub): difference to the pixel on the left
+        rows.append(1)
+        rows += line[:3]
+        rows += bytes((line[i] - line[i - 3]) & 0xff for i in range(3, len(line)))
+
+    def chunk(kind, data):
+        c = kind + data
+        return struct.pack(">I", len(data)) + c + struct.pack(">I", zlib.crc32(c) & 0xffffffff)
+
+    data = b"\x89PNG\r\n\x1a\n"
+    data += chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, 8, 2, 0, 0, 0))
+    data += chunk(b"IDAT", zlib.compress(bytes(rows), 9))
+    data += chunk(b"IEND", b"")
+    with open(os.path.join(HERE, "images", name + ".png"), "wb") as f:
+        f.write(data)
+
+
+def main():
+    os.makedirs(os.path.join(HERE, "exif"), exist_ok=True)
+    os.makedirs(os.path.join(HERE, "images"), exist_ok=True)
+    dump("small", 60, 1)  # phone jpeg
+    dump("medium", 450, 2)  # raw file
+    dump("large", 3000, 3)  # raw with large maker notes and xmp history
+    png("vga", 640, 480)
+    png("12mp", 4000, 3000)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,395 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "extractionProfile.h"
+
+/*
+zviewer_exiftool_standin: local replacement of exiftool for reproducible
+pipeline benchmarks, selected with ZVIEWER_EXIFTOOL=<path of this program>.
+
+It speaks the part of the exiftool command line Z Viewer uses: -json output
+of the given files, tag arguments (-TAG, -GROUP:TAG, -GROUP:all), argument
+files (-@ FILE, "-" for stdin), -common_args, and the -stay_open protocol
+(arguments on stdin, run on -execute[NUM], output followed by {ready[NUM]}),
+-echo[NUM] TEXT and #[CSTR] argument lines. Tag assignments (-TAG=VALUE,
+-GROUP:TAG=VALUE, -TAG= to delete) are remembered per file for the life of
+the process and show in later reads, the files themselves are not touched.
+Other options (-G, -a, -fast2, -charset, -overwrite_original ...) are
+accepted and ignored.
+
+Metadata is replayed from recorded exiftool -json dumps in
+ZVIEWER_STANDIN_RECORDINGS (default: bench/corpus/exif): <file name>.json if
+recorded, otherwise one of the recordings picked by a hash of the path. Files
+must exist, like with exiftool.
+
+Environment:
+ZVIEWER_STANDIN_STARTUP_MS  delay per process start (Perl start up), default 0
+ZVIEWER_STANDIN_LATENCY_MS  delay per file, default 0
+ZVIEWER_STANDIN_FAIL_RATE   share of files reported unreadable, 0..1
+ZVIEWER_STANDIN_CRASH_RATE  share of files that abort the process mid output
+ZVIEWER_STANDIN_HANG_RATE   share of files that never finish, for timeouts
+ZVIEWER_STANDIN_SEED        changes which files fail, crash or hang
+Failures are decided per path, so a rerun fails the same files.
+*/
+
+struct Config {
+    QString recordings;
+    int latencyMs = 0;
+    double failRate = 0.0;
+    double crashRate = 0.0;
+    double hangRate = 0.0;
+    quint32 seed = 0;
+};
+
+static double envRate(const char* name)
+{
+    return std::clamp(qEnvironmentVariable(name).toDouble(), 0.0, 1.0);
+}
+
+//FNV-1a of the path, stable across runs unlike qHash
+static quint32 pathHash(const QString& path, quint32 seed)
+{
+    quint32 h = 2166136261u ^ seed;
+    for (char c : path.toUtf8()) {
+        h ^= uchar(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+//independent draws per failure kind
+static bool hits(const QString& path, const Config& config, quint32 salt, double rate)
+{
+    return rate > 0.0 && double(pathHash(path, config.seed * 31u + salt) % 1000000u) / 1e6 < rate;
+}
+
+class StandIn
+{
+public:
+    explicit StandIn(const Config& config)
+        : m_config(config)
+    {
+        const QDir dir(config.recordings);
+        for (const QString& name : dir.entryList({ "*.json" }, QDir::Files, QDir::Name))
+            m_recordingNames << name;
+    }
+
+    //one exiftool command, returns exit status: 0 all files read, 1 otherwise
+    int run(const QStringList& args)
+    {
+        QStringList files;
+        QStringList patterns;
+        QList<QPair<QString, QString>> assignments; //tag, value
+        QStringList echoAfter[2]; //-echo3 stdout, -echo4 stderr
+        for (int i = 0; i < args.size(); ++i) {
+            const QString& a = args.at(i);
+            if (a == "-charset" || a == "-api" || a == "-d" || a == "-c") {
+                ++i; //option with a value
+            } else if (a.startsWith("-echo", Qt::CaseInsensitive) && i + 1 < args.size()) {
+                const QString text = args.at(++i);
+                const int n = a.mid(5).toInt();
+                if (n >= 3)
+                    echoAfter[n - 3] << text;
+                else
+                    std::fprintf(n == 2 ? stderr : stdout, "%s\n", text.toUtf8().constData());
+            } else if (a.startsWith('-') && a.contains('=')) {
+                const int eq = a.indexOf('=');
+                assignments.append({ a.mid(1, eq - 1), a.mid(eq + 1) });
+            } else if (!a.startsWith('-')) {
+                files << a;
+            } else if (!isFlag(a) && !a.startsWith("--") && a != "-") { //excluded tags are not emulated
+                QString tag = a.mid(1);
+                if (tag.compare("all", Qt::CaseInsensitive) == 0)
+                    tag = "*:*";
+                else if (tag.endsWith(":all", Qt::CaseInsensitive))
+                    tag = tag.left(tag.size() - 3) + "*";
+                patterns << tag;
+            }
+        }
+        if (!assignments.isEmpty()) {
+            const int status = write(files, assignments);
+            printEcho(echoAfter);
+            return status;
+        }
+        const ExtractionProfile tags("args", patterns);
+
+        QJsonArray out;
+        int failed = 0;
+        for (const QString& f : files) {
+            QJsonObject record;
+            if (!read(f, &record)) {
+                ++failed;
+                continue;
+            }
+            if (hits(f, m_config, 2, m_config.crashRate)) {
+                //half a record, as a dying process leaves it
+                std::fputs(QJsonDocument(QJsonArray{ record }).toJson().left(64).constData(), stdout);
+                std::fflush(stdout);
+                std::abort();
+            }
+            if (!tags.isFull()) {
+                for (auto it = record.begin(); it != record.end();) {
+                    const QString key = it.key();
+                    const int colon = key.indexOf(':');
+                    const bool keep = key == "SourceFile"
+                        || tags.matches(colon > 0 ? key.left(colon) : QString(), key.mid(colon + 1));
+                    it = keep ? it + 1 : record.erase(it);
+                }
+            }
+            out.append(record);
+        }
+
+        if (!out.isEmpty())
+            std::fputs(QJsonDocument(out).toJson().constData(), stdout);
+        std::fflush(stdout);
+        if (failed > 0) {
+            std::fprintf(stderr, "%6d files could not be read\n", failed);
+            std::fflush(stderr);
+        }
+        printEcho(echoAfter);
+        return failed > 0 ? 1 : 0;
+    }
+
+private:
+    static bool isFlag(const QString& a)
+    {
+        static const QStringList flags = {
+            "-G", "-G0", "-G1", "-a", "-json", "-j", "-fast", "-fast2", "-n", "-q", "-s", "-struct", "-b", "-l",
+            "-overwrite_original", "-P", "-m",
+        };
+        return flags.contains(a, Qt::CaseInsensitive);
+    }
+
+    static void printEcho(const QStringList (&echoAfter)[2])
+    {
+        for (const QString& text : echoAfter[0])
+            std::fprintf(stdout, "%s\n", text.toUtf8().constData());
+        for (const QString& text : echoAfter[1])
+            std::fprintf(stderr, "%s\n", text.toUtf8().constData());
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+
+    //remember the assignments, reported like exiftool does
+    int write(const QStringList& files, const QList<QPair<QString, QString>>& assignments)
+    {
+        int updated = 0;
+        int failed = 0;
+        for (const QString& f : files) {
+            if (!QFileInfo(f).isFile()) {
+                std::fprintf(stderr, "Error: File not found - %s\n", f.toUtf8().constData());
+                ++failed;
+                continue;
+            }
+            if (m_config.latencyMs > 0)
+                QThread::msleep(m_config.latencyMs);
+            auto& edits = m_edits[QDir::fromNativeSeparators(f)];
+            for (const auto& a : assignments)
+                edits.append(a);
+            ++updated;
+        }
+        std::printf("%5d image files updated\n", updated);
+        if (failed > 0)
+            std::printf("%5d files weren't updated due to errors\n", failed);
+        std::fflush(stdout);
+        return failed > 0 ? 1 : 0;
+    }
+
+    //earlier assignments over the recording, a bare tag replaces it in every group (EXIF if missing)
+    void applyEdits(const QString& path, QJsonObject* record) const
+    {
+        const auto it = m_edits.constFind(QDir::fromNativeSeparators(path));
+        if (it == m_edits.constEnd())
+            return;
+        for (const auto& [tag, value] : *it) {
+            QStringList keys;
+            if (tag.contains(':')) {
+                keys << tag;
+            } else {
+                for (auto k = record->constBegin(); k != record->constEnd(); ++k) {
+                    if (k.key().section(':', 1).compare(tag, Qt::CaseInsensitive) == 0)
+                        keys << k.key();
+                }
+                if (keys.isEmpty())
+                    keys << "EXIF:" + tag;
+            }
+            for (const QString& key : keys) {
+                if (value.isEmpty())
+                    record->remove(key);
+                else
+                    record->insert(key, value);
+            }
+        }
+    }
+
+    bool read(const QString& path, QJsonObject* record)
+    {
+        const QFileInfo fi(path);
+        if (!fi.isFile()) {
+            std::fprintf(stderr, "Error: File not found - %s\n", path.toUtf8().constData());
+            return false;
+        }
+        if (m_config.latencyMs > 0)
+            QThread::msleep(m_config.latencyMs);
+        if (hits(path, m_config, 3, m_config.hangRate)) {
+            for (;;)
+                QThread::sleep(60); //until the caller gives up and kills us
+        }
+        if (hits(path, m_config, 1, m_config.failRate)) {
+            std::fprintf(stderr, "Error: File format error - %s\n", path.toUtf8().constData());
+            return false;
+        }
+
+        *record = recording(fi.fileName() + ".json", path);
+        record->insert("SourceFile", QDir::fromNativeSeparators(path)); //exiftool echoes with forward slashes
+        if (record->contains("File:FileName"))
+            record->insert("File:FileName", fi.fileName());
+        applyEdits(path, record);
+        return true;
+    }
+
+    QJsonObject recording(const QString& name, const QString& path)
+    {
+        QString pick = name;
+        if (!m_recordingNames.contains(pick)) {
+            if (m_recordingNames.isEmpty())
+                return QJsonObject{ { "File:FileName", QFileInfo(path).fileName() } };
+            pick = m_recordingNames.at(int(pathHash(path, 0) % quint32(m_recordingNames.size())));
+        }
+        auto it = m_cache.constFind(pick);
+        if (it == m_cache.constEnd()) {
+            QFile f(QDir(m_config.recordings).filePath(pick));
+            QJsonObject obj;
+            if (f.open(QIODevice::ReadOnly))
+                obj = QJsonDocument::fromJson(f.readAll()).array().first().toObject();
+            it = m_cache.insert(pick, obj);
+        }
+        return it.value();
+    }
+
+    Config m_config;
+    QStringList m_recordingNames;
+    QHash<QString, QJsonObject> m_cache; //parsed recordings by file name
+    QHash<QString, QList<QPair<QString, QString>>> m_edits; //path -> assignments in order
+};
+
+//arguments of an -@ file, one per line
+static QStringList readArgFile(const QString& path)
+{
+    QFile f(path);
+    const bool opened = path == "-" ? f.open(stdin, QIODevice::ReadOnly) : f.open(QIODevice::ReadOnly);
+    QStringList out;
+    if (!opened) {
+        std::fprintf(stderr, "Error opening arg files %s\n", path.toUtf8().constData());
+        return out;
+    }
+    while (!f.atEnd()) {
+        const QString line = QString::fromUtf8(f.readLine()).trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            out << line;
+    }
+    return out;
+}
+
+//#[CSTR] argument lines: \\ \n \r \t \" escapes
+static QString unescapeCString(const QString& s)
+{
+    QString out;
+    for (int i = 0; i < s.size(); ++i) {
+        if (s[i] != '\\' || i + 1 == s.size()) {
+            out += s[i];
+            continue;
+        }
+        const QChar c = s[++i];
+        out += c == 'n' ? QChar('\n') : c == 'r' ? QChar('\r') : c == 't' ? QChar('\t') : c;
+    }
+    return out;
+}
+
+//-stay_open True -@ -: commands on stdin until "-stay_open False"
+static int stayOpen(StandIn& standIn, const QStringList& commonArgs)
+{
+    QFile in;
+    in.open(stdin, QIODevice::ReadOnly);
+    QStringList args;
+    while (true) {
+        const QByteArray raw = in.readLine();
+        if (raw.isEmpty() && in.atEnd())
+            return 0; //stdin closed
+        QString line = QString::fromUtf8(raw).trimmed();
+        if (line.startsWith("#[CSTR]"))
+            line = unescapeCString(line.mid(7));
+        else if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        if (line.startsWith("-execute")) {
+            standIn.run(args + commonArgs);
+            std::printf("{ready%s}\n", line.mid(8).toUtf8().constData());
+            std::fflush(stdout);
+            args.clear();
+        } else if (!args.isEmpty() && args.last() == "-stay_open" && (line == "False" || line == "0")) {
+            return 0;
+        } else {
+            args << line;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    Config config;
+    config.recordings = qEnvironmentVariable("ZVIEWER_STANDIN_RECORDINGS", ZVIEWER_STANDIN_RECORDINGS);
+    config.latencyMs = qEnvironmentVariableIntValue("ZVIEWER_STANDIN_LATENCY_MS");
+    config.failRate = envRate("ZVIEWER_STANDIN_FAIL_RATE");
+    config.crashRate = envRate("ZVIEWER_STANDIN_CRASH_RATE");
+    config.hangRate = envRate("ZVIEWER_STANDIN_HANG_RATE");
+    config.seed = quint32(qEnvironmentVariableIntValue("ZVIEWER_STANDIN_SEED"));
+
+    const int startupMs = qEnvironmentVariableIntValue("ZVIEWER_STANDIN_STARTUP_MS");
+    if (startupMs > 0)
+        QThread::msleep(startupMs);
+
+    //expand argument files and split off -common_args (always last)
+    QStringList args;
+    QStringList commonArgs;
+    bool stayOpenMode = false;
+    bool stdinArgs = false;
+    const QStringList raw = app.arguments().mid(1);
+    for (int i = 0; i < raw.size(); ++i) {
+        const QString& a = raw.at(i);
+        if (a == "-common_args") {
+            commonArgs = raw.mid(i + 1);
+            break;
+        }
+        if (a == "-stay_open" && i + 1 < raw.size()) {
+            const QString v = raw.at(++i);
+            stayOpenMode = v.compare("True", Qt::CaseInsensitive) == 0 || v == "1";
+        } else if (a == "-@" && i + 1 < raw.size()) {
+            const QString file = raw.at(++i);
+            if (file == "-")
+                stdinArgs = true;
+            else
+                args << readArgFile(file);
+        } else {
+            args << a;
+        }
+    }
+
+    StandIn standIn(config);
+    if (stayOpenMode && stdinArgs)
+        return stayOpen(standIn, commonArgs);
+    if (stdinArgs)
+        args << readArgFile("-");
+    return standIn.run(args + commonArgs);
+}
@@ -0,0 +1,165 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+
+#include "importPipeline.h"
+
+/*
+End-to-end import through ImportPipeline and the exiftool process layer,
+against zviewer_exiftool_standin instead of the installed exiftool, so the
+numbers only depend on this code and the configured stand-in latencies.
+A folder of empty files is imported once with a single full pass per file
+and once in two phases (batched fast pass, then full pass). Time to all basic
+info, time to all metadata and throughput are written as JSON.
+
+Build with -DZVIEWER_BUILD_BENCHMARKS=ON and run
+zviewer_import_bench [--files n] [--startup-ms n] [--latency-ms n] [--output file].
+Set ZVIEWER_EXIFTOOL to measure another program, e.g. the real exiftool on
+files of a corpus (--folder).
+*/
+
+struct PassResult {
+    int files = 0;
+    int failed = 0;
+    double basicMs = 0.0; //all files listed (fast pass or full)
+    double fullMs = 0.0; //all metadata read
+};
+
+static PassResult runPass(const QStringList& files, bool twoPhase)
+{
+    ImportPipeline pipeline;
+    pipeline.setTwoPhase(twoPhase);
+
+    PassResult r;
+    int listed = 0;
+    int delivered = 0;
+    QElapsedTimer timer;
+    QEventLoop loop;
+    auto listedOne = [&] {
+        if (++listed == files.size())
+            r.basicMs = timer.nsecsElapsed() / 1e6;
+    };
+    //a single pass lists files without entries first, their basic info comes with the full pass
+    QObject::connect(&pipeline, &ImportPipeline::basicExtracted, &loop,
+        [&](const QString&, const QVector<TagEntry>&, int) {
+            if (twoPhase)
+                listedOne();
+        });
+    QObject::connect(&pipeline, &ImportPipeline::fileExtracted, &loop,
+        [&](const QString&, const QVector<TagEntry>&, int) {
+            ++r.files;
+            if (!twoPhase)
+                listedOne();
+            if (++delivered == files.size())
+                loop.quit();
+        });
+    QObject::connect(&pipeline, &ImportPipeline::fileFailed, &loop, [&](const QString&, int) {
+        ++r.failed;
+        if (!twoPhase)
+            listedOne();
+        if (++delivered == files.size())
+            loop.quit();
+    });
+
+    timer.start();
+    pipeline.enqueueFiles(files, 0);
+    loop.exec();
+    r.fullMs = timer.nsecsElapsed() / 1e6;
+    if (listed < files.size()) //fast pass skipped some files
+        r.basicMs = r.fullMs;
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption filesOption("files", "Number of generated files.", "n", "1000");
+    const QCommandLineOption folderOption("folder", "Import the files of this folder instead of generated ones.", "dir");
+    const QCommandLineOption startupOption("startup-ms", "Stand-in delay per process start.", "n", "150");
+    const QCommandLineOption latencyOption("latency-ms", "Stand-in delay per file.", "n", "5");
+    const QCommandLineOption outputOption("output", "Write the JSON report to file instead of stdout.", "file");
+    parser.addOptions({ filesOption, folderOption, startupOption, latencyOption, outputOption });
+    parser.process(app);
+
+    //before the first exiftool run, the program is resolved once
+    if (!qEnvironmentVariableIsSet("ZVIEWER_EXIFTOOL"))
+        qputenv("ZVIEWER_EXIFTOOL", ZVIEWER_STANDIN_PROGRAM);
+    qputenv("ZVIEWER_STANDIN_STARTUP_MS", parser.value(startupOption).toUtf8());
+    qputenv("ZVIEWER_STANDIN_LATENCY_MS", parser.value(latencyOption).toUtf8());
+    QTextStream err(stderr);
+
+    QTemporaryDir tmp;
+    QStringList files;
+    if (parser.isSet(folderOption)) {
+        const QDir dir(parser.value(folderOption));
+        for (const QString& name : dir.entryList(QDir::Files, QDir::Name))
+            files << dir.filePath(name);
+    } else {
+        const int count = std::max(1, parser.value(filesOption).toInt());
+        for (int i = 0; i < count; ++i) {
+            const QString path = QDir(tmp.path()).filePath(QString("IMG_%1.JPG").arg(i, 5, 10, QChar('0')));
+            QFile f(path);
+            f.open(QIODevice::WriteOnly); //stand-in only needs the file to exist
+            files << path;
+        }
+    }
+    if (files.isEmpty()) {
+        err << "no files to import\n";
+        return 1;
+    }
+
+    QJsonArray results;
+    for (const bool twoPhase : { false, true }) {
+        const PassResult r = runPass(files, twoPhase);
+        const QString name = twoPhase ? "twoPhase" : "singlePass";
+        results.append(QJsonObject{
+            { "name", name },
+            { "files", r.files },
+            { "failed", r.failed },
+            { "basicMs", r.basicMs },
+            { "fullMs", r.fullMs },
+            { "filesPerSecond", r.fullMs > 0.0 ? (r.files + r.failed) / (r.fullMs / 1000.0) : 0.0 },
+        });
+        err << name << ": basic info " << QString::number(r.basicMs, 'f', 0) << " ms, all metadata "
+            << QString::number(r.fullMs, 'f', 0) << " ms, " << r.failed << " failed\n";
+        err.flush();
+    }
+
+    const QJsonObject root{
+        { "benchmark", "zviewer_import_bench" },
+        { "exiftool", qEnvironmentVariable("ZVIEWER_EXIFTOOL") },
+        { "startupMs", parser.value(startupOption).toInt() },
+        { "latencyMs", parser.value(latencyOption).toInt() },
+        { "workers", QThread::idealThreadCount() },
+        { "cpu", QSysInfo::currentCpuArchitecture() },
+        { "os", QSysInfo::prettyProductName() },
+        { "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+        { "results", results },
+    };
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    const QString output = parser.value(outputOption);
+    QFile out(output);
+    const bool opened = output.isEmpty() ? out.open(stdout, QIODevice::WriteOnly) : out.open(QIODevice::WriteOnly);
+    if (!opened) {
+        err << "cannot write " << output << "\n";
+        return 1;
+    }
+    out.write(json);
+    return 0;
+}
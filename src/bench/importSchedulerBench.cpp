@@ -0,0 +1,84 @@
+#include <QCoreApplication>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+#include "importPipeline.h"
+
+/*
+Latency benchmark of the ImportPipeline scheduler. A backlog of bulk files is
+queued with a stand-in extractor of fixed cost (no exiftool needed), then a
+random queued file is promoted to Selected at a fixed interval, as a click
+on a thumbnail would. Time to metadata of the selected files should stay
+around one extraction, independent of the backlog; bulk latency is printed
+for comparison. Build with -DZVIEWER_BUILD_BENCHMARKS=ON and run
+zviewer_import_scheduler_bench [backlog] [extraction ms] [bound ms].
+
+The run fails (exit status 1) if fewer than the sampled number of files were
+selected or the slowest one took longer than the bound, by default three
+extractions (the running one, its own, one of slack) plus 50 ms for timer and
+event loop delivery.
+*/
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    const int backlog = args.size() > 1 ? args.at(1).toInt() : 20000;
+    const int workMs = args.size() > 2 ? args.at(2).toInt() : 5;
+    const int boundMs = args.size() > 3 ? args.at(3).toInt() : 3 * workMs + 50;
+    const int samples = 50;
+    const int clickIntervalMs = 40;
+
+    QTextStream out(stdout);
+    ImportPipeline pipeline;
+    pipeline.setExtractor([workMs](const QString& path, QVector<TagEntry>* entries, const QStringList&) {
+        QThread::msleep(workMs);
+        entries->push_back({ "File", "FileName", path });
+        return true;
+    });
+
+    QStringList paths;
+    paths.reserve(backlog);
+    for (int i = 0; i < backlog; ++i)
+        paths << QString("/bench/IMG_%1.JPG").arg(i, 5, 10, QChar('0'));
+    for (const QString& p : std::as_const(paths))
+        pipeline.enqueue(p, 0);
+
+    QSet<QString> done;
+    QObject::connect(&pipeline, &ImportPipeline::fileExtracted, &app,
+        [&done](const QString& path, const QVector<TagEntry>&, int) { done.insert(path); });
+
+    //click on a file that is still queued, from the back half so it is far behind the bulk work
+    QTimer clicker;
+    clicker.setInterval(clickIntervalMs);
+    QObject::connect(&clicker, &QTimer::timeout, &app, [&] {
+        const ImportPipeline::LatencyStats selected = pipeline.latency(ImportPipeline::Priority::Selected);
+        if (selected.count >= samples || pipeline.pending() == 0) {
+            const ImportPipeline::LatencyStats bulk = pipeline.latency(ImportPipeline::Priority::Bulk);
+            out << "backlog " << backlog << " files, " << QThread::idealThreadCount() << " workers, "
+                << workMs << " ms per file\n";
+            out << "selected\t" << selected.count << " files\tavg " << QString::number(selected.averageMs, 'f', 1)
+                << " ms\tmax " << QString::number(selected.maxMs, 'f', 1) << " ms\n";
+            out << "bulk\t" << bulk.count << " files\tavg " << QString::number(bulk.averageMs, 'f', 1)
+                << " ms\tmax " << QString::number(bulk.maxMs, 'f', 1) << " ms\n";
+            const bool ok = selected.count >= samples && selected.maxMs <= boundMs;
+            out << (ok ? "PASS" : "FAIL") << ": " << selected.count << "/" << samples << " selected files, max "
+                << QString::number(selected.maxMs, 'f', 1) << " ms, bound " << boundMs << " ms\n";
+            out.flush();
+            pipeline.cancel();
+            app.exit(ok ? 0 : 1);
+            return;
+        }
+        for (int attempt = 0; attempt < 16; ++attempt) {
+            const QString& p = paths.at(backlog / 2 + QRandomGenerator::global()->bounded(backlog - backlog / 2));
+            if (!done.contains(p) && pipeline.promote(p, ImportPipeline::Priority::Selected))
+                break;
+        }
+    });
+    clicker.start();
+
+    return app.exec();
+}
@@ -0,0 +1,120 @@
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+
+#include "importPipeline.h"
+#include "extractionProfile.h"
+
+/*
+Throughput of the full import pass with and without an extraction profile.
+Every file of a corpus folder (recursively) is extracted by ImportPipeline with
+the real exiftool, with the full profile and with the given one ("Audit" by
+default, or a saved profile of profiles.json). Files per second, entries per
+file and the speedup are printed. Build with -DZVIEWER_BUILD_BENCHMARKS=ON and
+run zviewer_profile_bench <corpus folder> [profile name] [rounds].
+
+An untimed pass over the whole corpus warms the page cache first, then the
+passes alternate their order every round (full first, then profile first),
+so neither side gains from the cache the other one filled. Times are summed
+over all rounds.
+*/
+
+struct PassResult {
+    int files = 0;
+    qint64 entries = 0;
+    double seconds = 0.0;
+};
+
+static PassResult runPass(const QStringList& files, const ExtractionProfile& profile)
+{
+    ImportPipeline pipeline;
+    pipeline.setTwoPhase(false);
+    pipeline.setProfile(profile);
+
+    PassResult r;
+    int delivered = 0;
+    QEventLoop loop;
+    QObject::connect(&pipeline, &ImportPipeline::fileExtracted, &loop,
+        [&](const QString&, const QVector<TagEntry>& entries, int) {
+            ++r.files;
+            r.entries += entries.size();
+            if (++delivered == files.size())
+                loop.quit();
+        });
+    QObject::connect(&pipeline, &ImportPipeline::fileFailed, &loop, [&](const QString&, int) {
+        if (++delivered == files.size())
+            loop.quit();
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    pipeline.enqueueFiles(files, 0);
+    loop.exec();
+    r.seconds = timer.nsecsElapsed() / 1e9;
+    return r;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+    const QStringList args = app.arguments();
+    if (args.size() < 2) {
+        out << "usage: zviewer_profile_bench <corpus folder> [profile name]\n";
+        return 1;
+    }
+
+    QStringList files;
+    QDirIterator it(args.at(1), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        files << it.next();
+    if (files.isEmpty()) {
+        out << "no files in " << args.at(1) << "\n";
+        return 1;
+    }
+
+    const ExtractionProfiles profiles;
+    const QString name = args.size() > 2 ? args.at(2) : QString("Audit");
+    if (!profiles.contains(name)) {
+        out << "unknown profile " << name << ", known: " << profiles.names().join(", ") << "\n";
+        return 1;
+    }
+
+    const int rounds = args.size() > 3 ? std::max(1, args.at(3).toInt()) : 2;
+    const ExtractionProfile limitedProfile = profiles.profile(name);
+
+    //every file read once before timing, so no pass pays for cold disk reads alone
+    runPass(files, ExtractionProfile());
+
+    PassResult full;
+    PassResult limited;
+    auto add = [](PassResult& sum, const PassResult& r) {
+        sum.files += r.files;
+        sum.entries += r.entries;
+        sum.seconds += r.seconds;
+    };
+    for (int round = 0; round < rounds; ++round) {
+        if (round % 2 == 0) {
+            add(full, runPass(files, ExtractionProfile()));
+            add(limited, runPass(files, limitedProfile));
+        } else {
+            add(limited, runPass(files, limitedProfile));
+            add(full, runPass(files, ExtractionProfile()));
+        }
+    }
+
+    auto print = [&out](const char* label, const PassResult& r) {
+        out << label << "\t" << r.files << " files\t" << QString::number(r.files / r.seconds, 'f', 1)
+            << " files/s\t" << QString::number(double(r.entries) / std::max(1, r.files), 'f', 1) << " entries/file\n";
+    };
+    out << files.size() << " files, " << QThread::idealThreadCount() << " workers, " << rounds << " rounds\n";
+    print("Full", full);
+    print(qPrintable(name), limited);
+    out << "speedup x" << QString::number(full.seconds / limited.seconds, 'f', 2) << "\n";
+    return 0;
+}
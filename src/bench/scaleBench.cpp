@@ -0,0 +1,461 @@
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickWindow>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <memory>
+
+#include "backend.h"
+#include "metrics.h"
+
+/*
+Scale test of a whole session: for each size (1k, 10k and 100k files by
+default) a session of synthetic files is restored into a real Backend, shown
+by a small QML view (file list, grouped info panel and search results) on the
+offscreen platform with the software renderer, and then
+1. restore: session snapshot to a listed and displayed session, files/s
+2. import: --import-files more files read through the folder scanner, the
+   import pipeline and zviewer_exiftool_standin, files/s
+3. file switch: setCurrentIndex to a random file until the next frame is
+   presented (as measured by the app), p50/p99/max
+4. search: keyword and field changes on files with thousands of tags,
+   until the proxy model is filtered, p50/p99/max
+5. peak resident memory of the process so far
+are measured. Metadata comes from the exiftool dumps in bench/corpus, every
+100th file gets the largest one. Files are empty, thumbnail jobs fail fast,
+so the numbers are those of the models and views, not of image decoding.
+
+Results are written as JSON (stdout or --output). The exit status is 1 if a
+budget (--max-rss-mb, --max-switch-ms, --max-search-ms, --min-import-fps,
+0 disables one) is exceeded at any size, 2 if the run itself failed.
+Build with -DZVIEWER_BUILD_BENCHMARKS=ON and run
+zviewer_scale_bench [--sizes 1000,10000,100000] [--output file].
+*/
+
+struct Budgets {
+    double maxRssMb = 0.0;
+    double maxSwitchMs = 0.0; //p99
+    double maxSearchMs = 0.0; //p99
+    double minImportFps = 0.0;
+};
+
+struct LatencyStats {
+    int count = 0;
+    int timedOut = 0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+static LatencyStats summarise(QVector<double> ms, int timedOut)
+{
+    LatencyStats s;
+    s.count = ms.size();
+    s.timedOut = timedOut;
+    if (ms.isEmpty())
+        return s;
+    std::sort(ms.begin(), ms.end());
+    auto at = [&ms](double p) { return ms[std::min<qsizetype>(ms.size() - 1, qsizetype(p * ms.size()))]; };
+    s.p50Ms = at(0.5);
+    s.p99Ms = at(0.99);
+    s.maxMs = ms.last();
+    return s;
+}
+
+static QJsonObject toJson(const LatencyStats& s)
+{
+    return QJsonObject{
+        { "count", s.count },
+        { "timedOut", s.timedOut },
+        { "p50Ms", s.p50Ms },
+        { "p99Ms", s.p99Ms },
+        { "maxMs", s.maxMs },
+    };
+}
+
+//process events until done() or the timeout, false on timeout
+template <typename Done>
+static bool waitUntil(Done&& done, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.elapsed() > timeoutMs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+    return true;
+}
+
+static bool createFiles(const QString& folder, int first, int count)
+{
+    if (!QDir().mkpath(folder))
+        return false;
+    for (int i = first; i < first + count; ++i) {
+        QFile f(QDir(folder).filePath(QString("IMG_%1.JPG").arg(i, 6, 10, QChar('0'))));
+        if (!f.open(QIODevice::WriteOnly))
+            return false;
+    }
+    return true;
+}
+
+//file list, grouped info panel and search results, the parts of Main.qml that scale with the session
+static const char* const kViewQml = R"(
+import QtQuick
+
+Window {
+    id: root
+    required property QtObject backend
+    width: 1280
+    height: 800
+    visible: true
+
+    ListView {
+        id: files
+        width: 320
+        height: parent.height
+        model: root.backend.fileListModel
+        delegate: Rectangle {
+            required property string fileName
+            required property int index
+            width: 320
+            height: 48
+            color: index === root.backend.currentIndex ? "#6f6f6f" : "#424242"
+            Text { anchors.centerIn: parent; text: parent.fileName; color: "#dedede" }
+        }
+    }
+    Connections {
+        target: root.backend
+        function onCurrentIndexChanged() { files.positionViewAtIndex(root.backend.currentIndex, ListView.Contain) }
+    }
+
+    ListView {
+        x: 320
+        width: 560
+        height: parent.height
+        model: root.backend.exifGroupsModel
+        delegate: Column {
+            required property string groupName
+            required property QtObject entriesModel
+            Text { text: parent.groupName; font.bold: true }
+            Repeater {
+                model: parent.entriesModel
+                delegate: Text {
+                    required property string tag
+                    required property string value
+                    text: tag + ": " + value
+                }
+            }
+        }
+    }
+
+    ListView {
+        x: 880
+        width: 400
+        height: parent.height
+        model: root.backend.exifProxyModel
+        delegate: Text {
+            required property string tag
+            required property string value
+            text: tag + "  " + value
+        }
+    }
+}
+)";
+
+struct SizeResult {
+    int files = 0;
+    double restoreMs = 0.0;
+    double restoreFps = 0.0;
+    int imported = 0;
+    int importFailed = 0;
+    double importMs = 0.0;
+    double importFps = 0.0;
+    LatencyStats fileSwitch;
+    LatencyStats search;
+    qint64 residentBytes = -1;
+    qint64 peakResidentBytes = -1;
+    QString error; //run failed, no budgets checked
+};
+
+static SizeResult runSize(int fileCount, int importCount, int switches, const QVector<QVector<TagEntry>>& dumps)
+{
+    SizeResult r;
+    r.files = fileCount;
+    QTemporaryDir tmp;
+    const QString sessionFolder = QDir(tmp.path()).filePath("session");
+    const QString importFolder = QDir(tmp.path()).filePath("import");
+    const QString snapshotPath = QDir(tmp.path()).filePath("session.zvs");
+    if (!tmp.isValid() || !createFiles(sessionFolder, 0, fileCount) || !createFiles(importFolder, fileCount, importCount)) {
+        r.error = "cannot create files";
+        return r;
+    }
+
+    //every 100th file gets the largest dump (search over thousands of tags), the others alternate
+    const QVector<TagEntry>& largest = dumps.last();
+    auto entriesFor = [&](int i) -> const QVector<TagEntry>& {
+        return i % 100 == 0 ? largest : dumps[i % dumps.size()];
+    };
+    const bool written = SessionSnapshot::write(snapshotPath, fileCount,
+        [&](int i) {
+            SessionSnapshot::FileData d;
+            d.filePath = QDir(sessionFolder).filePath(QString("IMG_%1.JPG").arg(i, 6, 10, QChar('0')));
+            d.entries = entriesFor(i);
+            return d;
+        },
+        0, { sessionFolder });
+    if (!written) {
+        r.error = "cannot write session snapshot";
+        return r;
+    }
+
+    auto backend = std::make_unique<Backend>(); //no auto session outside the app, the user's session stays untouched
+
+    QQmlEngine engine;
+    QQmlComponent component(&engine);
+    component.setData(kViewQml, QUrl());
+    std::unique_ptr<QObject> root(component.createWithInitialProperties(
+        { { "backend", QVariant::fromValue<QObject*>(backend.get()) } }));
+    auto* window = qobject_cast<QQuickWindow*>(root.get());
+    if (!window) {
+        r.error = "cannot create view: " + component.errorString();
+        return r;
+    }
+    //frame presented after a switch ends the measurement, as in Main.qml
+    QObject::connect(window, &QQuickWindow::frameSwapped, backend.get(), [b = backend.get()] {
+        if (b->fileSwitchPending())
+            b->fileSwitchPresented();
+    });
+
+    //1. restore, until the restored current file is on screen
+    QElapsedTimer timer;
+    timer.start();
+    if (!backend->restoreSession(snapshotPath) || backend->fileCount() != fileCount) {
+        r.error = "session restore failed";
+        return r;
+    }
+    window->requestUpdate();
+    waitUntil([&] { return !backend->fileSwitchPending(); }, 60000);
+    r.restoreMs = timer.nsecsElapsed() / 1e6;
+    r.restoreFps = r.restoreMs > 0.0 ? fileCount / (r.restoreMs / 1000.0) : 0.0;
+
+    //2. import into the restored session
+    if (importCount > 0) {
+        const qint64 failedBefore = Metrics::counter("import.failed").value();
+        timer.restart();
+        backend->importFolder(importFolder, false);
+        const bool done = waitUntil([&] {
+            const int failed = int(Metrics::counter("import.failed").value() - failedBefore);
+            return !backend->scanning() && backend->pendingImports() == 0
+                && backend->fileCount() + failed >= fileCount + importCount;
+        }, 600000);
+        r.importMs = timer.nsecsElapsed() / 1e6;
+        r.imported = backend->fileCount() - fileCount;
+        r.importFailed = int(Metrics::counter("import.failed").value() - failedBefore);
+        r.importFps = r.importMs > 0.0 ? (r.imported + r.importFailed) / (r.importMs / 1000.0) : 0.0;
+        if (!done) {
+            r.error = "import did not finish";
+            return r;
+        }
+    }
+
+    //3. file switches to random files, fixed seed so runs are comparable
+    QVector<double> switchMs;
+    int switchTimeouts = 0;
+    quint32 seed = 12345;
+    const int total = backend->fileCount();
+    for (int i = 0; i < switches && total > 1; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        int index = int(seed % quint32(total));
+        if (index == backend->currentIndex())
+            index = (index + 1) % total;
+        timer.restart();
+        backend->setCurrentIndex(index);
+        window->requestUpdate();
+        if (waitUntil([&] { return !backend->fileSwitchPending(); }, 1000))
+            switchMs << timer.nsecsElapsed() / 1e6;
+        else
+            ++switchTimeouts;
+    }
+    r.fileSwitch = summarise(switchMs, switchTimeouts);
+
+    //4. search on files with the largest dump
+    QVector<double> searchMs;
+    const QStringList keywords = { "Date", "Model", "Lens", "0", "Exposure", "zz-no-match" };
+    for (int file = 0; file < std::min(fileCount, 1000); file += 100) {
+        backend->setCurrentIndex(file);
+        for (const auto field : { Backend::SearchField::Tag, Backend::SearchField::Value }) {
+            for (const QString& keyword : keywords) {
+                timer.restart();
+                backend->setSearchKeyword(keyword);
+                backend->setSearchField(field);
+                backend->applySearchToProxy();
+                backend->exifProxyModel()->rowCount();
+                searchMs << timer.nsecsElapsed() / 1e6;
+            }
+        }
+        QCoreApplication::processEvents(); //views follow the last result
+    }
+    r.search = summarise(searchMs, 0);
+
+    r.residentBytes = Metrics::residentBytes();
+    r.peakResidentBytes = Metrics::peakResidentBytes();
+    return r;
+}
+
+static QStringList exceededBudgets(const SizeResult& r, const Budgets& b)
+{
+    QStringList exceeded;
+    const double peakMb = r.peakResidentBytes / (1024.0 * 1024.0);
+    if (b.maxRssMb > 0.0 && r.peakResidentBytes >= 0 && peakMb > b.maxRssMb)
+        exceeded << QString("peak RSS %1 MB > %2 MB").arg(peakMb, 0, 'f', 0).arg(b.maxRssMb);
+    if (b.maxSwitchMs > 0.0 && (r.fileSwitch.p99Ms > b.maxSwitchMs || r.fileSwitch.timedOut > 0))
+        exceeded << QString("file switch p99 %1 ms > %2 ms (%3 timed out)")
+                        .arg(r.fileSwitch.p99Ms, 0, 'f', 1).arg(b.maxSwitchMs).arg(r.fileSwitch.timedOut);
+    if (b.maxSearchMs > 0.0 && r.search.p99Ms > b.maxSearchMs)
+        exceeded << QString("search p99 %1 ms > %2 ms").arg(r.search.p99Ms, 0, 'f', 1).arg(b.maxSearchMs);
+    if (b.minImportFps > 0.0 && r.imported + r.importFailed > 0 && r.importFps < b.minImportFps)
+        exceeded << QString("import %1 files/s < %2 files/s").arg(r.importFps, 0, 'f', 1).arg(b.minImportFps);
+    return exceeded;
+}
+
+int main(int argc, char* argv[])
+{
+    //no display needed, software rendering so the frames are real without a GPU
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QQuickWindow::setGraphicsApi(QSGRendererInterface::Software);
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption sizesOption("sizes", "Session sizes, comma separated.", "list", "1000,10000,100000");
+    const QCommandLineOption importOption("import-files", "Files imported into each session.", "n", "1000");
+    const QCommandLineOption switchesOption("switches", "File switches per session.", "n", "200");
+    const QCommandLineOption corpusOption("corpus", "Corpus folder with exif/.", "dir", ZVIEWER_BENCH_CORPUS);
+    const QCommandLineOption rssOption("max-rss-mb", "Budget: peak resident memory.", "mb", "4096");
+    const QCommandLineOption switchOption("max-switch-ms", "Budget: p99 file switch to frame.", "ms", "50");
+    const QCommandLineOption searchOption("max-search-ms", "Budget: p99 search.", "ms", "100");
+    const QCommandLineOption importFpsOption("min-import-fps", "Budget: import throughput.", "files/s", "25");
+    const QCommandLineOption outputOption("output", "Write the JSON report to file instead of stdout.", "file");
+    parser.addOptions({ sizesOption, importOption, switchesOption, corpusOption,
+                        rssOption, switchOption, searchOption, importFpsOption, outputOption });
+    parser.process(app);
+
+    Budgets budgets;
+    budgets.maxRssMb = parser.value(rssOption).toDouble();
+    budgets.maxSwitchMs = parser.value(switchOption).toDouble();
+    budgets.maxSearchMs = parser.value(searchOption).toDouble();
+    budgets.minImportFps = parser.value(importFpsOption).toDouble();
+
+    //imports measure this code, not exiftool start-up
+    if (!qEnvironmentVariableIsSet("ZVIEWER_EXIFTOOL"))
+        qputenv("ZVIEWER_EXIFTOOL", ZVIEWER_STANDIN_PROGRAM);
+    if (!qEnvironmentVariableIsSet("ZVIEWER_STANDIN_STARTUP_MS"))
+        qputenv("ZVIEWER_STANDIN_STARTUP_MS", "0");
+    if (!qEnvironmentVariableIsSet("ZVIEWER_STANDIN_LATENCY_MS"))
+        qputenv("ZVIEWER_STANDIN_LATENCY_MS", "0");
+    QTextStream err(stderr);
+
+    //dumps sorted by tag count, the largest is used for search
+    QVector<QVector<TagEntry>> dumps;
+    const QDir exifDir(QDir(parser.value(corpusOption)).filePath("exif"));
+    for (const QString& name : exifDir.entryList({ "*.json" }, QDir::Files, QDir::Name)) {
+        QFile f(exifDir.filePath(name));
+        if (!f.open(QIODevice::ReadOnly))
+            continue;
+        const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+        const QJsonObject obj = doc.isArray() ? doc.array().first().toObject() : doc.object();
+        const QVector<TagEntry> entries = parseExifTags(obj);
+        if (!entries.isEmpty())
+            dumps << entries;
+    }
+    if (dumps.isEmpty()) {
+        err << "no exiftool dumps in " << exifDir.path() << "\n";
+        return 2;
+    }
+    std::sort(dumps.begin(), dumps.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+    QJsonArray results;
+    bool failed = false;
+    bool overBudget = false;
+    for (const QString& size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const int fileCount = size.trimmed().toInt();
+        if (fileCount <= 0)
+            continue;
+        err << fileCount << " files...\n";
+        err.flush();
+        const SizeResult r = runSize(fileCount, std::max(0, parser.value(importOption).toInt()),
+                                     std::max(0, parser.value(switchesOption).toInt()), dumps);
+        const QStringList exceeded = r.error.isEmpty() ? exceededBudgets(r, budgets) : QStringList();
+        failed = failed || !r.error.isEmpty();
+        overBudget = overBudget || !exceeded.isEmpty();
+
+        results.append(QJsonObject{
+            { "files", r.files },
+            { "restoreMs", r.restoreMs },
+            { "restoreFilesPerSecond", r.restoreFps },
+            { "imported", r.imported },
+            { "importFailed", r.importFailed },
+            { "importMs", r.importMs },
+            { "importFilesPerSecond", r.importFps },
+            { "fileSwitch", toJson(r.fileSwitch) },
+            { "search", toJson(r.search) },
+            { "residentBytes", r.residentBytes },
+            { "peakResidentBytes", r.peakResidentBytes },
+            { "error", r.error },
+            { "budgetsExceeded", QJsonArray::fromStringList(exceeded) },
+        });
+        err << "  restore " << QString::number(r.restoreMs, 'f', 0) << " ms, import "
+            << QString::number(r.importFps, 'f', 0) << " files/s, switch p99 "
+            << QString::number(r.fileSwitch.p99Ms, 'f', 1) << " ms, search p99 "
+            << QString::number(r.search.p99Ms, 'f', 1) << " ms, peak RSS "
+            << r.peakResidentBytes / (1024 * 1024) << " MB\n";
+        if (!r.error.isEmpty())
+            err << "  failed: " << r.error << "\n";
+        for (const QString& e : exceeded)
+            err << "  over budget: " << e << "\n";
+        err.flush();
+    }
+
+    const QJsonObject root{
+        { "benchmark", "zviewer_scale_bench" },
+        { "budgets", QJsonObject{
+            { "maxRssMb", budgets.maxRssMb },
+            { "maxSwitchMs", budgets.maxSwitchMs },
+            { "maxSearchMs", budgets.maxSearchMs },
+            { "minImportFps", budgets.minImportFps },
+        } },
+        { "exiftool", qEnvironmentVariable("ZVIEWER_EXIFTOOL") },
+        { "workers", QThread::idealThreadCount() },
+        { "cpu", QSysInfo::currentCpuArchitecture() },
+        { "os", QSysInfo::prettyProductName() },
+        { "timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate) },
+        { "results", results },
+    };
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    const QString output = parser.value(outputOption);
+    QFile out(output);
+    const bool opened = output.isEmpty() ? out.open(stdout, QIODevice::WriteOnly) : out.open(QIODevice::WriteOnly);
+    if (!opened) {
+        err << "cannot write " << output << "\n";
+        return 2;
+    }
+    out.write(json);
+    return failed ? 2 : (overBudget ? 1 : 0);
+}
@@ -0,0 +1,147 @@
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QImageReader>
+#include <QSize>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+#include <algorithm>
+
+#include "areaScaler.h"
+#include "thumbImage.h"
+
+/*
+Benchmark of AreaScaler against QImage::scaled(Qt::SmoothTransformation).
+Synthetic 24-60 MP inputs are reduced into the thumbnail bound, the best of
+several runs is reported for every available ISA. A second table times the
+decode path of thumbnails on PNG files: QImageReader scaling on its own
+against readThumbImage (full decode, then AreaScaler). Build with
+-DZVIEWER_BUILD_BENCHMARKS=ON and run zviewer_scaler_bench.
+*/
+
+//deterministic noisy gradient, so no code path can shortcut on flat input
+static QImage makeInput(const QSize& size, QImage::Format format)
+{
+    QImage img(size, format);
+    quint32 seed = 0x9e3779b9u;
+    for (int y = 0; y < img.height(); ++y) {
+        uchar* line = img.scanLine(y);
+        const int bytes = img.width() * (img.depth() / 8);
+        for (int i = 0; i < bytes; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            line[i] = uchar(((i + y) & 0xff) ^ (seed >> 28));
+        }
+    }
+    return img;
+}
+
+//best of n runs in milliseconds
+template <typename Fn>
+static double bestOf(int runs, Fn&& fn)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer t;
+        t.start();
+        fn();
+        best = std::min(best, t.nsecsElapsed() / 1e6);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[])
+{
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+
+    QTextStream out(stdout);
+    const QSize bound(300, 200); //FileListModel thumbWidth x thumbHeight
+    const int runs = 3;
+
+    struct Input { const char* name; QSize size; };
+    const QVector<Input> inputs = {
+        { "24MP", QSize(6000, 4000) },
+        { "36MP", QSize(7360, 4912) },
+        { "45MP", QSize(8256, 5504) },
+        { "60MP", QSize(9504, 6336) },
+    };
+    struct Fmt { const char* name; QImage::Format format; };
+    const QVector<Fmt> formats = {
+        { "RGB32", QImage::Format_RGB32 },
+        { "RGB888", QImage::Format_RGB888 },
+        { "ARGB32_PM", QImage::Format_ARGB32_Premultiplied },
+    };
+    const AreaScaler::Isa isas[] = { AreaScaler::Isa::Scalar, AreaScaler::Isa::SSE41, AreaScaler::Isa::AVX2 };
+
+    out << "active ISA: " << AreaScaler::isaName(AreaScaler::activeIsa()) << "\n";
+    out << "input\tformat\tQt smooth ms";
+    for (AreaScaler::Isa isa : isas)
+        out << "\t" << AreaScaler::isaName(isa) << " ms";
+    out << "\tspeedup\n";
+
+    for (const Input& in : inputs) {
+        for (const Fmt& f : formats) {
+            const QImage src = makeInput(in.size, f.format);
+            const QSize fit = AreaScaler::fitSize(src.size(), bound);
+
+            const double qtMs = bestOf(runs, [&] {
+                QImage r = src.scaled(fit, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                Q_UNUSED(r);
+            });
+            out << in.name << "\t" << f.name << "\t" << QString::number(qtMs, 'f', 1);
+
+            double bestMs = 1e30;
+            for (AreaScaler::Isa isa : isas) {
+                if (!AreaScaler::isaSupported(isa)) {
+                    out << "\tn/a";
+                    continue;
+                }
+                AreaScaler::setIsaOverride(isa);
+                const double ms = bestOf(runs, [&] {
+                    QImage r = AreaScaler::downscale(src, bound);
+                    Q_UNUSED(r);
+                });
+                bestMs = std::min(bestMs, ms);
+                out << "\t" << QString::number(ms, 'f', 1);
+            }
+            AreaScaler::setIsaOverride(AreaScaler::Isa::Auto);
+            out << "\tx" << QString::number(qtMs / bestMs, 'f', 1) << "\n";
+            out.flush();
+        }
+    }
+
+    //decode path: the PNG handler accepts a scaled size but decodes in full and smooth scales itself
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "no temporary directory, PNG decode skipped\n";
+        return 0;
+    }
+    out << "\ninput\tQt scaled read ms\treadThumbImage ms\tspeedup\n";
+    for (const Input& in : { inputs.first(), inputs.last() }) {
+        const QString png = QDir(dir.path()).filePath(QString::fromLatin1(in.name) + ".png");
+        if (!makeInput(in.size, QImage::Format_RGB32).save(png, "PNG", 100)) { //100: fastest compression
+            out << in.name << "\twriting PNG failed\n";
+            continue;
+        }
+        const QSize fit = AreaScaler::fitSize(in.size, bound);
+        QSize qtSize, ownSize;
+        const double qtMs = bestOf(runs, [&] {
+            QImageReader reader(png);
+            reader.setScaledSize(fit);
+            qtSize = reader.read().size();
+        });
+        const double ownMs = bestOf(runs, [&] {
+            QImageReader reader(png);
+            ownSize = readThumbImage(reader, bound).size();
+        });
+        out << in.name << "\t" << QString::number(qtMs, 'f', 1) << "\t" << QString::number(ownMs, 'f', 1)
+            << "\tx" << QString::number(qtMs / ownMs, 'f', 1);
+        if (qtSize != ownSize)
+            out << "\tsize differs " << qtSize.width() << "x" << qtSize.height()
+                << " / " << ownSize.width() << "x" << ownSize.height();
+        out << "\n";
+        out.flush();
+    }
+    return 0;
+}
@@ -0,0 +1,537 @@
+#include "catalog.h"
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+
+#ifdef ZVIEWER_CATALOG
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <algorithm>
+
+namespace {
+
+struct Term {
+    enum class Op { Equal, Contains, Greater, GreaterEqual, Less, LessEqual, Text };
+    Op op = Op::Text;
+    QString group; //empty = any group
+    QString tag;
+    QString value;
+    double number = 0.0; //compare operators
+};
+
+//leading number of a value: "2.8", "50.0 mm", "1/200", "2025:06:01 10:00:00"
+bool numericValue(const QString& value, double* out)
+{
+    static const QRegularExpression fraction(R"(^\s*([-+]?\d+(?:\.\d+)?)\s*/\s*(\d+(?:\.\d+)?)\s*$)");
+    static const QRegularExpression leading(R"(^\s*([-+]?\d+(?:\.\d+)?(?:[eE][-+]?\d+)?))");
+    const QRegularExpressionMatch f = fraction.match(value);
+    if (f.hasMatch()) {
+        const double denominator = f.captured(2).toDouble();
+        if (denominator == 0.0)
+            return false;
+        *out = f.captured(1).toDouble() / denominator;
+        return true;
+    }
+    const QRegularExpressionMatch l = leading.match(value);
+    if (!l.hasMatch())
+        return false;
+    *out = l.captured(1).toDouble();
+    return true;
+}
+
+//terms separated by spaces outside quotes, a token that starts with a quote is always text
+bool parseQuery(const QString& text, QVector<Term>* terms, QString* error)
+{
+    static const QRegularExpression filter(R"(^(?:([\w-]+):)?([\w-]+)(>=|<=|=|~|>|<)(.*)$)",
+                                           QRegularExpression::DotMatchesEverythingOption);
+    QVector<QPair<QString, bool>> tokens; //text, starts with a quote
+    QString current;
+    bool quoted = false;
+    bool startsQuoted = false;
+    for (const QChar c : text) {
+        if (c == '"') {
+            if (current.isEmpty() && !quoted)
+                startsQuoted = true;
+            quoted = !quoted;
+        } else if (c.isSpace() && !quoted) {
+            if (!current.isEmpty())
+                tokens.push_back({ current, startsQuoted });
+            current.clear();
+            startsQuoted = false;
+        } else {
+            current += c;
+        }
+    }
+    if (quoted) {
+        *error = "unbalanced quote";
+        return false;
+    }
+    if (!current.isEmpty())
+        tokens.push_back({ current, startsQuoted });
+
+    for (const auto& [token, isPhrase] : tokens) {
+        Term t;
+        const QRegularExpressionMatch m = isPhrase ? QRegularExpressionMatch() : filter.match(token);
+        if (!m.hasMatch()) {
+            t.value = token;
+            terms->push_back(t);
+            continue;
+        }
+        t.group = m.captured(1);
+        t.tag = m.captured(2);
+        t.value = m.captured(4);
+        const QString op = m.captured(3);
+        if (op == "=") t.op = Term::Op::Equal;
+        else if (op == "~") t.op = Term::Op::Contains;
+        else if (op == ">") t.op = Term::Op::Greater;
+        else if (op == ">=") t.op = Term::Op::GreaterEqual;
+        else if (op == "<") t.op = Term::Op::Less;
+        else t.op = Term::Op::LessEqual;
+        if (t.op != Term::Op::Equal && t.op != Term::Op::Contains && !numericValue(t.value, &t.number)) {
+            *error = "not a number: " + token;
+            return false;
+        }
+        terms->push_back(t);
+    }
+    if (terms->isEmpty()) {
+        *error = "empty query";
+        return false;
+    }
+    return true;
+}
+
+QString likePattern(const QString& text)
+{
+    QString escaped = text;
+    escaped.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+    return "%" + escaped + "%";
+}
+
+}
+
+struct Catalog::Worker
+{
+    QString connection;
+    bool hasFts = false;
+    QHash<QString, qint64> tagIds; //"group\ntag" -> tags.id
+
+    QSqlDatabase database() const { return QSqlDatabase::database(connection, false); }
+
+    bool exec(QSqlDatabase& db, const QString& sql)
+    {
+        QSqlQuery q(db);
+        if (q.exec(sql))
+            return true;
+        qWarning() << "Catalog:" << q.lastError().text() << "in" << sql;
+        return false;
+    }
+
+    bool open(const QString& path)
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(path);
+        if (!db.open()) {
+            qWarning() << "Catalog: cannot open" << path << db.lastError().text();
+            return false;
+        }
+        const QStringList schema = {
+            "PRAGMA journal_mode = WAL",
+            "PRAGMA synchronous = NORMAL",
+            "CREATE TABLE IF NOT EXISTS files(id INTEGER PRIMARY KEY, path TEXT NOT NULL UNIQUE,"
+            " size INTEGER, mtime INTEGER, seen INTEGER)",
+            "CREATE TABLE IF NOT EXISTS tags(id INTEGER PRIMARY KEY, grp TEXT NOT NULL, tag TEXT NOT NULL, UNIQUE(grp, tag))",
+            "CREATE INDEX IF NOT EXISTS tags_tag ON tags(tag)",
+            "CREATE TABLE IF NOT EXISTS entries(file_id INTEGER NOT NULL, tag_id INTEGER NOT NULL,"
+            " value TEXT COLLATE NOCASE, numeric_value REAL)",
+            "CREATE INDEX IF NOT EXISTS entries_tag_value ON entries(tag_id, value, file_id)",
+            "CREATE INDEX IF NOT EXISTS entries_tag_numeric ON entries(tag_id, numeric_value, file_id)"
+            " WHERE numeric_value IS NOT NULL",
+            "CREATE INDEX IF NOT EXISTS entries_file ON entries(file_id)",
+            "CREATE VIEW IF NOT EXISTS catalog AS SELECT f.path, t.grp, t.tag, e.value, e.numeric_value"
+            " FROM entries e JOIN files f ON f.id = e.file_id JOIN tags t ON t.id = e.tag_id",
+            "PRAGMA user_version = 1",
+        };
+        for (const QString& sql : schema) {
+            if (!exec(db, sql))
+                return false;
+        }
+        //SQLite builds without FTS5 fall back to LIKE over all values
+        QSqlQuery fts(db);
+        hasFts = fts.exec("CREATE VIRTUAL TABLE IF NOT EXISTS entries_fts USING fts5(body)");
+        if (!hasFts)
+            qWarning() << "Catalog: FTS5 not available, text search scans values";
+        return true;
+    }
+
+    void close()
+    {
+        {
+            QSqlDatabase db = database();
+            if (db.isOpen())
+                db.close();
+        }
+        QSqlDatabase::removeDatabase(connection);
+    }
+
+    qint64 tagId(QSqlQuery& insert, QSqlQuery& select, const QString& group, const QString& tag)
+    {
+        const QString key = group + '\n' + tag;
+        const auto it = tagIds.constFind(key);
+        if (it != tagIds.constEnd())
+            return it.value();
+        insert.bindValue(0, group);
+        insert.bindValue(1, tag);
+        select.bindValue(0, group);
+        select.bindValue(1, tag);
+        if (!insert.exec() || !select.exec() || !select.next())
+            return -1;
+        const qint64 id = select.value(0).toLongLong();
+        select.finish();
+        tagIds.insert(key, id);
+        return id;
+    }
+
+    void write(const QVector<Batch>& batch)
+    {
+        ZV_TRACE_SCOPE("catalog.insert");
+        QSqlDatabase db = database();
+        if (!db.isOpen() || !db.transaction())
+            return;
+
+        QSqlQuery upsert(db), fileId(db), clear(db), clearFts(db), insert(db), insertFts(db), insertTag(db), selectTag(db);
+        QSqlQuery dropFile(db), move(db);
+        upsert.prepare("INSERT INTO files(path, size, mtime, seen) VALUES(?, ?, ?, ?)"
+                       " ON CONFLICT(path) DO UPDATE SET size = excluded.size, mtime = excluded.mtime, seen = excluded.seen");
+        fileId.prepare("SELECT id FROM files WHERE path = ?");
+        clear.prepare("DELETE FROM entries WHERE file_id = ?");
+        clearFts.prepare("DELETE FROM entries_fts WHERE rowid = ?");
+        insert.prepare("INSERT INTO entries(file_id, tag_id, value, numeric_value) VALUES(?, ?, ?, ?)");
+        insertFts.prepare("INSERT INTO entries_fts(rowid, body) VALUES(?, ?)");
+        insertTag.prepare("INSERT OR IGNORE INTO tags(grp, tag) VALUES(?, ?)");
+        selectTag.prepare("SELECT id FROM tags WHERE grp = ? AND tag = ?");
+        dropFile.prepare("DELETE FROM files WHERE id = ?");
+        move.prepare("UPDATE files SET path = ? WHERE path = ?");
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const QVariant noNumber(QMetaType::fromType<double>());
+        bool ok = true;
+        for (const Batch& b : batch) {
+            if (!b.renames.isEmpty()) {
+                //renamed files first move to a parked path (a line break never starts a path), so swaps work
+                for (int i = 0; ok && i < b.renames.size(); ++i) {
+                    move.bindValue(0, QChar('\n') + b.renames[i].second);
+                    move.bindValue(1, b.renames[i].first);
+                    ok = move.exec();
+                }
+                for (int i = 0; ok && i < b.renames.size(); ++i) {
+                    //rows of a file the rename replaced on disk
+                    fileId.bindValue(0, b.renames[i].second);
+                    ok = fileId.exec();
+                    if (ok && fileId.next()) {
+                        const qint64 id = fileId.value(0).toLongLong();
+                        clear.bindValue(0, id);
+                        clearFts.bindValue(0, id);
+                        dropFile.bindValue(0, id);
+                        ok = clear.exec() && (!hasFts || clearFts.exec()) && dropFile.exec();
+                    }
+                    fileId.finish();
+                    move.bindValue(0, b.renames[i].second);
+                    move.bindValue(1, QChar('\n') + b.renames[i].second);
+                    ok = ok && move.exec();
+                }
+                if (!ok)
+                    break;
+                continue;
+            }
+
+            const QFileInfo fi(b.filePath);
+            upsert.bindValue(0, b.filePath);
+            upsert.bindValue(1, fi.exists() ? fi.size() : qint64(-1));
+            upsert.bindValue(2, fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : qint64(0));
+            upsert.bindValue(3, now);
+            fileId.bindValue(0, b.filePath);
+            ok = upsert.exec() && fileId.exec() && fileId.next();
+            if (!ok)
+                break;
+            const qint64 id = fileId.value(0).toLongLong();
+            fileId.finish();
+
+            clear.bindValue(0, id);
+            clearFts.bindValue(0, id);
+            ok = clear.exec() && (!hasFts || clearFts.exec());
+            QString body;
+            for (int i = 0; ok && i < b.entries.size(); ++i) {
+                const TagEntry& e = b.entries[i];
+                const qint64 tag = tagId(insertTag, selectTag, e.group, e.tag);
+                double number = 0.0;
+                insert.bindValue(0, id);
+                insert.bindValue(1, tag);
+                insert.bindValue(2, e.value);
+                insert.bindValue(3, numericValue(e.value, &number) ? QVariant(number) : noNumber);
+                ok = tag >= 0 && insert.exec();
+                body += e.group + ':' + e.tag + ' ' + e.value + '\n';
+            }
+            if (ok && hasFts) {
+                insertFts.bindValue(0, id);
+                insertFts.bindValue(1, body);
+                ok = insertFts.exec();
+            }
+            if (!ok)
+                break;
+        }
+
+        if (!ok || !db.commit()) {
+            qWarning() << "Catalog: write of" << batch.size() << "files failed:" << db.lastError().text();
+            db.rollback();
+            tagIds.clear(); //ids of rolled back tags are gone
+        }
+    }
+
+    QVector<Match> run(const QVector<Term>& terms, const QStringList& columns, int limit, bool withEntries, QString* error)
+    {
+        ZV_TRACE_SCOPE("catalog.query");
+        QSqlDatabase db = database();
+        QString sql = "SELECT f.path, f.size, f.mtime, f.id FROM files f WHERE 1";
+        QVariantList binds;
+        QStringList words;
+        for (const Term& t : terms) {
+            if (t.op == Term::Op::Text) {
+                words << t.value;
+                continue;
+            }
+            QString cond = "SELECT e.file_id FROM entries e JOIN tags t ON t.id = e.tag_id WHERE t.tag = ?";
+            binds << t.tag;
+            if (!t.group.isEmpty()) {
+                cond += " AND t.grp = ?";
+                binds << t.group;
+            }
+            switch (t.op) {
+            case Term::Op::Equal: cond += " AND e.value = ?"; binds << t.value; break;
+            case Term::Op::Contains: cond += " AND e.value LIKE ? ESCAPE '\\'"; binds << likePattern(t.value); break;
+            case Term::Op::Greater: cond += " AND e.numeric_value > ?"; binds << t.number; break;
+            case Term::Op::GreaterEqual: cond += " AND e.numeric_value >= ?"; binds << t.number; break;
+            case Term::Op::Less: cond += " AND e.numeric_value < ?"; binds << t.number; break;
+            case Term::Op::LessEqual: cond += " AND e.numeric_value <= ?"; binds << t.number; break;
+            case Term::Op::Text: break;
+            }
+            sql += " AND f.id IN (" + cond + ")";
+        }
+        if (!words.isEmpty() && hasFts) {
+            QStringList phrases;
+            for (QString w : words)
+                phrases << "\"" + w.replace("\"", "\"\"") + "\"";
+            sql += " AND f.id IN (SELECT rowid FROM entries_fts WHERE entries_fts MATCH ?)";
+            binds << phrases.join(' ');
+        } else {
+            for (const QString& w : words) {
+                sql += " AND f.id IN (SELECT file_id FROM entries WHERE value LIKE ? ESCAPE '\\')";
+                binds << likePattern(w);
+            }
+        }
+        sql += " ORDER BY f.path LIMIT ?";
+        binds << limit;
+
+        QSqlQuery q(db);
+        q.setForwardOnly(true);
+        q.prepare(sql);
+        for (int i = 0; i < binds.size(); ++i)
+            q.bindValue(i, binds[i]);
+        if (!q.exec()) {
+            *error = q.lastError().text();
+            return {};
+        }
+
+        QVector<Match> matches;
+        QVector<qint64> ids;
+        while (q.next()) {
+            Match m;
+            m.filePath = q.value(0).toString();
+            m.size = q.value(1).toLongLong();
+            m.mtime = q.value(2).toLongLong();
+            matches << m;
+            ids << q.value(3).toLongLong();
+        }
+        if (columns.isEmpty() && !withEntries)
+            return matches;
+
+        //entries in import order, columns are "Group:Tag" or bare tag names like SessionExporter
+        QSqlQuery entries(db);
+        entries.setForwardOnly(true);
+        entries.prepare("SELECT t.grp, t.tag, e.value FROM entries e JOIN tags t ON t.id = e.tag_id"
+                        " WHERE e.file_id = ? ORDER BY e.rowid");
+        for (int i = 0; i < matches.size(); ++i) {
+            Match& m = matches[i];
+            m.values = QStringList(columns.size());
+            QVector<bool> found(columns.size(), false);
+            entries.bindValue(0, ids[i]);
+            if (!entries.exec()) {
+                *error = entries.lastError().text();
+                return {};
+            }
+            while (entries.next()) {
+                const TagEntry e{ entries.value(0).toString(), entries.value(1).toString(), entries.value(2).toString() };
+                for (int c = 0; c < columns.size(); ++c) {
+                    if (!found[c] && (columns[c] == e.tag || columns[c] == e.group + ':' + e.tag)) {
+                        m.values[c] = e.value;
+                        found[c] = true;
+                    }
+                }
+                if (withEntries)
+                    m.entries << e;
+            }
+        }
+        return matches;
+    }
+};
+
+bool Catalog::isCompiledIn()
+{
+    return true;
+}
+
+Catalog::Catalog(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_pool.setExpiryTimeout(-1); //the connection belongs to this thread
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(1000);
+    connect(&m_flushTimer, &QTimer::timeout, this, &Catalog::flush);
+}
+
+Catalog::~Catalog()
+{
+    flush();
+    if (m_worker) {
+        const std::shared_ptr<Worker> worker = m_worker;
+        m_pool.start([worker] { worker->close(); });
+    }
+    m_pool.waitForDone();
+}
+
+bool Catalog::open(const QString& path)
+{
+    if (m_worker)
+        return m_open; //once per run
+    m_worker = std::make_shared<Worker>();
+    m_worker->connection = QString("zviewer_catalog_%1").arg(quintptr(this));
+    m_open = true;
+    emit openChanged();
+
+    const std::shared_ptr<Worker> worker = m_worker;
+    m_pool.start([this, worker, path] {
+        if (worker->open(path))
+            return;
+        QMetaObject::invokeMethod(this, [this] {
+            m_open = false;
+            m_batch.clear();
+            emit openChanged();
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void Catalog::add(const QString& filePath, const QVector<TagEntry>& entries)
+{
+    if (!m_open)
+        return;
+    m_batch.push_back({ filePath, entries }); //shared with the session, no copy
+    if (m_batch.size() >= kBatchFiles)
+        flush();
+    else if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void Catalog::rename(const QVector<QPair<QString, QString>>& moves)
+{
+    if (!m_open || moves.isEmpty())
+        return;
+    m_batch.push_back({ QString(), {}, moves });
+    if (m_batch.size() >= kBatchFiles)
+        flush();
+    else if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
+
+void Catalog::flush()
+{
+    m_flushTimer.stop();
+    if (m_batch.isEmpty() || !m_worker)
+        return;
+    const QVector<Batch> batch = std::move(m_batch);
+    m_batch = {};
+    const std::shared_ptr<Worker> worker = m_worker;
+    m_pool.start([worker, batch] { worker->write(batch); });
+}
+
+int Catalog::query(const QString& text, const QStringList& columns, int limit, bool withEntries)
+{
+    if (!m_open)
+        return -1;
+    QVector<Term> terms;
+    QString parseError;
+    if (!parseQuery(text, &terms, &parseError)) {
+        qWarning() << "Catalog: cannot parse query" << text << ":" << parseError;
+        return -1;
+    }
+    flush(); //files imported so far are found
+
+    const int id = ++m_nextQuery;
+    const std::shared_ptr<Worker> worker = m_worker;
+    m_pool.start([this, worker, terms, columns, limit, withEntries, id] {
+        QString error;
+        const QVector<Match> matches = worker->run(terms, columns, std::max(1, limit), withEntries, &error);
+        QMetaObject::invokeMethod(this, [this, id, matches, error] { emit queryFinished(id, matches, error); },
+                                  Qt::QueuedConnection);
+    });
+    return id;
+}
+
+#else
+
+//stubs without the CMake option ZVIEWER_CATALOG
+struct Catalog::Worker {};
+
+bool Catalog::isCompiledIn()
+{
+    return false;
+}
+
+Catalog::Catalog(QObject* parent)
+    : QObject(parent)
+{
+}
+
+Catalog::~Catalog() = default;
+
+bool Catalog::open(const QString&)
+{
+    return false;
+}
+
+void Catalog::add(const QString&, const QVector<TagEntry>&) {}
+
+void Catalog::rename(const QVector<QPair<QString, QString>>&) {}
+
+void Catalog::flush() {}
+
+int Catalog::query(const QString&, const QStringList&, int, bool)
+{
+    return -1;
+}
+
+#endif // ZVIEWER_CATALOG
+
+QString Catalog::defaultPath()
+{
+    return QCoreApplication::applicationDirPath() + "/cache/catalog.sqlite";
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <memory>
+
+#include "getExif.h"
+
+/*
+This file contains the Catalog class, an optional local SQLite database of
+every file ever imported, kept across sessions and queried by metadata.
+
+1. Compiled in only with the CMake option ZVIEWER_CATALOG (needs Qt6::Sql and
+its bundled SQLite). Without it isCompiledIn() is false, open() and query()
+fail and add() does nothing.
+
+2. Schema, normalised on tag names:
+    files(id, path UNIQUE, size, mtime, seen)
+    tags(id, grp, tag, UNIQUE(grp, tag))
+    entries(file_id, tag_id, value COLLATE NOCASE, numeric_value)
+    entries_fts: FTS5, one document per file ("Group:Tag value" lines)
+    catalog: view (path, grp, tag, value, numeric_value) for ad-hoc SQL
+entries has covering indexes on (tag_id, value, file_id) and
+(tag_id, numeric_value, file_id), so tag filters never read the table.
+numeric_value is the leading number of the value: 2.8 for "2.8", 50 for
+"50.0 mm", 0.005 for "1/200", the year for dates.
+
+3. Imported files are buffered on the GUI thread and written in one
+transaction per 256 files (or after a second), by a single background
+thread that owns the connection. Queries run on the same thread, results
+arrive on the GUI thread through queryFinished.
+Only files read with the full extraction profile are added, so the catalog
+always holds complete metadata and loaded matches can be filtered to any
+profile.
+
+4. Query syntax, terms separated by spaces, all must match:
+    Tag=value, Group:Tag=value    equal, case insensitive
+    Tag~text                       contains
+    Tag>n, Tag>=n, Tag<n, Tag<=n   numeric_value compare
+    word, "some phrase"            full text search over all values
+Values with spaces are quoted: LensModel~"RF 24-70" DateTimeOriginal>=2025
+*/
+
+class Catalog : public QObject
+{
+    Q_OBJECT
+
+public:
+    //one matching file, values in the order of the requested columns (empty if missing)
+    struct Match {
+        QString filePath;
+        qint64 size = -1; //when cataloged, to detect changed files
+        qint64 mtime = 0; //ms since epoch
+        QStringList values;
+        QVector<TagEntry> entries; //only if requested
+    };
+
+    explicit Catalog(QObject* parent = nullptr);
+    ~Catalog() override; //pending writes are committed
+
+    static bool isCompiledIn();
+    static QString defaultPath(); //cache/catalog.sqlite next to the session
+
+    //opens or creates the database in background, false if not compiled in
+    bool open(const QString& path);
+    bool isOpen() const { return m_open; }
+
+    //record the metadata of an imported file, replaces what was cataloged for the path
+    void add(const QString& filePath, const QVector<TagEntry>& entries);
+    //files renamed on disk (old, new path): rows move to the new paths, in order with the adds
+    void rename(const QVector<QPair<QString, QString>>& moves);
+    void flush(); //write buffered files now
+
+    //columns as in SessionExporter, "Group:Tag" or tag names
+    //returns the query id, -1 if the catalog is closed or the query does not parse
+    int query(const QString& text, const QStringList& columns, int limit, bool withEntries);
+
+signals:
+    void openChanged();
+    //GUI thread, error is empty on success
+    void queryFinished(int id, const QVector<Catalog::Match>& matches, const QString& error);
+
+private:
+    struct Worker; //connection state, only touched on the catalog thread
+    struct Batch {
+        QString filePath;
+        QVector<TagEntry> entries;
+        QVector<QPair<QString, QString>> renames; //instead of a file, one rename of the session
+    };
+
+    QThreadPool m_pool; //single thread that never expires, SQLite connections are per thread
+    std::shared_ptr<Worker> m_worker;
+    QVector<Batch> m_batch;
+    QTimer m_flushTimer;
+    bool m_open = false;
+    int m_nextQuery = 0;
+
+    static constexpr int kBatchFiles = 256;
+};
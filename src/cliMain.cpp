@@ -0,0 +1,394 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <deque>
+#include <memory>
+
+#include "getExif.h"
+#include "importPipeline.h"
+#include "folderScanner.h"
+#include "extractionProfile.h"
+#include "sessionSnapshot.h"
+#include "entryCompressor.h"
+#include "trace.h"
+
+/*
+zviewer_cli: headless batch mode of the metadata pipeline, no QML and no GUI.
+
+Takes files and folders (scanned recursively, media files only unless --all),
+extracts them with the same ImportPipeline as the app and writes one record
+per file to stdout, as NDJSON or CSV, either all entries or the basic info.
+
+--cache FILE keeps a session snapshot of the results, the same format the app
+restores its session from. Files whose size and modification time did not
+change since the last run are taken from it without running exiftool, so
+nightly runs over large trees only pay for new and changed files. The cache
+records the profile it was written with; a cache of another profile lacks
+tags, its files are read again (a full cache serves every profile).
+
+Results are not held until the end: every kCheckpointFiles files they are
+written to a checkpoint snapshot next to the cache (FILE.partN), which is
+mapped and read back when the cache is rewritten at the end. Memory stays
+bounded by one chunk, and an interrupted run leaves its checkpoints behind;
+the next run takes unchanged files from them like from the cache and
+deletes them once the new cache is written.
+
+Exit status: 0 all files read, 1 at least one file failed, 2 usage error.
+*/
+
+//columns of --basic, in the order of ExifModel::getBasicInfo()
+static const QStringList& basicColumns()
+{
+    static const QStringList t = {
+        "fileName", "fileSize", "imageSize", "dateTaken",
+        "aperture", "shutterSpeed", "iso", "focalLength",
+        "camera", "lensModel", "duration", "frameRate",
+    };
+    return t;
+}
+
+static QByteArray csvField(const QString& s)
+{
+    if (!s.contains(',') && !s.contains('"') && !s.contains('\n') && !s.contains('\r'))
+        return s.toUtf8();
+    QString q = s;
+    q.replace("\"", "\"\"");
+    return "\"" + q.toUtf8() + "\"";
+}
+
+class BatchRunner
+{
+public:
+    struct Options {
+        bool basic = false;
+        bool csv = false;
+        bool allFiles = false;
+        int jobs = 0;
+        QString cachePath;
+        ExtractionProfile profile;
+    };
+
+    explicit BatchRunner(const Options& options)
+        : m_options(options)
+        , m_pipeline(nullptr, options.jobs)
+        , m_window(std::max(64, 16 * std::max(1, options.jobs > 0 ? options.jobs : QThread::idealThreadCount())))
+    {
+        m_pipeline.setTwoPhase(false);
+        m_pipeline.setProfile(options.profile);
+        m_out.open(stdout, QIODevice::WriteOnly);
+
+        QObject::connect(&m_pipeline, &ImportPipeline::fileExtracted, &m_context,
+            [this](const QString& path, const QVector<TagEntry>& entries, int) {
+                --m_inFlight;
+                write(path, entries);
+                remember(path, entries);
+                topUp();
+                finishIfDone();
+            });
+        QObject::connect(&m_pipeline, &ImportPipeline::fileFailed, &m_context, [this](const QString& path, int) {
+            --m_inFlight;
+            ++m_failed;
+            qWarning().noquote() << "failed:" << path;
+            topUp();
+            finishIfDone();
+        });
+        QObject::connect(&m_scanner, &FolderScanner::finished, &m_context, [this] { finishIfDone(); });
+
+        if (!m_options.cachePath.isEmpty()) {
+            openCacheSource(m_options.cachePath);
+            //checkpoints of an interrupted run are newer than the cache, in the order written
+            for (const QString& part : checkpointFiles()) {
+                openCacheSource(part);
+                m_nextCheckpoint = std::max(m_nextCheckpoint, part.section(".part", -1).toInt() + 1);
+            }
+        }
+    }
+
+    void start(const QStringList& inputs)
+    {
+        m_timer.start();
+        if (m_options.csv)
+            m_out.write(m_options.basic ? "file," + basicColumns().join(',').toUtf8() + "\n" : "file,group,tag,value\n");
+
+        FolderScanner::Options scan = FolderScanner::defaultOptions();
+        if (m_options.allFiles)
+            scan.extensions.clear();
+        QStringList files;
+        for (const QString& input : inputs) {
+            const QFileInfo fi(input);
+            if (fi.isDir()) {
+                //sink runs in scanner workers, files are handed to the main thread
+                m_scanner.scan(fi.absoluteFilePath(), scan, [this](const QStringList& found) {
+                    QMetaObject::invokeMethod(&m_context, [this, found] { addFiles(found); }, Qt::QueuedConnection);
+                });
+            } else if (fi.isFile()) {
+                files << fi.absoluteFilePath();
+            } else {
+                ++m_failed;
+                qWarning().noquote() << "not found:" << input;
+            }
+        }
+        addFiles(files);
+        //nothing to wait for
+        QMetaObject::invokeMethod(&m_context, [this] { finishIfDone(); }, Qt::QueuedConnection);
+    }
+
+private:
+    void addFiles(const QStringList& files)
+    {
+        m_backlog.insert(m_backlog.end(), files.cbegin(), files.cend());
+        topUp();
+    }
+
+    //bounded number of files in the pipeline, so millions of files never sit in its queues at once
+    void topUp()
+    {
+        while (m_inFlight < m_window && !m_backlog.empty()) {
+            const QString path = std::move(m_backlog.front());
+            m_backlog.pop_front();
+            QVector<TagEntry> cached;
+            if (fromCache(path, &cached)) {
+                ++m_cacheHits;
+                write(path, cached);
+                remember(path, cached);
+                continue;
+            }
+            ++m_inFlight;
+            m_pipeline.enqueue(path, 0);
+        }
+    }
+
+    //checkpoint files next to the cache, in the order written
+    QStringList checkpointFiles() const
+    {
+        const QFileInfo cache(m_options.cachePath);
+        QStringList parts;
+        for (const QString& name : cache.dir().entryList({ cache.fileName() + ".part*" }, QDir::Files))
+            parts << cache.dir().filePath(name);
+        std::sort(parts.begin(), parts.end(), [](const QString& a, const QString& b) {
+            return a.section(".part", -1).toInt() < b.section(".part", -1).toInt();
+        });
+        return parts;
+    }
+
+    void openCacheSource(const QString& path)
+    {
+        auto snapshot = std::make_unique<SessionSnapshot>();
+        if (!snapshot->open(path))
+            return;
+        const QString cached = snapshot->profile();
+        if (!cached.isEmpty() && cached != m_options.profile.key()) {
+            qInfo().noquote() << path << "was written with profile" << cached.section(':', 0, 0) << "- not used";
+            return;
+        }
+        for (int i = 0; i < snapshot->fileCount(); ++i)
+            m_cacheIndex.insert(snapshot->filePath(i), { snapshot.get(), i });
+        m_sources.push_back(std::move(snapshot));
+    }
+
+    bool fromCache(const QString& path, QVector<TagEntry>* out) const
+    {
+        const auto it = m_cacheIndex.constFind(path);
+        if (it == m_cacheIndex.constEnd())
+            return false;
+        const SessionSnapshot* cache = it.value().first;
+        const int index = it.value().second;
+        if (cache->isPartial(index))
+            return false;
+        const QFileInfo fi(path);
+        if (fi.size() != cache->fileSize(index) || fi.lastModified().toMSecsSinceEpoch() != cache->fileMtime(index))
+            return false; //changed since cached
+        *out = m_options.profile.filter(cache->entries(index));
+        return true;
+    }
+
+    void remember(const QString& path, const QVector<TagEntry>& entries)
+    {
+        ++m_done;
+        if (m_options.cachePath.isEmpty())
+            return;
+        m_results.push_back({ path, m_packer->pack(entries) }); //compressed until the next checkpoint
+        if (int(m_results.size()) >= kCheckpointFiles)
+            checkpoint();
+    }
+
+    //pending results to FILE.partN, mapped for the final cache; a fresh dictionary per chunk
+    void checkpoint()
+    {
+        const QString path = m_options.cachePath + ".part" + QString::number(m_nextCheckpoint++);
+        auto source = [this](int i) {
+            SessionSnapshot::FileData d;
+            d.filePath = m_results[i].first;
+            d.entries = m_packer->unpack(m_results[i].second);
+            return d;
+        };
+        auto snapshot = std::make_unique<SessionSnapshot>();
+        if (!SessionSnapshot::write(path, int(m_results.size()), source, -1, {}, m_options.profile.key())
+            || !snapshot->open(path)) {
+            qWarning().noquote() << "cannot write checkpoint" << path << "- results stay in memory";
+            return;
+        }
+        m_checkpoints.push_back(std::move(snapshot));
+        m_results.clear();
+        m_packer = std::make_unique<EntryCompressor>();
+    }
+
+    void write(const QString& path, const QVector<TagEntry>& entries)
+    {
+        if (m_options.basic) {
+            const QVariantMap info = makeExifModel(entries)->getBasicInfo();
+            if (m_options.csv) {
+                QByteArray line = csvField(path);
+                for (const QString& c : basicColumns())
+                    line += "," + csvField(info.value(c).toString());
+                m_out.write(line + "\n");
+            } else {
+                const QJsonObject o{ { "file", path }, { "basic", QJsonObject::fromVariantMap(info) } };
+                m_out.write(QJsonDocument(o).toJson(QJsonDocument::Compact) + "\n");
+            }
+            return;
+        }
+
+        if (m_options.csv) {
+            const QByteArray file = csvField(path);
+            for (const TagEntry& e : entries)
+                m_out.write(file + "," + csvField(e.group) + "," + csvField(e.tag) + "," + csvField(e.value) + "\n");
+        } else {
+            QJsonArray list;
+            for (const TagEntry& e : entries)
+                list.append(QJsonObject{ { "group", e.group }, { "tag", e.tag }, { "value", e.value } });
+            const QJsonObject o{ { "file", path }, { "entries", list } };
+            m_out.write(QJsonDocument(o).toJson(QJsonDocument::Compact) + "\n");
+        }
+    }
+
+    void finishIfDone()
+    {
+        if (m_finished || m_scanner.runningScans() > 0 || m_inFlight > 0 || !m_backlog.empty())
+            return;
+        m_finished = true;
+        m_out.flush();
+        if (!m_options.cachePath.isEmpty())
+            writeCache();
+
+        qInfo().noquote() << QString("%1 files, %2 failed, %3 from cache, %4 s")
+            .arg(m_done).arg(m_failed).arg(m_cacheHits).arg(m_timer.elapsed() / 1000.0, 0, 'f', 1);
+        QCoreApplication::exit(m_failed > 0 ? 1 : 0);
+    }
+
+    //checkpoints in order, then the results since the last one
+    //same replace-after-unmap sequence as Backend::saveSession
+    void writeCache()
+    {
+        std::vector<int> firsts; //first file index of each checkpoint
+        int total = 0;
+        for (const auto& c : m_checkpoints) {
+            firsts.push_back(total);
+            total += c->fileCount();
+        }
+        const int checkpointed = total;
+        total += int(m_results.size());
+
+        auto source = [&](int i) {
+            SessionSnapshot::FileData d;
+            if (i >= checkpointed) {
+                d.filePath = m_results[i - checkpointed].first;
+                d.entries = m_packer->unpack(m_results[i - checkpointed].second);
+                return d;
+            }
+            const int c = int(std::upper_bound(firsts.cbegin(), firsts.cend(), i) - firsts.cbegin()) - 1;
+            d.filePath = m_checkpoints[c]->filePath(i - firsts[c]);
+            d.entries = m_checkpoints[c]->entries(i - firsts[c]);
+            return d;
+        };
+        const QString written = m_options.cachePath + ".new";
+        if (!SessionSnapshot::write(written, total, source, -1, {}, m_options.profile.key()))
+            return; //checkpoints stay for the next run
+        m_cacheIndex.clear();
+        m_sources.clear();
+        m_checkpoints.clear();
+        if (!SessionSnapshot::replace(written, m_options.cachePath)) {
+            qWarning().noquote() << "cannot replace cache" << m_options.cachePath;
+            return;
+        }
+        for (const QString& part : checkpointFiles())
+            QFile::remove(part);
+    }
+
+    Options m_options;
+    QObject m_context; //receiver of queued calls on the main thread
+    ImportPipeline m_pipeline;
+    FolderScanner m_scanner;
+    QFile m_out;
+    const int m_window;
+
+    std::deque<QString> m_backlog; //discovered, not yet in the pipeline
+    int m_inFlight = 0;
+    qint64 m_done = 0;
+    qint64 m_failed = 0;
+    qint64 m_cacheHits = 0;
+    bool m_finished = false;
+    QElapsedTimer m_timer;
+
+    static constexpr int kCheckpointFiles = 20000;
+
+    std::vector<std::unique_ptr<SessionSnapshot>> m_sources; //cache and checkpoints of an interrupted run
+    QHash<QString, QPair<const SessionSnapshot*, int>> m_cacheIndex; //path -> snapshot and index
+    std::vector<std::unique_ptr<SessionSnapshot>> m_checkpoints; //written by this run
+    int m_nextCheckpoint = 0;
+    std::unique_ptr<EntryCompressor> m_packer = std::make_unique<EntryCompressor>();
+    std::vector<std::pair<QString, QByteArray>> m_results; //since the last checkpoint
+};
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("zviewer_cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Extract metadata of files and folders with exiftool, one record per file on stdout.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Files or folders, folders are scanned recursively.", "paths...");
+    const QCommandLineOption formatOption("format", "Output format: ndjson (default) or csv.", "format", "ndjson");
+    const QCommandLineOption basicOption("basic", "Basic info only (bottom panel fields) instead of all entries.");
+    const QCommandLineOption jobsOption({ "j", "jobs" }, "Number of exiftool workers (default: one per core).", "n", "0");
+    const QCommandLineOption cacheOption("cache", "Metadata cache file, unchanged files are read from it and it is rewritten at the end.", "file");
+    const QCommandLineOption profileOption("profile", "Extraction profile (see profiles.json), default Full.", "name", "Full");
+    const QCommandLineOption allOption("all", "Scan all files in folders, not only media files.");
+    parser.addOptions({ formatOption, basicOption, jobsOption, cacheOption, profileOption, allOption });
+    parser.process(app);
+
+    const QStringList inputs = parser.positionalArguments();
+    const QString format = parser.value(formatOption).toLower();
+    bool jobsOk = false;
+    const int jobs = parser.value(jobsOption).toInt(&jobsOk);
+    const ExtractionProfiles profiles;
+    const QString profileName = parser.value(profileOption);
+    if (inputs.isEmpty() || (format != "ndjson" && format != "csv") || !jobsOk || jobs < 0
+        || !profiles.contains(profileName)) {
+        if (!profiles.contains(profileName))
+            qWarning().noquote() << "unknown profile" << profileName << "- known:" << profiles.names().join(", ");
+        parser.showHelp(2);
+    }
+
+    BatchRunner::Options options;
+    options.basic = parser.isSet(basicOption);
+    options.csv = format == "csv";
+    options.allFiles = parser.isSet(allOption);
+    options.jobs = jobs;
+    options.cachePath = parser.value(cacheOption);
+    options.profile = profiles.profile(profileName);
+
+    BatchRunner runner(options);
+    runner.start(inputs);
+    const int status = app.exec();
+    Trace::writeRequested(); //ZVIEWER_TRACE=<file> in tracing builds
+    return status;
+}
@@ -0,0 +1,189 @@
+#include "entryCompressor.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <cstring>
+
+//values longer than this are rarely repeated (descriptions, binary dumps)
+static constexpr int kMaxDictValueBytes = 32;
+//bound of the candidate value table, it is reset when full
+static constexpr int kMaxValueCandidates = 1 << 16;
+//fast zlib level, decode speed matters more than the last percent
+static constexpr int kZlibLevel = 1;
+
+//payload header in front of the zlib stream
+struct PayloadHeader {
+    quint32 count;
+    quint32 rawBytes;
+};
+
+static void writeVarint(QByteArray& out, quint32 v)
+{
+    while (v >= 0x80) {
+        out.append(char((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+static bool readVarint(const char*& p, const char* end, quint32* v)
+{
+    quint32 result = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        const quint8 b = quint8(*p++);
+        result |= quint32(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+EntryCompressor::EntryCompressor(QObject* parent)
+    : QObject{parent}
+{
+    m_enabled = qEnvironmentVariableIntValue("ZVIEWER_COMPRESS_METADATA") != 0;
+
+    m_notifyTimer.setSingleShot(true);
+    m_notifyTimer.setInterval(250);
+    connect(&m_notifyTimer, &QTimer::timeout, this, &EntryCompressor::statsChanged);
+}
+
+void EntryCompressor::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+    emit enabledChanged();
+}
+
+qint64 EntryCompressor::rawSizeOf(const QVector<TagEntry>& entries)
+{
+    qint64 bytes = 0;
+    for (const TagEntry& e : entries)
+        bytes += (e.group.size() + e.tag.size() + e.value.size()) * qint64(sizeof(QChar));
+    return bytes;
+}
+
+void EntryCompressor::writeString(QByteArray& out, const QString& s, bool isValue)
+{
+    auto it = m_ids.constFind(s);
+    if (it != m_ids.constEnd()) {
+        writeVarint(out, it.value() + 1);
+        return;
+    }
+
+    //training: names always, short values on their second occurrence
+    bool learn = !isValue;
+    if (isValue && s.size() <= kMaxDictValueBytes) {
+        if (m_valueSeen.size() >= kMaxValueCandidates)
+            m_valueSeen.clear();
+        learn = ++m_valueSeen[s] >= 2;
+        if (learn)
+            m_valueSeen.remove(s);
+    }
+    if (learn) {
+        const quint32 id = quint32(m_strings.size());
+        m_strings << s;
+        m_ids.insert(s, id);
+        m_dictionaryBytes += s.size() * qint64(sizeof(QChar));
+        writeVarint(out, id + 1);
+        return;
+    }
+
+    //literal
+    const QByteArray utf8 = s.toUtf8();
+    writeVarint(out, 0);
+    writeVarint(out, quint32(utf8.size()));
+    out.append(utf8);
+}
+
+QString EntryCompressor::readString(const char*& p, const char* end) const
+{
+    quint32 v = 0;
+    if (!readVarint(p, end, &v))
+        return {};
+    if (v > 0)
+        return v - 1 < quint32(m_strings.size()) ? m_strings.at(v - 1) : QString();
+
+    quint32 length = 0;
+    if (!readVarint(p, end, &length) || length > quint32(end - p))
+        return {};
+    const QString s = QString::fromUtf8(p, length);
+    p += length;
+    return s;
+}
+
+QByteArray EntryCompressor::pack(const QVector<TagEntry>& entries)
+{
+    QByteArray tokens;
+    tokens.reserve(entries.size() * 8);
+    for (const TagEntry& e : entries) {
+        writeString(tokens, e.group, false);
+        writeString(tokens, e.tag, false);
+        writeString(tokens, e.value, true);
+    }
+
+    const PayloadHeader header{ quint32(entries.size()), quint32(rawSizeOf(entries)) };
+    QByteArray payload(reinterpret_cast<const char*>(&header), sizeof(header));
+    payload.append(qCompress(tokens, kZlibLevel));
+
+    m_rawBytes += header.rawBytes;
+    m_packedBytes += payload.size();
+    m_notifyTimer.start();
+    return payload;
+}
+
+QVector<TagEntry> EntryCompressor::unpack(const QByteArray& payload)
+{
+    QVector<TagEntry> out;
+    if (payload.size() < qsizetype(sizeof(PayloadHeader)))
+        return out;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    PayloadHeader header;
+    std::memcpy(&header, payload.constData(), sizeof(header));
+    const QByteArray tokens = qUncompress(reinterpret_cast<const uchar*>(payload.constData()) + sizeof(header),
+                                          payload.size() - qsizetype(sizeof(header)));
+    const char* p = tokens.constData();
+    const char* end = p + tokens.size();
+    out.reserve(header.count);
+    for (quint32 i = 0; i < header.count && p < end; ++i) {
+        TagEntry e;
+        e.group = readString(p, end);
+        e.tag = readString(p, end);
+        e.value = readString(p, end);
+        out.push_back(std::move(e));
+    }
+    if (out.size() != qsizetype(header.count))
+        qWarning() << "EntryCompressor: damaged payload," << out.size() << "of" << header.count << "entries";
+
+    ++m_decodes;
+    m_decodeNs += timer.nsecsElapsed();
+    m_notifyTimer.start();
+    return out;
+}
+
+void EntryCompressor::release(const QByteArray& payload)
+{
+    if (payload.size() < qsizetype(sizeof(PayloadHeader)))
+        return;
+    PayloadHeader header;
+    std::memcpy(&header, payload.constData(), sizeof(header));
+    m_rawBytes -= header.rawBytes;
+    m_packedBytes -= payload.size();
+    m_notifyTimer.start();
+}
+
+double EntryCompressor::ratio() const
+{
+    return packedBytes() > 0 ? double(m_rawBytes) / double(packedBytes()) : 0.0;
+}
+
+double EntryCompressor::averageDecodeMs() const
+{
+    return m_decodes > 0 ? double(m_decodeNs) / double(m_decodes) / 1e6 : 0.0;
+}
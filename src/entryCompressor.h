@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "getExif.h"
+
+/*
+This file contains the EntryCompressor class, the optional compressed form of
+the metadata entries kept in the compact per-file records (ExifFileInfo).
+
+1. Exif dumps of one session repeat the same groups, tags and many values.
+Strings are first replaced by ids of a session dictionary, which is trained
+while files are packed: every group and tag, and values up to
+kMaxDictValueBytes once they were seen twice. Small records profit most,
+because the repetition is across files rather than inside one file.
+
+2. The token stream of one file is then compressed with zlib (qCompress).
+LZ4 or zstd are not dependencies of this project; after the dictionary pass
+the stream is short, and zlib at its fastest level keeps decoding cheap.
+
+3. Compression ratio and decode latency are exposed as Q_PROPERTY for the
+About window.
+
+The dictionary only grows, so a packed payload stays decodable for the whole
+session. All methods run on the GUI thread.
+*/
+
+class EntryCompressor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged) //ZVIEWER_COMPRESS_METADATA
+    Q_PROPERTY(qint64 rawBytes READ rawBytes NOTIFY statsChanged) //UTF-16 size of packed entries
+    Q_PROPERTY(qint64 packedBytes READ packedBytes NOTIFY statsChanged) //payloads plus dictionary
+    Q_PROPERTY(double ratio READ ratio NOTIFY statsChanged) //raw / packed, 0 if nothing packed
+    Q_PROPERTY(int dictionarySize READ dictionarySize NOTIFY statsChanged)
+    Q_PROPERTY(qint64 decodes READ decodes NOTIFY statsChanged)
+    Q_PROPERTY(double averageDecodeMs READ averageDecodeMs NOTIFY statsChanged)
+
+public:
+    explicit EntryCompressor(QObject* parent = nullptr);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    //payload of one file, the count is stored to size the output on decode
+    QByteArray pack(const QVector<TagEntry>& entries);
+    QVector<TagEntry> unpack(const QByteArray& payload);
+
+    //payload of a record leaves the session
+    void release(const QByteArray& payload);
+
+    qint64 rawBytes() const { return m_rawBytes; }
+    qint64 packedBytes() const { return m_packedBytes + m_dictionaryBytes; }
+    double ratio() const;
+    int dictionarySize() const { return m_strings.size(); }
+    qint64 decodes() const { return m_decodes; }
+    double averageDecodeMs() const;
+
+signals:
+    void enabledChanged();
+    void statsChanged();
+
+private:
+    void writeString(QByteArray& out, const QString& s, bool isValue);
+    QString readString(const char*& p, const char* end) const;
+    static qint64 rawSizeOf(const QVector<TagEntry>& entries);
+
+    bool m_enabled = false;
+
+    //session dictionary, id = index into m_strings
+    QHash<QString, quint32> m_ids;
+    QStringList m_strings;
+    QHash<QString, int> m_valueSeen; //candidate values, added to the dictionary on second sight
+
+    //statistics
+    qint64 m_rawBytes = 0;
+    qint64 m_packedBytes = 0;
+    qint64 m_dictionaryBytes = 0;
+    qint64 m_decodes = 0;
+    qint64 m_decodeNs = 0;
+    QTimer m_notifyTimer; //coalesces statsChanged
+};
@@ -0,0 +1,114 @@
+#include "exifToolSession.h"
+
+#include <QDeadlineTimer>
+#include <QDebug>
+
+#include "getExif.h"
+#include "trace.h"
+
+ExifToolSession::ExifToolSession(const QString& program)
+    : m_program(program.isEmpty() ? exifToolProgram() : program)
+{
+}
+
+ExifToolSession::~ExifToolSession()
+{
+    stop();
+}
+
+bool ExifToolSession::ensureStarted()
+{
+    if (isRunning())
+        return true;
+    ZV_TRACE_SCOPE("exiftool.spawn");
+    m_process = std::make_unique<QProcess>();
+    m_process->start(m_program, { "-stay_open", "True", "-@", "-" });
+    if (!m_process->waitForStarted()) {
+        qWarning() << "ExifToolSession: failed to run" << m_program;
+        m_process.reset();
+        return false;
+    }
+    return true;
+}
+
+void ExifToolSession::stop()
+{
+    if (!m_process)
+        return;
+    if (m_process->state() == QProcess::Running) {
+        m_process->write("-stay_open\nFalse\n");
+        m_process->closeWriteChannel();
+        if (!m_process->waitForFinished(3000))
+            m_process->kill();
+    }
+    m_process->waitForFinished(1000);
+    m_process.reset();
+}
+
+//one argument per line; line breaks and outer spaces would be lost, C escapes keep them
+QByteArray ExifToolSession::argLine(const QString& arg)
+{
+    const bool plain = !arg.contains('\n') && !arg.contains('\r') && arg.trimmed() == arg;
+    if (plain)
+        return arg.toUtf8() + '\n';
+    QByteArray escaped = "#[CSTR]";
+    for (char c : arg.toUtf8()) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        case '"': escaped += "\\\""; break;
+        default: escaped += c;
+        }
+    }
+    return escaped + '\n';
+}
+
+bool ExifToolSession::execute(const QStringList& args, QByteArray* out, QByteArray* err, int timeoutMs)
+{
+    if (!ensureStarted())
+        return false;
+
+    const int n = ++m_sequence;
+    const QByteArray marker = "{ready" + QByteArray::number(n) + "}";
+    QByteArray command;
+    for (const QString& a : args)
+        command += argLine(a);
+    command += "-echo4\n" + marker + "\n-execute" + QByteArray::number(n) + '\n';
+
+    ZV_TRACE_SCOPE("exiftool.execute");
+    m_process->write(command);
+
+    //wait on the channel still missing its marker, the other one is buffered meanwhile
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    const QDeadlineTimer deadline(timeoutMs);
+    while (true) {
+        stdoutData += m_process->readAllStandardOutput();
+        stderrData += m_process->readAllStandardError();
+        const bool outDone = stdoutData.contains(marker);
+        const bool errDone = stderrData.contains(marker);
+        if (outDone && errDone)
+            break;
+        if (m_process->state() != QProcess::Running) {
+            qWarning() << "ExifToolSession: exiftool quit during command" << n << stderrData.trimmed();
+            m_process.reset();
+            return false;
+        }
+        m_process->setReadChannel(outDone ? QProcess::StandardError : QProcess::StandardOutput);
+        if (!m_process->waitForReadyRead(int(deadline.remainingTime())) && deadline.hasExpired()) {
+            qWarning() << "ExifToolSession: command" << n << "timed out";
+            m_process->kill();
+            m_process->waitForFinished(1000);
+            m_process.reset();
+            return false;
+        }
+    }
+
+    if (out)
+        *out = stdoutData.left(stdoutData.indexOf(marker));
+    if (err)
+        *err = stderrData.left(stderrData.indexOf(marker));
+    return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QByteArray>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <memory>
+
+/*
+This file contains the ExifToolSession class, one exiftool process kept
+running with -stay_open, so a series of commands pays the Perl start up once.
+
+1. Arguments go to the process stdin (-@ -), one per line. Arguments with line
+breaks or surrounding spaces are written as #[CSTR] lines with C escapes.
+
+2. Each command ends with -echo4 {readyN} and -executeN. exiftool prints
+{readyN} on stdout when the command is done, and -echo4 the same on stderr,
+so both outputs are read up to the end of this command and never into the
+next one.
+
+3. Not thread-safe and not a QObject for callers: the process belongs to the
+thread that first runs execute(), which must also destroy the session. A
+command that times out kills the process, the next one starts a new one.
+*/
+
+class ExifToolSession
+{
+public:
+    explicit ExifToolSession(const QString& program = QString()); //empty: exifToolProgram()
+    ~ExifToolSession(); //-stay_open False, killed if it does not quit
+
+    ExifToolSession(const ExifToolSession&) = delete;
+    ExifToolSession& operator=(const ExifToolSession&) = delete;
+
+    //run one command, out and err receive its output without the ready markers
+    //false if exiftool could not start, died or timed out; exiftool errors about files are in err
+    bool execute(const QStringList& args, QByteArray* out, QByteArray* err, int timeoutMs = 120000);
+
+    bool isRunning() const { return m_process && m_process->state() == QProcess::Running; }
+    int commandCount() const { return m_sequence; }
+
+private:
+    bool ensureStarted();
+    void stop();
+    static QByteArray argLine(const QString& arg);
+
+    QString m_program;
+    std::unique_ptr<QProcess> m_process;
+    int m_sequence = 0; //N of -executeN
+};
@@ -0,0 +1,188 @@
+#include "extractionProfile.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+
+//tags of interest for audits: serials, location, copyright and software
+static const QStringList& auditPatterns()
+{
+    static const QStringList t = {
+        "*:SerialNumber", "*:InternalSerialNumber", "*:LensSerialNumber", "*:BodySerialNumber",
+        "*:CameraSerialNumber", "*:OwnerName", "*:Make", "*:Model",
+        "GPS:*", "Composite:GPSPosition",
+        "*:Copyright", "*:Artist", "*:Creator", "*:Rights", "*:CopyrightNotice",
+        "*:Software", "*:CreatorTool", "*:HistorySoftwareAgent",
+        "*:DateTimeOriginal", "*:CreateDate", "*:ModifyDate",
+        "File:FileName",
+    };
+    return t;
+}
+
+static QRegularExpression wildcardMatcher(const QString& part)
+{
+    if (part.isEmpty() || part == "*")
+        return QRegularExpression(); //empty pattern, matches everything
+    //anchored, the whole name has to match
+    return QRegularExpression(QRegularExpression::wildcardToRegularExpression(part),
+                              QRegularExpression::CaseInsensitiveOption);
+}
+
+ExtractionProfile::ExtractionProfile(const QString& name, const QStringList& patterns)
+    : m_name(name)
+{
+    for (QString p : patterns) {
+        p = p.trimmed();
+        if (p.isEmpty())
+            continue;
+        m_patterns << p;
+
+        const int colon = p.indexOf(':');
+        const QString group = colon >= 0 ? p.left(colon) : QString("*");
+        const QString tag = colon >= 0 ? p.mid(colon + 1) : p;
+        m_matchers.push_back({ wildcardMatcher(group), wildcardMatcher(tag) });
+
+        //exiftool syntax: -TAG, -GROUP:TAG, -GROUP:all
+        const QString toolTag = (tag.isEmpty() || tag == "*") ? QString("all") : tag;
+        m_args << ((group == "*") ? "-" + toolTag : "-" + group + ":" + toolTag);
+    }
+    m_args.removeDuplicates();
+}
+
+bool ExtractionProfile::matches(const QString& group, const QString& tag) const
+{
+    if (isFull())
+        return true;
+    auto hit = [](const QRegularExpression& re, const QString& s) {
+        return re.pattern().isEmpty() || re.match(s).hasMatch();
+    };
+    for (const auto& [g, t] : m_matchers) {
+        if (hit(g, group) && hit(t, tag))
+            return true;
+    }
+    return false;
+}
+
+QVector<TagEntry> ExtractionProfile::filter(const QVector<TagEntry>& entries) const
+{
+    if (isFull())
+        return entries;
+    QVector<TagEntry> out;
+    out.reserve(entries.size());
+    for (const TagEntry& e : entries) {
+        if (matches(e.group, e.tag))
+            out.push_back(e);
+    }
+    return out;
+}
+
+ExtractionProfiles::ExtractionProfiles(const QString& filePath)
+    : m_filePath(filePath)
+{
+    m_profiles.insert("Full", ExtractionProfile());
+    m_profiles.insert("Audit", ExtractionProfile("Audit", auditPatterns()));
+    load();
+}
+
+QString ExtractionProfiles::defaultPath()
+{
+    return QCoreApplication::applicationDirPath() + "/profiles.json";
+}
+
+bool ExtractionProfiles::isBuiltIn(const QString& name) const
+{
+    return name == "Full" || name == "Audit";
+}
+
+QStringList ExtractionProfiles::names() const
+{
+    QStringList saved;
+    for (auto it = m_profiles.cbegin(); it != m_profiles.cend(); ++it) {
+        if (!isBuiltIn(it.key()))
+            saved << it.key();
+    }
+    std::sort(saved.begin(), saved.end());
+    return QStringList{ "Full", "Audit" } + saved;
+}
+
+ExtractionProfile ExtractionProfiles::profile(const QString& name) const
+{
+    return m_profiles.value(name, ExtractionProfile());
+}
+
+bool ExtractionProfiles::insert(const QString& name, const QStringList& patterns)
+{
+    const QString n = name.trimmed();
+    if (n.isEmpty() || isBuiltIn(n)) {
+        qWarning() << "ExtractionProfiles: cannot save profile" << name;
+        return false;
+    }
+    m_profiles.insert(n, ExtractionProfile(n, patterns));
+    return save();
+}
+
+bool ExtractionProfiles::remove(const QString& name)
+{
+    if (isBuiltIn(name) || !m_profiles.remove(name))
+        return false;
+    if (m_active == name)
+        m_active = "Full";
+    return save();
+}
+
+void ExtractionProfiles::setActive(const QString& name)
+{
+    if (!m_profiles.contains(name) || m_active == name)
+        return;
+    m_active = name;
+    save();
+}
+
+void ExtractionProfiles::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return; //no saved profiles yet
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (const QJsonValue& v : root.value("profiles").toArray()) {
+        const QJsonObject o = v.toObject();
+        const QString name = o.value("name").toString().trimmed();
+        if (name.isEmpty() || isBuiltIn(name))
+            continue;
+        QStringList patterns;
+        for (const QJsonValue& t : o.value("tags").toArray())
+            patterns << t.toString();
+        m_profiles.insert(name, ExtractionProfile(name, patterns));
+    }
+    const QString active = root.value("active").toString();
+    if (m_profiles.contains(active))
+        m_active = active;
+}
+
+bool ExtractionProfiles::save() const
+{
+    QJsonArray profiles;
+    for (auto it = m_profiles.cbegin(); it != m_profiles.cend(); ++it) {
+        if (isBuiltIn(it.key()))
+            continue;
+        profiles.append(QJsonObject{
+            { "name", it.key() },
+            { "tags", QJsonArray::fromStringList(it.value().patterns()) },
+        });
+    }
+    const QJsonObject root{ { "active", m_active }, { "profiles", profiles } };
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "ExtractionProfiles: cannot write" << m_filePath;
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
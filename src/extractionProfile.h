@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "getExif.h"
+
+/*
+This file contains extraction profiles, named lists of group:tag patterns that
+restrict which metadata is read.
+
+1. ExtractionProfile turns its patterns into exiftool tag arguments, so
+exiftool only reads and prints the requested tags, and into a matcher used to
+filter entries on our side. The matcher is applied to every entry list that
+reaches the models, whether it was just extracted or comes from a saved
+session, so a file shows the same tags from either source.
+
+2. Pattern syntax: "Group:Tag", where either part may be "*" or contain
+wildcards ("*" and "?"), e.g. "GPS:*", "*:SerialNumber", "EXIF:*Serial*".
+A pattern without a colon matches the tag in any group. Matching is case
+insensitive, like exiftool.
+
+3. ExtractionProfiles is the saved set of profiles (profiles.json next to the
+executable, portable like the cache). "Full" (no patterns, everything) and
+"Audit" are built in and cannot be removed.
+*/
+
+class ExtractionProfile
+{
+public:
+    ExtractionProfile() = default; //full profile
+    ExtractionProfile(const QString& name, const QStringList& patterns);
+
+    QString name() const { return m_name; }
+    QStringList patterns() const { return m_patterns; }
+    bool isFull() const { return m_patterns.isEmpty(); }
+    //recorded with saved metadata, empty for the full profile; patterns included so an edited profile differs
+    QString key() const { return isFull() ? QString() : m_name + ":" + m_patterns.join(','); }
+
+    //tag arguments for exiftool, empty for the full profile
+    const QStringList& exifToolArgs() const { return m_args; }
+
+    bool matches(const QString& group, const QString& tag) const;
+    QVector<TagEntry> filter(const QVector<TagEntry>& entries) const; //same list for the full profile
+
+private:
+    QString m_name = "Full";
+    QStringList m_patterns;
+    QStringList m_args;
+    QVector<QPair<QRegularExpression, QRegularExpression>> m_matchers; //group, tag
+};
+
+class ExtractionProfiles
+{
+public:
+    explicit ExtractionProfiles(const QString& filePath = defaultPath());
+
+    static QString defaultPath();
+
+    QStringList names() const; //built-in first, then saved in name order
+    ExtractionProfile profile(const QString& name) const; //full profile for unknown names
+    bool contains(const QString& name) const { return m_profiles.contains(name); }
+    bool isBuiltIn(const QString& name) const;
+
+    //saved profiles, written to the file right away
+    bool insert(const QString& name, const QStringList& patterns);
+    bool remove(const QString& name);
+
+    QString active() const { return m_active; }
+    void setActive(const QString& name);
+
+private:
+    void load();
+    bool save() const;
+
+    QString m_filePath;
+    QHash<QString, ExtractionProfile> m_profiles;
+    QString m_active = "Full";
+};
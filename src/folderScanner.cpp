@@ -0,0 +1,184 @@
+#include "folderScanner.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+//files of one directory are delivered in slices, big camera folders should not wait for a full listing
+static constexpr int kSinkBatch = 256;
+
+//shared state of one scan, owned by the scanner and its workers
+struct FolderScanner::ScanJob {
+    quint64 id = 0;
+    QString root;
+    Options options;
+    Sink sink;
+
+    std::mutex mutex; //guards dirs, active and workersLeft
+    std::condition_variable cv;
+    std::deque<QString> dirs; //directories not listed yet
+    int active = 0; //workers currently listing a directory
+    int workersLeft = 0; //workers not exited yet
+
+    std::atomic<bool> cancelled{ false };
+    std::atomic<int> fileCount{ 0 };
+    std::atomic<int> dirCount{ 0 };
+};
+
+FolderScanner::FolderScanner(QObject* parent)
+    : QObject{parent}
+{
+    //traversal is I/O bound, a few more threads than cores hide directory latency of slow disks
+    m_pool.setMaxThreadCount(std::max(4, QThread::idealThreadCount()));
+}
+
+FolderScanner::~FolderScanner()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+QSet<QString> FolderScanner::mediaExtensions()
+{
+    static const QSet<QString> exts = {
+        //images
+        "jpg", "jpeg", "jpe", "png", "tif", "tiff", "heic", "heif", "hif", "avif", "webp", "gif", "bmp", "jxl",
+        //raw
+        "dng", "nef", "nrw", "cr2", "cr3", "crw", "arw", "srf", "sr2", "raf", "orf", "rw2", "pef", "srw",
+        "x3f", "3fr", "fff", "iiq", "erf", "mef", "mos", "mrw", "rwl", "raw", "gpr",
+        //video
+        "mov", "mp4", "m4v", "mts", "m2ts", "avi", "mkv", "mpg", "mpeg", "mxf", "nev", "crm", "braw", "r3d", "insv", "3gp",
+    };
+    return exts;
+}
+
+FolderScanner::Options FolderScanner::defaultOptions()
+{
+    Options opt;
+    opt.extensions = mediaExtensions();
+    return opt;
+}
+
+quint64 FolderScanner::scan(const QString& root, const Options& options, Sink sink)
+{
+    const QFileInfo rootInfo(root);
+    if (!rootInfo.isDir() || !sink) {
+        qWarning() << "FolderScanner: not a directory:" << root;
+        return 0;
+    }
+
+    auto job = std::make_shared<ScanJob>();
+    job->id = ++m_nextScanId;
+    job->root = rootInfo.absoluteFilePath();
+    job->options = options;
+    job->sink = std::move(sink);
+    job->dirs.push_back(job->root);
+
+    const int workers = options.workers > 0 ? options.workers : m_pool.maxThreadCount();
+    job->workersLeft = workers;
+    m_jobs.insert(job->id, job);
+
+    for (int i = 0; i < workers; ++i)
+        m_pool.start([this, job] { workerLoop(job); });
+
+    qDebug() << "FolderScanner: scan" << job->id << "started," << workers << "workers:" << job->root;
+    return job->id;
+}
+
+void FolderScanner::cancel()
+{
+    for (const auto& job : std::as_const(m_jobs)) {
+        job->cancelled = true;
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->cv.notify_all();
+    }
+}
+
+//worker thread: pop a directory, list it, push sub directories, deliver files
+void FolderScanner::workerLoop(const std::shared_ptr<ScanJob>& job)
+{
+    const Options& opt = job->options;
+
+    QDir::Filters filters = QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::System;
+    if (opt.includeHidden)
+        filters |= QDir::Hidden;
+
+    for (;;) {
+        QString dir;
+        {
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->cv.wait(lock, [&] {
+                return job->cancelled || !job->dirs.empty() || job->active == 0;
+            });
+            if (job->cancelled || job->dirs.empty()) //cancelled, or queue drained and nobody can refill it
+                break;
+            dir = std::move(job->dirs.front());
+            job->dirs.pop_front();
+            ++job->active;
+        }
+
+        QStringList subDirs;
+        QStringList files;
+        QDirIterator it(dir, filters); //not recursive, recursion is spread over the workers
+        while (it.hasNext() && !job->cancelled) {
+            const QFileInfo fi = it.nextFileInfo();
+            if (fi.isDir()) {
+                if (!fi.isSymLink() || opt.followSymlinks)
+                    subDirs << fi.absoluteFilePath();
+                continue;
+            }
+            if (!fi.isFile())
+                continue; //sockets, devices, broken links
+            if (!opt.extensions.isEmpty() && !opt.extensions.contains(fi.suffix().toLower()))
+                continue;
+            files << fi.absoluteFilePath();
+            if (files.size() >= kSinkBatch) {
+                job->fileCount += files.size();
+                job->sink(files);
+                files.clear();
+            }
+        }
+        if (!files.isEmpty() && !job->cancelled) {
+            job->fileCount += files.size();
+            job->sink(files);
+        }
+        ++job->dirCount;
+
+        {
+            std::lock_guard<std::mutex> lock(job->mutex);
+            for (QString& d : subDirs)
+                job->dirs.push_back(std::move(d));
+            --job->active;
+        }
+        job->cv.notify_all();
+    }
+
+    //last worker reports the end of the scan
+    bool last = false;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        last = (--job->workersLeft == 0);
+    }
+    job->cv.notify_all();
+    if (last) {
+        const quint64 id = job->id;
+        QMetaObject::invokeMethod(this, [this, id] { onScanFinished(id); }, Qt::QueuedConnection);
+    }
+}
+
+void FolderScanner::onScanFinished(quint64 scanId)
+{
+    const std::shared_ptr<ScanJob> job = m_jobs.take(scanId);
+    if (!job)
+        return;
+    qDebug() << "FolderScanner: scan" << scanId << (job->cancelled ? "cancelled," : "finished,")
+             << job->fileCount.load() << "files in" << job->dirCount.load() << "directories";
+    emit finished(scanId, job->root, job->fileCount.load(), job->dirCount.load());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+
+/*
+This file contains the FolderScanner class, the parallel recursive directory
+walker used by folder import.
+
+1. One scan runs several workers sharing a queue of directories. A worker
+lists one directory at a time (readdir via QDirIterator), pushes the sub
+directories back into the queue and hands the matching files of that
+directory to the sink right away, so the import pipeline starts extracting
+metadata while the scan is still running.
+
+2. Files are filtered by extension (case insensitive). An empty extension set
+accepts every regular file. Hidden entries and directory symlinks are skipped
+by default, the latter also protects from link loops.
+
+The sink is called from worker threads and must be thread-safe. finished() is
+emitted on the thread of the scanner (GUI thread).
+*/
+
+class FolderScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QSet<QString> extensions; //lower case without dot, empty = all files
+        bool includeHidden = false;
+        bool followSymlinks = false; //directory symlinks only, file symlinks are always listed
+        int workers = 0; //0 = ideal thread count
+    };
+
+    //called from worker threads with the files of one directory
+    using Sink = std::function<void(const QStringList& files)>;
+
+    explicit FolderScanner(QObject* parent = nullptr);
+    ~FolderScanner() override; //cancel running scans and wait
+
+    //start an asynchronous scan of root, returns scan id (0 on invalid root)
+    quint64 scan(const QString& root, const Options& options, Sink sink);
+
+    //stop all running scans, files already delivered are not revoked
+    void cancel();
+
+    int runningScans() const { return static_cast<int>(m_jobs.size()); }
+
+    //image, raw and video formats exiftool can read, matches the import dialog
+    static QSet<QString> mediaExtensions();
+    static Options defaultOptions();
+
+signals:
+    void finished(quint64 scanId, const QString& root, int fileCount, int dirCount);
+
+private:
+    struct ScanJob;
+    void workerLoop(const std::shared_ptr<ScanJob>& job);
+    void onScanFinished(quint64 scanId); //GUI thread
+
+    QThreadPool m_pool;
+    QHash<quint64, std::shared_ptr<ScanJob>> m_jobs; //running scans, GUI thread only
+    quint64 m_nextScanId = 0;
+};
@@ -0,0 +1,514 @@
+#include "folderWatcher.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <deque>
+#include <optional>
+
+//quiet time after the last event before a diff pass
+static constexpr int kDebounceMs = 400;
+//a burst never delays a pass longer than this
+static constexpr qint64 kMaxDelayMs = 3000;
+//files modified more recently than this are probably still being written
+static constexpr qint64 kSettleMs = 1000;
+//per-file watches cost one inotify watch each, large archives rely on directory events
+static constexpr int kMaxFileWatches = 4096;
+
+static qint64 nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+static QString joinPath(const QString& dir, const QString& name)
+{
+    return dir.endsWith(QLatin1Char('/')) ? dir + name : dir + QLatin1Char('/') + name;
+}
+
+FolderWatcher::FolderWatcher(QObject* parent)
+    : QObject{parent}
+{
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMs);
+    connect(&m_debounce, &QTimer::timeout, this, &FolderWatcher::flush);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FolderWatcher::onPathChanged);
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &FolderWatcher::onPathChanged);
+    m_pool.setMaxThreadCount(1);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+FolderWatcher::Stamp FolderWatcher::stampOf(const QString& path)
+{
+    const QFileInfo fi(path);
+    Stamp st;
+    if (fi.exists()) {
+        st.size = fi.size();
+        st.mtime = fi.lastModified().toMSecsSinceEpoch();
+    }
+    return st;
+}
+
+bool FolderWatcher::listDir(const QString& dir, const QSet<QString>& exts, DirSnapshot* files, QStringList* subDirs)
+{
+    if (!QFileInfo(dir).isDir())
+        return false;
+
+    QDirIterator it(dir, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::System);
+    while (it.hasNext()) {
+        const QFileInfo fi = it.nextFileInfo();
+        if (fi.isDir()) {
+            if (!fi.isSymLink() && subDirs)
+                subDirs->push_back(QDir::cleanPath(fi.absoluteFilePath()));
+            continue;
+        }
+        if (!fi.isFile())
+            continue;
+        if (!exts.isEmpty() && !exts.contains(fi.suffix().toLower()))
+            continue;
+        files->insert(fi.fileName(), Stamp{ fi.size(), fi.lastModified().toMSecsSinceEpoch() });
+    }
+    return true;
+}
+
+//breadth first listing of a whole tree, used for new roots and new sub directories
+void FolderWatcher::snapshotTree(const QString& root, const QSet<QString>& exts, DiffResult* out, bool reportAsAdded)
+{
+    std::deque<QString> queue{ root };
+    while (!queue.empty()) {
+        const QString dir = queue.front();
+        queue.pop_front();
+
+        DirSnapshot files;
+        QStringList subDirs;
+        if (!listDir(dir, exts, &files, &subDirs))
+            continue;
+        if (reportAsAdded) {
+            for (auto it = files.constBegin(); it != files.constEnd(); ++it)
+                out->added << joinPath(dir, it.key());
+        }
+        out->snapshots.insert(dir, std::move(files));
+        for (QString& d : subDirs)
+            queue.push_back(std::move(d));
+    }
+}
+
+void FolderWatcher::watchFolder(const QString& root)
+{
+    const QString dir = QDir::cleanPath(QFileInfo(root).absoluteFilePath());
+    if (dir.isEmpty() || m_snapshots.contains(dir))
+        return;
+
+    //baseline in background, events before it lands are diffed against it afterwards
+    const QSet<QString> exts = m_extensions;
+    const quint64 generation = m_generation;
+    m_pool.start([this, dir, exts, generation] {
+        DiffResult result;
+        snapshotTree(dir, exts, &result, false);
+        QMetaObject::invokeMethod(this, [this, result, generation] {
+            if (generation == m_generation)
+                applyResult(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FolderWatcher::watchFile(const QString& filePath, std::optional<Stamp> baseline)
+{
+    const QString path = QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+    if (path.isEmpty() || m_singleFiles.contains(path))
+        return;
+    m_singleFiles.insert(path, baseline ? *baseline : stampOf(path));
+    if (m_enabled)
+        addFileWatches({ path });
+}
+
+void FolderWatcher::verifyFiles(const QHash<QString, Stamp>& saved)
+{
+    if (saved.isEmpty())
+        return;
+    //queued behind running passes, a stat per file can take long on network shares
+    const quint64 generation = m_generation;
+    m_pool.start([this, saved, generation] {
+        QStringList modified, removed;
+        QHash<QString, Stamp> stamps;
+        for (auto it = saved.constBegin(); it != saved.constEnd(); ++it) {
+            const Stamp st = stampOf(it.key());
+            if (st.size < 0)
+                removed << it.key();
+            else if (st != it.value())
+                modified << it.key();
+            stamps.insert(it.key(), st);
+        }
+        QMetaObject::invokeMethod(this, [this, modified, removed, stamps, generation] {
+            if (generation != m_generation)
+                return;
+            //reported now, single watches take the current stamps as their baseline
+            for (auto it = stamps.constBegin(); it != stamps.constEnd(); ++it) {
+                const auto single = m_singleFiles.find(it.key());
+                if (single != m_singleFiles.end())
+                    *single = it.value();
+            }
+            if (!modified.isEmpty())
+                emit filesModified(modified);
+            if (!removed.isEmpty())
+                emit filesRemoved(removed);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FolderWatcher::unwatchFile(const QString& filePath)
+{
+    const QString path = QDir::cleanPath(filePath);
+    if (m_singleFiles.remove(path) > 0 && m_watchedFiles.remove(path))
+        m_watcher.removePath(path);
+}
+
+void FolderWatcher::acknowledge(const QStringList& filePaths)
+{
+    for (const QString& filePath : filePaths) {
+        const QString path = QDir::cleanPath(QFileInfo(filePath).absoluteFilePath());
+        const Stamp stamp = stampOf(path);
+        m_acknowledged.insert(path, stamp);
+        const auto single = m_singleFiles.find(path);
+        if (single != m_singleFiles.end())
+            *single = stamp;
+        const QFileInfo fi(path);
+        const auto dir = m_snapshots.find(fi.absolutePath());
+        if (dir != m_snapshots.end() && dir->contains(fi.fileName()))
+            dir->insert(fi.fileName(), stamp);
+    }
+}
+
+void FolderWatcher::renameFiles(const QVector<QPair<QString, QString>>& moves)
+{
+    struct Moved {
+        QFileInfo to;
+        std::optional<Stamp> single;
+        std::optional<Stamp> inFolder;
+    };
+
+    //every stamp leaves its old name before any is placed
+    QVector<Moved> moved;
+    moved.reserve(moves.size());
+    for (const auto& [oldPath, newPath] : moves) {
+        const QFileInfo from(QDir::cleanPath(oldPath));
+        Moved m{ QFileInfo(QDir::cleanPath(newPath)), std::nullopt, std::nullopt };
+        if (m_watchedFiles.remove(from.absoluteFilePath()))
+            m_watcher.removePath(from.absoluteFilePath());
+        if (m_singleFiles.contains(from.absoluteFilePath()))
+            m.single = m_singleFiles.take(from.absoluteFilePath());
+        const auto dir = m_snapshots.find(from.absolutePath());
+        if (dir != m_snapshots.end() && dir->contains(from.fileName()))
+            m.inFolder = dir->take(from.fileName());
+        moved << m;
+    }
+
+    QStringList watched;
+    for (const Moved& m : std::as_const(moved)) {
+        if (m.single)
+            m_singleFiles.insert(m.to.absoluteFilePath(), *m.single);
+        const auto dir = m_snapshots.find(m.to.absolutePath());
+        if (m.inFolder && dir != m_snapshots.end())
+            dir->insert(m.to.fileName(), *m.inFolder);
+        if (m.single || m.inFolder)
+            watched << m.to.absoluteFilePath();
+    }
+    if (m_enabled && !watched.isEmpty())
+        addFileWatches(watched);
+}
+
+void FolderWatcher::clear()
+{
+    ++m_generation;
+    m_pool.clear();
+    m_diffRunning = false; //a cleared pass never reports back
+    m_debounce.stop();
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    if (!watched.isEmpty())
+        m_watcher.removePaths(watched);
+    m_snapshots.clear();
+    m_singleFiles.clear();
+    m_dirtyDirs.clear();
+    m_dirtyFiles.clear();
+    m_watchedFiles.clear();
+    m_acknowledged.clear();
+}
+
+void FolderWatcher::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+    m_enabled = enabled;
+
+    if (!enabled) {
+        //keep snapshots, changes made meanwhile are found by one full pass when enabled again
+        m_debounce.stop();
+        const QStringList watched = m_watcher.files() + m_watcher.directories();
+        if (!watched.isEmpty())
+            m_watcher.removePaths(watched);
+        m_watchedFiles.clear();
+        return;
+    }
+
+    const QStringList dirs = m_snapshots.keys();
+    if (!dirs.isEmpty())
+        m_watcher.addPaths(dirs);
+    addFileWatches(m_singleFiles.keys());
+    for (const QString& d : dirs)
+        m_dirtyDirs.insert(d);
+    for (auto it = m_singleFiles.constBegin(); it != m_singleFiles.constEnd(); ++it)
+        m_dirtyFiles.insert(it.key());
+    m_firstDirtyMs = nowMs();
+    m_debounce.start();
+}
+
+void FolderWatcher::addFileWatches(const QStringList& files)
+{
+    QStringList toAdd;
+    for (const QString& f : files) {
+        if (m_watchedFiles.size() + toAdd.size() >= kMaxFileWatches)
+            break;
+        if (!m_watchedFiles.contains(f))
+            toAdd << f;
+    }
+    if (toAdd.isEmpty())
+        return;
+    const QStringList failed = m_watcher.addPaths(toAdd);
+    for (const QString& f : std::as_const(toAdd)) {
+        if (!failed.contains(f))
+            m_watchedFiles.insert(f);
+    }
+}
+
+void FolderWatcher::onPathChanged(const QString& path)
+{
+    if (!m_enabled)
+        return;
+
+    if (m_snapshots.contains(path)) {
+        m_dirtyDirs.insert(path);
+    } else {
+        //replaced or deleted files lose their watch, it is added again after the diff
+        if (m_watchedFiles.contains(path) && !QFileInfo::exists(path))
+            m_watchedFiles.remove(path);
+
+        if (m_singleFiles.contains(path)) {
+            m_dirtyFiles.insert(path);
+        } else {
+            //file watch of a file inside a watched folder
+            const QString dir = QFileInfo(path).absolutePath();
+            if (m_snapshots.contains(dir))
+                m_dirtyDirs.insert(dir);
+        }
+    }
+
+    //restart quiet period, unless the burst already waited too long
+    if (m_firstDirtyMs == 0)
+        m_firstDirtyMs = nowMs();
+    m_debounce.start(nowMs() - m_firstDirtyMs >= kMaxDelayMs ? 0 : kDebounceMs);
+}
+
+void FolderWatcher::flush()
+{
+    if (m_diffRunning || (m_dirtyDirs.isEmpty() && m_dirtyFiles.isEmpty()))
+        return; //a finished pass flushes again
+
+    //hand copies to the worker, events arriving meanwhile start the next pass
+    QHash<QString, DirSnapshot> dirs;
+    for (const QString& d : std::as_const(m_dirtyDirs)) {
+        auto it = m_snapshots.constFind(d);
+        if (it != m_snapshots.constEnd())
+            dirs.insert(d, it.value());
+    }
+    QHash<QString, Stamp> singles;
+    for (const QString& f : std::as_const(m_dirtyFiles)) {
+        auto it = m_singleFiles.constFind(f);
+        if (it != m_singleFiles.constEnd())
+            singles.insert(f, it.value());
+    }
+    m_dirtyDirs.clear();
+    m_dirtyFiles.clear();
+    m_firstDirtyMs = 0;
+
+    QSet<QString> knownDirs;
+    for (auto it = m_snapshots.constBegin(); it != m_snapshots.constEnd(); ++it)
+        knownDirs.insert(it.key());
+
+    m_diffRunning = true;
+    const QSet<QString> exts = m_extensions;
+    const quint64 generation = m_generation;
+    m_pool.start([this, dirs, singles, knownDirs, exts, generation] {
+        DiffResult result;
+        const qint64 settleLimit = nowMs() - kSettleMs;
+
+        for (auto it = dirs.constBegin(); it != dirs.constEnd(); ++it) {
+            const QString& dir = it.key();
+            const DirSnapshot& old = it.value();
+
+            DirSnapshot now;
+            QStringList subDirs;
+            if (!listDir(dir, exts, &now, &subDirs)) {
+                //directory itself is gone, with everything below it
+                result.goneDirs << dir;
+                for (auto f = old.constBegin(); f != old.constEnd(); ++f)
+                    result.removed << joinPath(dir, f.key());
+                continue;
+            }
+
+            bool unsettled = false;
+            DirSnapshot next = old;
+            for (auto f = now.constBegin(); f != now.constEnd(); ++f) {
+                auto prev = old.constFind(f.key());
+                if (prev != old.constEnd() && prev.value() == f.value())
+                    continue;
+                if (f->mtime > settleLimit) {
+                    unsettled = true; //still being written, keep the old stamp and retry
+                    continue;
+                }
+                (prev == old.constEnd() ? result.added : result.modified) << joinPath(dir, f.key());
+                next.insert(f.key(), f.value());
+            }
+            for (auto f = old.constBegin(); f != old.constEnd(); ++f) {
+                if (!now.contains(f.key())) {
+                    result.removed << joinPath(dir, f.key());
+                    next.remove(f.key());
+                }
+            }
+            result.snapshots.insert(dir, std::move(next));
+            if (unsettled)
+                result.unsettled << dir;
+
+            //new sub directories are imported as a whole
+            for (const QString& sub : std::as_const(subDirs)) {
+                if (!knownDirs.contains(sub) && !result.snapshots.contains(sub))
+                    snapshotTree(sub, exts, &result, true);
+            }
+        }
+
+        for (auto it = singles.constBegin(); it != singles.constEnd(); ++it) {
+            const Stamp st = stampOf(it.key());
+            if (st.size < 0) {
+                result.singleRemoved << it.key();
+            } else if (st != it.value()) {
+                if (st.mtime > settleLimit) {
+                    result.unsettled << it.key(); //retried like a directory
+                    continue;
+                }
+                result.singleModified << it.key();
+                result.singleStamps.insert(it.key(), st);
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, result, generation] {
+            m_diffRunning = false;
+            if (generation == m_generation)
+                applyResult(result);
+            if (!m_dirtyDirs.isEmpty() || !m_dirtyFiles.isEmpty())
+                m_debounce.start(kDebounceMs);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FolderWatcher::applyResult(const DiffResult& result)
+{
+    //directories that vanished, and everything watched below them
+    QStringList removed = result.removed;
+    for (const QString& gone : result.goneDirs) {
+        const QString prefix = gone + QLatin1Char('/');
+        for (auto it = m_snapshots.begin(); it != m_snapshots.end();) {
+            if (it.key() == gone || it.key().startsWith(prefix)) {
+                if (it.key() != gone) {
+                    for (auto f = it->constBegin(); f != it->constEnd(); ++f)
+                        removed << joinPath(it.key(), f.key());
+                }
+                m_watcher.removePath(it.key());
+                for (auto f = it->constBegin(); f != it->constEnd(); ++f) {
+                    const QString file = joinPath(it.key(), f.key());
+                    if (m_watchedFiles.remove(file))
+                        m_watcher.removePath(file);
+                }
+                it = m_snapshots.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    QStringList newDirs;
+    QStringList newFiles;
+    for (auto it = result.snapshots.constBegin(); it != result.snapshots.constEnd(); ++it) {
+        if (!m_snapshots.contains(it.key())) {
+            newDirs << it.key();
+            for (auto f = it->constBegin(); f != it->constEnd(); ++f)
+                newFiles << joinPath(it.key(), f.key());
+        }
+        m_snapshots.insert(it.key(), it.value());
+    }
+    if (m_enabled && !newDirs.isEmpty()) {
+        m_watcher.addPaths(newDirs);
+        addFileWatches(newFiles);
+    }
+    if (m_enabled) {
+        //atomic replace (write temp + rename) drops the file watch, add it again
+        addFileWatches(result.added);
+        addFileWatches(result.modified);
+    }
+
+    //individually watched files
+    QStringList modified = result.modified;
+    for (const QString& f : result.singleModified) {
+        m_singleFiles.insert(f, result.singleStamps.value(f));
+        modified << f;
+        if (m_enabled)
+            addFileWatches({ f });
+    }
+    //own writes the pass diffed against the old baseline
+    if (!m_acknowledged.isEmpty()) {
+        modified.removeIf([this, &result](const QString& f) {
+            const auto ack = m_acknowledged.constFind(f);
+            if (ack == m_acknowledged.constEnd())
+                return false;
+            const QFileInfo fi(f);
+            const auto single = result.singleStamps.constFind(f);
+            const Stamp seen = single != result.singleStamps.constEnd()
+                ? single.value()
+                : result.snapshots.value(fi.absolutePath()).value(fi.fileName());
+            const bool own = seen == ack.value();
+            m_acknowledged.erase(ack);
+            return own;
+        });
+    }
+    for (const QString& f : result.singleRemoved) {
+        m_singleFiles.remove(f);
+        if (m_watchedFiles.remove(f))
+            m_watcher.removePath(f);
+        removed << f;
+    }
+
+    //retry files that were still being written
+    for (const QString& p : result.unsettled) {
+        if (m_snapshots.contains(p))
+            m_dirtyDirs.insert(p);
+        else if (m_singleFiles.contains(p))
+            m_dirtyFiles.insert(p);
+    }
+    if (!result.unsettled.isEmpty()) {
+        if (m_firstDirtyMs == 0)
+            m_firstDirtyMs = nowMs();
+        m_debounce.start(kDebounceMs);
+    }
+
+    if (!result.added.isEmpty())
+        emit filesAdded(result.added);
+    if (!modified.isEmpty())
+        emit filesModified(modified);
+    if (!removed.isEmpty())
+        emit filesRemoved(removed);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <optional>
+
+/*
+This file contains the FolderWatcher class, the live watch over imported
+folders and files.
+
+1. Watched directories are observed with QFileSystemWatcher (inotify on
+Linux, ReadDirectoryChangesW on Windows, FSEvents/kqueue on macOS). Imported
+files are watched individually as well, up to a cap, because in-place writes
+do not touch their directory.
+
+2. Events only mark directories dirty. A debounce timer coalesces bursts
+(tethered shooting, sync tools) and a background worker re-lists the dirty
+directories and diffs them against the last snapshot (size + mtime per file).
+Files modified in the last moment are left for the next pass, so a file that
+is still being written is reported once, when it is complete.
+
+3. The result is reported as added, modified and removed absolute file paths
+on the GUI thread. New sub directories are snapshotted and their files are
+reported as added.
+
+4. verifyFiles() compares files known from before (a restored session)
+against their saved stamps in the same background thread and reports the
+ones changed or removed meanwhile, so restoring never stats files on the
+GUI thread.
+
+5. Files the app writes itself are acknowledged: their new stamp becomes the
+baseline, and a pass that was already running reports no modification for
+that exact stamp. A later change by another program is reported as usual.
+*/
+
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stamp {
+        qint64 size = -1; //-1: file does not exist
+        qint64 mtime = 0; //ms since epoch
+        bool operator==(const Stamp& o) const { return size == o.size && mtime == o.mtime; }
+        bool operator!=(const Stamp& o) const { return !(*this == o); }
+    };
+
+    explicit FolderWatcher(QObject* parent = nullptr);
+    ~FolderWatcher() override; //wait for running snapshot and diff jobs
+
+    //extension filter of reported files, lower case without dot, empty = all files
+    void setExtensions(const QSet<QString>& extensions) { m_extensions = extensions; }
+
+    //recursive watch of a folder, the baseline snapshot is taken in background
+    void watchFolder(const QString& root);
+    //watch a single imported file, its directory is not imported
+    //baseline: its known stamp (saved session), taken from the disk if none
+    void watchFile(const QString& filePath, std::optional<Stamp> baseline = std::nullopt);
+    //files with their saved stamps (clean paths): checked in background, the ones changed or
+    //removed since are reported through filesModified and filesRemoved, watched or not
+    void verifyFiles(const QHash<QString, Stamp>& saved);
+    //forget a file, e.g. removed from the session
+    void unwatchFile(const QString& filePath);
+    //the app changed these files itself (tag writes): take their current size and date as
+    //the baseline, so the change is not reported back as a modification
+    void acknowledge(const QStringList& filePaths);
+    //the app renamed files (old, new path): stamps move to the new names, no removal and addition
+    //are reported; all moves of one rename at once, so swaps and chains keep the right stamps
+    void renameFiles(const QVector<QPair<QString, QString>>& moves);
+    //stop watching everything
+    void clear();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    int watchedDirCount() const { return static_cast<int>(m_snapshots.size()); }
+
+signals:
+    void filesAdded(const QStringList& paths);
+    void filesModified(const QStringList& paths);
+    void filesRemoved(const QStringList& paths);
+
+private:
+    using DirSnapshot = QHash<QString, Stamp>; //file name -> stamp
+
+    //result of one background pass
+    struct DiffResult {
+        QHash<QString, DirSnapshot> snapshots; //new or updated directory snapshots
+        QStringList goneDirs; //directories that disappeared
+        QStringList added, modified, removed;
+        QStringList singleModified, singleRemoved; //individually watched files
+        QHash<QString, Stamp> singleStamps;
+        QStringList unsettled; //dirs or single files still being written, diff again later
+    };
+
+    //worker side, no member access except the passed copies
+    static bool listDir(const QString& dir, const QSet<QString>& exts, DirSnapshot* files, QStringList* subDirs);
+    static void snapshotTree(const QString& root, const QSet<QString>& exts, DiffResult* out, bool reportAsAdded);
+    static Stamp stampOf(const QString& path);
+
+    void onPathChanged(const QString& path); //any watcher event, marks dirty and restarts debounce
+    void flush(); //debounce timeout: diff dirty paths in background
+    void applyResult(const DiffResult& result); //GUI thread
+    void addFileWatches(const QStringList& files);
+
+    QFileSystemWatcher m_watcher;
+    QHash<QString, DirSnapshot> m_snapshots; //watched dir -> snapshot, GUI thread only
+    QHash<QString, Stamp> m_singleFiles; //individually watched files -> stamp
+    QSet<QString> m_dirtyDirs;
+    QSet<QString> m_dirtyFiles;
+    QSet<QString> m_extensions;
+    QSet<QString> m_watchedFiles; //file watches currently held by m_watcher
+    QHash<QString, Stamp> m_acknowledged; //own writes, dropped from a pass that already saw them
+
+    QTimer m_debounce; //restarted by every event
+    qint64 m_firstDirtyMs = 0; //bounds the delay of an endless burst
+    bool m_diffRunning = false;
+    bool m_enabled = true;
+    quint64 m_generation = 0; //bumped by clear, stale results are dropped
+    QThreadPool m_pool; //single thread, passes run in order
+};
@@ -0,0 +1,215 @@
+#if !defined(_WIN32) && !defined(__APPLE__)
+
+#include "freedesktopThumbProvider.h"
+#include "trace.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <iterator>
+
+//spec sizes in ascending order
+static const FreedesktopThumbProvider::SizeBucket kBuckets[] = {
+    { "normal",   128 },
+    { "large",    256 },
+    { "x-large",  512 },
+    { "xx-large", 1024 },
+};
+
+//failure markers are kept per application
+static const char* kFailDir = "fail/zviewer";
+
+//canonical file URI of the spec, e.g. file:///home/me/a%20b.jpg
+static QString fileUri(const QString &filePath)
+{
+    const QString abs = QFileInfo(filePath).absoluteFilePath();
+    return QString::fromLatin1(QUrl::fromLocalFile(abs).toEncoded());
+}
+
+//thumbnail file name: lowercase md5 hex of URI + .png
+static QString specThumbName(const QString &uri)
+{
+    const QByteArray md5 = QCryptographicHash::hash(uri.toUtf8(), QCryptographicHash::Md5);
+    return QString::fromLatin1(md5.toHex()) + ".png";
+}
+
+//check PNG text chunks against source file info
+static bool thumbMatches(const QString &thumbPath, const QString &uri, qint64 mtime)
+{
+    if (!QFileInfo::exists(thumbPath))
+        return false;
+
+    QImageReader reader(thumbPath, "png");
+    //only header and text chunks are read here, no pixel decode
+    if (reader.text("Thumb::URI") != uri)
+        return false;
+
+    bool ok = false;
+    const qint64 stored = reader.text("Thumb::MTime").toLongLong(&ok);
+    return ok && stored == mtime;
+}
+
+//make dir with owner-only permission as required by spec
+static bool ensurePrivateDir(const QString &path)
+{
+    QDir dir(path);
+    if (!dir.exists() && !dir.mkpath("."))
+        return false;
+    QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner);
+    return true;
+}
+
+FreedesktopThumbProvider::FreedesktopThumbProvider()
+{
+    //XDG_CACHE_HOME falls back to ~/.cache, GenericCacheLocation handles both
+    const QString cacheHome = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (!cacheHome.isEmpty())
+        m_thumbRoot = QDir(cacheHome).filePath("thumbnails");
+}
+
+QString FreedesktopThumbProvider::lookupThumbnail(const QString &uri, const QString &thumbName,
+    qint64 mtime, int longEdge) const
+{
+    //1) buckets large enough for target, smallest first
+    int closestBelow = -1;
+    for (int i = 0; i < int(std::size(kBuckets)); ++i) {
+        if (kBuckets[i].edge < longEdge) {
+            closestBelow = i;
+            continue;
+        }
+        const QString p = QDir(m_thumbRoot).filePath(QString::fromLatin1(kBuckets[i].dirName) + "/" + thumbName);
+        if (thumbMatches(p, uri, mtime))
+            return p;
+    }
+
+    //2) file managers mostly fill normal/large only, the closest smaller one is still good for a tile
+    if (closestBelow >= 0) {
+        const QString p = QDir(m_thumbRoot).filePath(QString::fromLatin1(kBuckets[closestBelow].dirName) + "/" + thumbName);
+        if (thumbMatches(p, uri, mtime))
+            return p;
+    }
+    return {};
+}
+
+bool FreedesktopThumbProvider::hasFailureMarker(const QString &uri, const QString &thumbName, qint64 mtime) const
+{
+    const QString p = QDir(m_thumbRoot).filePath(QString::fromLatin1(kFailDir) + "/" + thumbName);
+    return thumbMatches(p, uri, mtime);
+}
+
+QString FreedesktopThumbProvider::writeThumbnail(const QString &filePath, const QString &uri,
+    const QString &thumbName, qint64 mtime, qint64 fileSize, int longEdge)
+{
+    //pick smallest bucket that covers the target
+    const SizeBucket* bucket = &kBuckets[std::size(kBuckets) - 1];
+    for (const SizeBucket& b : kBuckets) {
+        if (b.edge >= longEdge) {
+            bucket = &b;
+            break;
+        }
+    }
+
+    const QString bucketDir = QDir(m_thumbRoot).filePath(QString::fromLatin1(bucket->dirName));
+    if (!ensurePrivateDir(m_thumbRoot) || !ensurePrivateDir(bucketDir))
+        return {};
+
+    QImageReader reader(filePath);
+    reader.setAutoTransform(true); //spec thumbnails are stored upright
+    const QSize srcSize = reader.size();
+
+    //aspect preserving fit into bucket, never upscale
+    QImage img = readThumbImage(reader, QSize(bucket->edge, bucket->edge));
+    if (img.isNull())
+        return {};
+
+    //required and recommended keys of the spec
+    img.setText("Thumb::URI", uri);
+    img.setText("Thumb::MTime", QString::number(mtime));
+    img.setText("Thumb::Size", QString::number(fileSize));
+    if (srcSize.isValid()) {
+        img.setText("Thumb::Image::Width", QString::number(srcSize.width()));
+        img.setText("Thumb::Image::Height", QString::number(srcSize.height()));
+    }
+    img.setText("Software", "Z Viewer");
+
+    //write to temp file and rename, other readers never see partial files
+    ZV_TRACE_SCOPE("thumb.encode");
+    const QString outPath = QDir(bucketDir).filePath(thumbName);
+    QSaveFile out(outPath);
+    if (!out.open(QIODevice::WriteOnly) || !img.save(&out, "PNG") || !out.commit()) {
+        qWarning() << "FreedesktopThumbProvider: saving thumbnail failed" << outPath;
+        return {};
+    }
+    QFile::setPermissions(outPath, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    return outPath;
+}
+
+void FreedesktopThumbProvider::writeFailureMarker(const QString &uri, const QString &thumbName, qint64 mtime)
+{
+    const QString failDir = QDir(m_thumbRoot).filePath(QString::fromLatin1(kFailDir));
+    if (!ensurePrivateDir(failDir))
+        return;
+
+    //spec: failure marker is an empty PNG with the same keys
+    QImage marker(1, 1, QImage::Format_ARGB32);
+    marker.fill(Qt::transparent);
+    marker.setText("Thumb::URI", uri);
+    marker.setText("Thumb::MTime", QString::number(mtime));
+    marker.setText("Software", "Z Viewer");
+
+    const QString outPath = QDir(failDir).filePath(thumbName);
+    QSaveFile out(outPath);
+    if (out.open(QIODevice::WriteOnly) && marker.save(&out, "PNG") && out.commit())
+        QFile::setPermissions(outPath, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+}
+
+//Core implementation: shared store lookup first, then generate and write back.
+QString FreedesktopThumbProvider::makeThumbnail(const QString &filePath,
+    const QSize &targetSize, const QString &cacheDir)
+{
+    if (filePath.isEmpty())
+        return {};
+
+    const QFileInfo fi(filePath);
+    if (!fi.exists() || m_thumbRoot.isEmpty())
+        return m_fallback.makeThumbnail(filePath, targetSize, cacheDir);
+
+    const QString uri = fileUri(filePath);
+    const QString thumbName = specThumbName(uri);
+    const qint64 mtime = fi.lastModified().toSecsSinceEpoch();
+    const int longEdge = targetSize.isValid() ? qMax(targetSize.width(), targetSize.height()) : 256;
+
+    //1) thumbnail already in the shared store
+    const QString found = lookupThumbnail(uri, thumbName, mtime, longEdge);
+    if (!found.isEmpty())
+        return found;
+
+    //2) another tool or earlier run already failed on this version of the file
+    if (hasFailureMarker(uri, thumbName, mtime))
+        return {};
+
+    //3) generate and write back in spec format
+    const QString written = writeThumbnail(filePath, uri, thumbName, mtime, fi.size(), longEdge);
+    if (!written.isEmpty())
+        return written;
+
+    //4) unreadable format: record failure, do not retry until file changes
+    QImageReader probe(filePath);
+    if (!probe.canRead()) {
+        writeFailureMarker(uri, thumbName, mtime);
+        return {};
+    }
+
+    //5) readable but shared store not writable: keep thumbnail in application cache
+    return m_fallback.makeThumbnail(filePath, targetSize, cacheDir);
+}
+
+#endif // !_WIN32 && !__APPLE__
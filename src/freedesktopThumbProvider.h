@@ -0,0 +1,62 @@
+#pragma once
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+
+#include <QString>
+#include <QSize>
+#include <QImage>
+
+#include "thumbImage.h"
+/*
+* This is the declaration of FreedesktopThumbProvider class.
+*
+* 1. It implements the freedesktop.org Thumbnail Managing Standard, which is
+* the shared thumbnail store used by Linux file managers (Nautilus, Dolphin,
+* Thunar, etc.): $XDG_CACHE_HOME/thumbnails/{normal,large,x-large,xx-large}.
+*
+* 2. Lookup: thumbnail file name is the MD5 hex of the file URI. A stored
+* thumbnail is only valid when its Thumb::URI and Thumb::MTime PNG text chunks
+* match the source file. Valid thumbnails are returned as-is, nothing is decoded.
+*
+* 3. Write back: missing or stale thumbnails are generated with Qt image
+* readers and saved in spec format (atomic write, 0600 permissions), so other
+* desktop tools benefit. Failures are recorded under thumbnails/fail/zviewer.
+*
+* 4. When the shared store is not writable, QtThumbProvider is used as fallback
+* and the thumbnail goes to the application cache directory.
+*
+* This class only works on Linux and other freedesktop platforms. It is a
+* subclass of ThumbProvider.
+*/
+
+class FreedesktopThumbProvider : public ThumbProvider
+{
+public:
+    FreedesktopThumbProvider();
+    ~FreedesktopThumbProvider() override = default;
+
+    QString makeThumbnail(const QString &filePath,
+        const QSize &targetSize, const QString &cacheDir) override;
+
+    //spec size buckets, edge length in pixels
+    struct SizeBucket {
+        const char* dirName;
+        int edge;
+    };
+
+private:
+    //look up an existing valid thumbnail, return its path or empty
+    QString lookupThumbnail(const QString &uri, const QString &thumbName,
+        qint64 mtime, int longEdge) const;
+    //check if failure marker is recorded for current mtime
+    bool hasFailureMarker(const QString &uri, const QString &thumbName, qint64 mtime) const;
+    //generate, then save in spec format, return its path or empty
+    QString writeThumbnail(const QString &filePath, const QString &uri,
+        const QString &thumbName, qint64 mtime, qint64 fileSize, int longEdge);
+    void writeFailureMarker(const QString &uri, const QString &thumbName, qint64 mtime);
+
+    QString m_thumbRoot; //$XDG_CACHE_HOME/thumbnails
+    QtThumbProvider m_fallback; //used when shared store is not writable
+};
+
+#endif // !_WIN32 && !__APPLE__
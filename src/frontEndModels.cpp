@@ -4,6 +4,12 @@
 #include <QFileInfo>
 #include <QAbstractItemModel>
 #include <QModelIndex>
+#include <algorithm>
+
+#include "placeholder.h"
+#include "thumbImage.h"
+#include "trace.h"
+#include "metrics.h"
 
 //ExifProxyModel methods Implementation
 ExifProxyModel::ExifProxyModel(QObject* parent) : QSortFilterProxyModel(parent)
@@ -110,6 +116,90 @@ void EntryListModel::setEntries(QVector<TagEntry> entries)
 }
 //end of EntryListModel methods
 
+//implementation of MetricsModel
+int MetricsModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_rows.size();
+}
+
+QVariant MetricsModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size()) return {};
+    const auto& r = m_rows[index.row()];
+    switch (role) {
+    case NameRole:  return r.first;
+    case ValueRole: return r.second;
+    default:        return {};
+    }
+}
+
+QHash<int, QByteArray> MetricsModel::roleNames() const
+{
+    return {
+        { NameRole, "name" },
+        { ValueRole, "value" }
+    };
+}
+
+void MetricsModel::setRows(const QVector<QPair<QString, QString>>& rows)
+{
+    bool sameNames = rows.size() == m_rows.size();
+    for (int i = 0; sameNames && i < rows.size(); ++i)
+        sameNames = rows[i].first == m_rows[i].first;
+    if (!sameNames) {
+        beginResetModel();
+        m_rows = rows;
+        endResetModel();
+        return;
+    }
+    for (int i = 0; i < rows.size(); ++i) {
+        if (rows[i].second == m_rows[i].second)
+            continue;
+        m_rows[i].second = rows[i].second;
+        emit dataChanged(index(i), index(i), { ValueRole });
+    }
+}
+//end of MetricsModel methods
+
+//implementation of RenamePreviewModel
+int RenamePreviewModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return m_rows.size();
+}
+
+QVariant RenamePreviewModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_rows.size()) return {};
+    const auto& r = m_rows[index.row()];
+    switch (role) {
+    case OldNameRole: return r.oldName;
+    case NewNameRole: return r.newName;
+    case StatusRole:  return r.status;
+    case MessageRole: return r.message;
+    default:          return {};
+    }
+}
+
+QHash<int, QByteArray> RenamePreviewModel::roleNames() const
+{
+    return {
+        { OldNameRole, "oldName" },
+        { NewNameRole, "newName" },
+        { StatusRole, "status" },
+        { MessageRole, "message" }
+    };
+}
+
+void RenamePreviewModel::setRows(QVector<Row> rows)
+{
+    beginResetModel();
+    m_rows = std::move(rows);
+    endResetModel();
+}
+//end of RenamePreviewModel methods
+
 //implementation of ExifGroupsModel
 int ExifGroupsModel::rowCount(const QModelIndex& parent) const
 {
@@ -144,6 +234,15 @@ QHash<int, QByteArray> ExifGroupsModel::roleNames() const
 
 void ExifGroupsModel::rebuildFromExifModel(const ExifModel& exifModel)
 {
+    ZV_TRACE_SCOPE("model.rebuildGroups");
+    //keep fold status by group name, so a refreshed file looks the same in infoPanel
+    QHash<QString, bool> foldedByName;
+    QVector<QPointer<EntryListModel>> oldChildren;
+    for (const auto& g : std::as_const(m_groups)) {
+        foldedByName.insert(g.groupName, g.folded);
+        oldChildren.push_back(g.entriesModel);
+    }
+
     beginResetModel();//signal
     m_groups.clear();//clear container
     QStringList groupNames = exifModel.getGroups();//get groups in sorted order from exifModel
@@ -163,10 +262,71 @@ void ExifGroupsModel::rebuildFromExifModel(const ExifModel& exifModel)
         GroupItem item;
         item.groupName = name;
         item.entriesModel = child;
-        item.folded = false; //default expanded
+        item.folded = foldedByName.value(name, false); //default expanded
         m_groups.push_back(std::move(item));//add back to groups list container
     }
     endResetModel();
+
+    //children of the previous build, QML may still hold them until the reset is processed
+    for (const auto& child : oldChildren) {
+        if (child)
+            child->deleteLater();
+    }
+}
+
+void ExifGroupsModel::patchGroups(const ExifModel& exifModel, const QStringList& groupNames)
+{
+    if (groupNames.isEmpty())
+        return;
+    QHash<QString, QVector<TagEntry>> buckets;
+    for (const auto& e : exifModel.entries()) {
+        if (groupNames.contains(e.group))
+            buckets[e.group].push_back(e);
+    }
+    const QStringList order = exifModel.getGroups(); //sorted, rows follow this order
+    auto rowOf = [this](const QString& name) {
+        for (int i = 0; i < m_groups.size(); ++i) {
+            if (m_groups[i].groupName == name)
+                return i;
+        }
+        return -1;
+    };
+
+    int firstMoved = -1; //rows from here on changed their GroupIndexRole
+    for (const QString& name : groupNames) {
+        const int row = rowOf(name);
+        const auto bucket = buckets.constFind(name);
+        if (bucket == buckets.constEnd()) { //last entry of the group removed
+            if (row < 0)
+                continue;
+            beginRemoveRows(QModelIndex(), row, row);
+            if (m_groups[row].entriesModel)
+                m_groups[row].entriesModel->deleteLater();
+            m_groups.remove(row);
+            endRemoveRows();
+            firstMoved = firstMoved < 0 ? row : std::min(firstMoved, row);
+        } else if (row >= 0) {
+            m_groups[row].entriesModel->setEntries(bucket.value());
+            const QModelIndex idx = index(row, 0);
+            emit dataChanged(idx, idx, { GroupLengthRole });
+        } else { //new group, placed by the group order of the model
+            const int rank = order.indexOf(name);
+            int at = 0;
+            while (at < m_groups.size() && order.indexOf(m_groups[at].groupName) < rank)
+                ++at;
+            auto* child = new EntryListModel(this);
+            child->setEntries(bucket.value());
+            GroupItem item;
+            item.groupName = name;
+            item.entriesModel = child;
+            beginInsertRows(QModelIndex(), at, at);
+            m_groups.insert(at, std::move(item));
+            endInsertRows();
+            firstMoved = firstMoved < 0 ? at : std::min(firstMoved, at);
+        }
+    }
+    if (firstMoved >= 0 && firstMoved < m_groups.size())
+        emit dataChanged(index(firstMoved, 0), index(m_groups.size() - 1, 0), { GroupIndexRole });
 }
 
 void ExifGroupsModel::toggleFoldStatus(int groupIndex)
@@ -181,6 +341,28 @@ void ExifGroupsModel::toggleFoldStatus(int groupIndex)
     emit dataChanged(idx, idx, { FoldedRole });
 }
 
+QStringList ExifGroupsModel::foldedGroups() const
+{
+    QStringList out;
+    for (const auto& g : m_groups) {
+        if (g.folded)
+            out << g.groupName;
+    }
+    return out;
+}
+
+void ExifGroupsModel::setFoldedGroups(const QStringList& groupNames)
+{
+    for (int i = 0; i < m_groups.size(); ++i) {
+        const bool folded = groupNames.contains(m_groups[i].groupName);
+        if (m_groups[i].folded == folded)
+            continue;
+        m_groups[i].folded = folded;
+        const QModelIndex idx = index(i, 0);
+        emit dataChanged(idx, idx, { FoldedRole });
+    }
+}
+
 //
 //implement the 2nd constructor of ExifFileInfo struct
 //allow auto-completion of file name info
@@ -207,13 +389,21 @@ FileListModel::FileListModel(QObject* parent)
 }
 
 //2nd constructor: consturct from exifFileList
-FileListModel::FileListModel(const std::vector<ExifFileInfo>& exifFileList,
+FileListModel::FileListModel(const ExifFileStore& exifFileList,
                              QObject* parent)
     : QAbstractListModel(parent)
 {
     rebuildFrom(exifFileList);
 }
 
+FileListModel::~FileListModel()
+{
+    //drop queued jobs, wait for running ones
+    //results posted afterwards are discarded together with this object
+    m_thumbPool.clear();
+    m_thumbPool.waitForDone();
+}
+
 int FileListModel::rowCount(const QModelIndex& parent) const
 {
     if (parent.isValid())
@@ -244,12 +434,16 @@ QVariant FileListModel::data(const QModelIndex& index, int role) const
         return item.baseName;
     case FileTypeRole:
         return item.fileType;
-    case ThumbUrlRole: //convert Thumb cache path to QUrl
-        return QUrl::fromLocalFile(item.thumbCachePath).toString();
+    case ThumbUrlRole: //level-aware url of ThumbImageProvider
+        return ThumbLevels::toUrl(item.thumbCachePath, item.thumbVersion);
     case ThumbStateRole:
         return static_cast<int>(item.thumbState);
     case ThumbVersionRole:
         return item.thumbVersion;
+    case PlaceholderUrlRole:
+        return Placeholder::toUrl(item.placeholder);
+    case FileIdRole:
+        return item.fileId.toInt();
     default:
         return {};
     }
@@ -266,6 +460,8 @@ QHash<int, QByteArray> FileListModel::roleNames() const
     roles[ThumbUrlRole] = "thumbUrl";
     roles[ThumbStateRole] = "thumbState";
     roles[ThumbVersionRole] = "thumbVersion";
+    roles[PlaceholderUrlRole] = "placeholderUrl";
+    roles[FileIdRole] = "fileId";
     return roles;
 }
 
@@ -275,84 +471,207 @@ void FileListModel::clear()
         return;
 
     beginResetModel();
+    m_thumbPool.clear(); //queued jobs are obsolete
     m_fileList.clear();
     endResetModel();
 }
 
-void FileListModel::rebuildFrom(const std::vector<ExifFileInfo>& exifFileList)
+void FileListModel::rebuildFrom(const ExifFileStore& exifFileList)
 {
     beginResetModel(); //notify QML UI on model update
 
+    m_thumbPool.clear(); //queued jobs are obsolete
     m_fileList.clear();
     m_fileList.reserve(exifFileList.size());
-    const QSize thumbSize(thumbWidth, thumbHeight);
-    for (const ExifFileInfo& src : exifFileList) {
-        FileItem item;
-        //fill up path and names
-        item.filePath = src.filePath;
-        item.fileName = src.fileName;
-        item.baseName = src.baseName;
-        item.fileType = src.fileType;
-        //generate thumbnail and fill up
-        item.thumbCachePath = thumbProvider.makeThumbnail(item.filePath, thumbSize, m_cacheDir);
-        if (!item.thumbCachePath.isEmpty())
-            item.thumbState = FileItem::ThumbState::Ready;
-        else
-            item.thumbState = FileItem::ThumbState::Failed;
-        item.thumbVersion++;
-        //put into file list
-        m_fileList.push_back(std::move(item));
+    for (int row = 0; row < exifFileList.size(); ++row) {
+        //put into file list, then generate thumbnail in background
+        requestThumbnail(m_fileList.push_back(makeItem(exifFileList, row)));
     }
 
     endResetModel();
 }
 
-//direct copy from an ExifFileInfo object
-void FileListModel::addFile(const ExifFileInfo& info)
+FileListModel::FileItem FileListModel::makeItem(const ExifFileStore& exifFileList, int row) const
 {
-    const int row = static_cast<int>(m_fileList.size());
-    beginInsertRows(QModelIndex(), row, row);
+    const ExifFileInfo& src = exifFileList[row];
+    FileItem item;
+    //fill up path and names
+    item.filePath = src.filePath;
+    item.fileName = src.fileName;
+    item.baseName = src.baseName;
+    item.fileType = src.fileType;
+    item.fileId = exifFileList.idAt(row);
+    item.placeholder = m_cacheManager.placeholder(src.filePath); //index lookup only, no disk access
+    return item;
+}
 
+//direct copy from an ExifFileInfo object
+void FileListModel::addFile(const ExifFileInfo& info, FileId fileId)
+{
     FileItem item;
     item.filePath = info.filePath;
     item.fileName = info.fileName;
     item.baseName = info.baseName;
     item.fileType = info.fileType;
-    //generate thumbnail and fill up
-    const QSize thumbSize(thumbWidth, thumbHeight);
-    //generate thumbnail and fill up
-    item.thumbCachePath = thumbProvider.makeThumbnail(item.filePath, thumbSize, m_cacheDir);
-    if (!item.thumbCachePath.isEmpty())
-        item.thumbState = FileItem::ThumbState::Ready;
-    else
-        item.thumbState = FileItem::ThumbState::Failed;
-    item.thumbVersion++;
-    m_fileList.push_back(std::move(item));
-
-    endInsertRows();
+    item.fileId = fileId;
+    item.placeholder = m_cacheManager.placeholder(info.filePath);
+    appendItem(std::move(item));
 }
 
 //only using local path and parse into FileItem
 void FileListModel::addFile(const QString& path)
 {
-    const int row = static_cast<int>(m_fileList.size());
-    beginInsertRows(QModelIndex(), row, row);
-
     FileItem item;
     QFileInfo info(path);//convert to QFileInfo for auto parsing
+    item.filePath = path;
+    item.fileName = info.fileName();
+    item.baseName = info.baseName();
+    item.fileType = info.suffix();
+    item.placeholder = m_cacheManager.placeholder(path);
+    appendItem(std::move(item));
+}
+
+void FileListModel::appendFrom(const ExifFileStore& exifFileList, int firstRow)
+{
+    const int lastRow = exifFileList.size() - 1;
+    if (firstRow < 0 || firstRow > lastRow || firstRow != m_fileList.size())
+        return; //rows must continue this model
+
+    ZV_TRACE_SCOPE("qml.insertRows"); //views create their delegates inside endInsertRows()
+    beginInsertRows(QModelIndex(), firstRow, lastRow);
+    m_fileList.reserve(lastRow + 1);
+    for (int row = firstRow; row <= lastRow; ++row)
+        requestThumbnail(m_fileList.push_back(makeItem(exifFileList, row)));
+    endInsertRows();
+}
+
+void FileListModel::appendItem(FileItem&& item)
+{
+    const int row = m_fileList.size();
+    beginInsertRows(QModelIndex(), row, row);
+    const FileId itemId = m_fileList.push_back(std::move(item));
+    requestThumbnail(itemId); //row is shown right away, thumbnail arrives later
+    endInsertRows();
+}
+
+void FileListModel::refreshFile(int row)
+{
+    const FileId itemId = m_fileList.idAt(row);
+    if (!itemId.isValid())
+        return;
+    //a new job id drops the result of a running job, the cache misses on the newer source file
+    requestThumbnail(itemId);
+    const QModelIndex idx = index(row, 0);
+    emit dataChanged(idx, idx, { ThumbStateRole });
+}
+
+void FileListModel::renameFile(int row, const QString& newPath)
+{
+    const FileId itemId = m_fileList.idAt(row);
+    if (!itemId.isValid())
+        return;
+    FileItem& item = m_fileList[row];
+    const QFileInfo info(newPath);
+    item.filePath = newPath;
     item.fileName = info.fileName();
     item.baseName = info.baseName();
     item.fileType = info.suffix();
-    //generate thumbnail and fill up
-    const QSize thumbSize(thumbWidth, thumbHeight);
-    //generate thumbnail and fill up
-    item.thumbCachePath = thumbProvider.makeThumbnail(item.filePath, thumbSize, m_cacheDir);
+    const QModelIndex idx = index(row, 0);
+    emit dataChanged(idx, idx, { FilePathRole, FileNameRole, BaseNameRole, FileTypeRole });
+}
+
+void FileListModel::removeFiles(int first, int last)
+{
+    if (first < 0 || last >= m_fileList.size() || first > last)
+        return;
+    beginRemoveRows(QModelIndex(), first, last);
+    m_fileList.removeRows(first, last); //pending jobs of these rows find no item and are dropped
+    endRemoveRows();
+
+    //fileIndex role equals row, rows below moved up
+    if (first < m_fileList.size())
+        emit dataChanged(index(first, 0), index(m_fileList.size() - 1, 0), { FileIndexRole });
+}
+
+//thumbnail generation runs in m_thumbPool so imports never wait for decoders
+void FileListModel::requestThumbnail(FileId itemId)
+{
+    FileItem& item = *m_fileList.get(itemId);
+    item.thumbState = FileItem::ThumbState::Generating;
+    item.thumbJob = ++m_nextThumbJob;
+
+    const quint64 job = item.thumbJob;
+    const QString filePath = item.filePath;
+    const QSize thumbSize = m_topLevelSize;
+    const QString cacheDir = m_cacheDir;
+    ThumbProvider* provider = &thumbProvider; //providers keep no per-call state
+    ThumbCacheManager* cache = &m_cacheManager; //lookup/record are thread-safe
+
+    m_thumbPool.start([this, provider, cache, itemId, job, filePath, thumbSize, cacheDir] {
+        QString thumbPath;
+        QString placeholder;
+
+        //cache hit: thumbnail, levels and placeholder of this version of the file exist
+        ThumbCacheManager::Entry cached;
+        if (cache->lookup(filePath, &cached)) {
+            thumbPath = cached.topPath;
+            placeholder = cached.placeholder;
+        } else {
+            //a first placeholder from a cheap scaled decode, shown while the thumbnail is generated
+            const QString early = Placeholder::encodeSource(filePath);
+            if (!early.isEmpty()) {
+                QMetaObject::invokeMethod(this, [this, itemId, job, early] {
+                    onPlaceholderReady(itemId, job, early);
+                }, Qt::QueuedConnection);
+            }
+
+            ZV_TRACE_SCOPE("thumb.generate");
+            static Metrics::Histogram& latency = Metrics::histogram("thumbnail"); //decode, levels and placeholder
+            const Metrics::ScopedTimer timer(latency);
+            //source file is decoded once by the provider into the top level
+            thumbPath = provider->makeThumbnail(filePath, thumbSize, cacheDir);
+            //lower levels and placeholder all come from one decode of the small top level
+            const QImage top(thumbPath);
+            if (!top.isNull()) {
+                ThumbLevels::writeLevels(top, thumbPath, filePath); //levels of an unchanged source are kept
+                placeholder = Placeholder::encode(top);
+                cache->record(filePath, thumbPath, placeholder);
+            }
+        }
+        //back to GUI thread, model data is only touched there
+        QMetaObject::invokeMethod(this, [this, itemId, job, thumbPath, placeholder] {
+            onThumbnailReady(itemId, job, thumbPath, placeholder);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void FileListModel::onPlaceholderReady(FileId itemId, quint64 job, const QString& placeholder)
+{
+    FileItem* found = m_fileList.get(itemId);
+    if (!found || found->thumbJob != job || found->thumbState != FileItem::ThumbState::Generating)
+        return; //stale job, or the thumbnail came first
+    found->placeholder = placeholder;
+
+    const QModelIndex idx = index(m_fileList.rowOf(itemId), 0);
+    emit dataChanged(idx, idx, { PlaceholderUrlRole });
+}
+
+void FileListModel::onThumbnailReady(FileId itemId, quint64 job, const QString& thumbPath, const QString& placeholder)
+{
+    FileItem* found = m_fileList.get(itemId);
+    if (!found || found->thumbJob != job)
+        return; //model was rebuilt, row removed or a newer job was requested
+    FileItem& item = *found;
+
+    item.thumbCachePath = thumbPath;
+    if (!placeholder.isEmpty())
+        item.placeholder = placeholder; //a failed thumbnail keeps the earlier one
     if (!item.thumbCachePath.isEmpty())
         item.thumbState = FileItem::ThumbState::Ready;
     else
         item.thumbState = FileItem::ThumbState::Failed;
     item.thumbVersion++;
-    m_fileList.push_back(std::move(item));
 
-    endInsertRows();
+    const QModelIndex idx = index(m_fileList.rowOf(itemId), 0);
+    emit dataChanged(idx, idx, { ThumbUrlRole, ThumbStateRole, ThumbVersionRole, PlaceholderUrlRole });
 }
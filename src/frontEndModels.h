@@ -1,15 +1,18 @@
 #pragma once
 
 #include <QObject>
-#include <QtQml>
+#include <QtCore>
 #include <vector>
 #include <QString>
 #include <QDebug> //only for debug and testing purposes
 #include <QAbstractListModel>
 #include <QSortFilterProxyModel>
+#include <QThreadPool>
 #include <memory>
 
 #include "getExif.h"
+#include "slotStore.h"
+#include "thumbCache.h"
 
 //platform headers
 #if defined(Q_OS_WIN)
@@ -17,7 +20,7 @@
 #elif defined(Q_OS_MAC)
     #include "macThumbProvider.h"
 #else
-
+    #include "freedesktopThumbProvider.h"
 #endif
 
 
@@ -26,20 +29,21 @@
  * structures used by QML frontend as data sources. They are dependent on
  * exiftool.exe pipeline and ExifModel class in getExif.h, and operating
  * system specific Thumbnail pipeline (windowsShellThumbProvider.h for
- * Windows x86 system).
+ * Windows x86 system, macThumbProvider.h for Mac OS, freedesktopThumbProvider.h
+ * for Linux).
  *
  * Backend class in backend.h is dependent on this file.
  *
  * This file contains the struct ExifFileInfo for storing info and items
- * of each imported file. All ExifFileInfo objects are placed in vector in
- * the Backend object and accessed with an int index.
+ * of each imported file. All ExifFileInfo objects are placed in a SlotStore
+ * in the Backend object, accessed with an int row or a stable FileId.
  * This file also contains the fileListModel for loading thumbnail preview.
 */
 
 /*
 //Data structure topology
 Backend: communication interface to QML frontend (calls exiftool pipeline on file import)
-    ├ ExifList: vector of all exifFileInfo items
+    ├ ExifList: SlotStore of all exifFileInfo items (row order + stable FileId)
     │     ├ ExifFileInfo: stores all objects of a file (constructed from exiftool pipeline)
     │     ...   ├ ExifModel: all exiftool data for searching (constructed from exiftool pipeline)
     │           └ ExifGroupsModel: Exif info groups and related info (constructed from ExifModel)
@@ -119,6 +123,67 @@ private:
     QVector<TagEntry> m_entries; //data storage
 };
 
+/*
+MetricsModel: rows of the optional metrics overlay (name and formatted value).
+Refreshed by Backend once per second, rows keep their place so only the
+changed values are repainted.
+*/
+class MetricsModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        ValueRole
+    };
+    Q_ENUM(Roles)
+
+    explicit MetricsModel(QObject* parent = nullptr) : QAbstractListModel(parent) {} //null constructor
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void setRows(const QVector<QPair<QString, QString>>& rows); //name, value
+
+private:
+    QVector<QPair<QString, QString>> m_rows; //data storage
+};
+
+/*
+RenamePreviewModel: rows of a batch rename plan for the rename dialog, current
+and new file name with the status of each file. Filled by Backend when a plan
+is ready, cleared when it is applied.
+*/
+class RenamePreviewModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Roles {
+        OldNameRole = Qt::UserRole + 1,
+        NewNameRole,
+        StatusRole, //"ok", "unchanged", "missing", "collision", "exists"
+        MessageRole //reason of a status other than ok
+    };
+    Q_ENUM(Roles)
+
+    struct Row {
+        QString oldName;
+        QString newName;
+        QString status;
+        QString message;
+    };
+
+    explicit RenamePreviewModel(QObject* parent = nullptr) : QAbstractListModel(parent) {} //null constructor
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    void setRows(QVector<Row> rows);
+
+private:
+    QVector<Row> m_rows; //data storage
+};
+
 /*
 ExifGroupsModel: All groups of Exif data of one file. Initialize on file loading. Stores as member of ExifFileInfo.
 This is displayed in InfoPanel in QML frontend.
@@ -143,8 +208,14 @@ public:
     QHash<int, QByteArray> roleNames() const override;
 
     void rebuildFromExifModel(const ExifModel& exifModel);
+    //refresh only the given groups after ExifModel::patchTags, other groups and their models stay as they are
+    void patchGroups(const ExifModel& exifModel, const QStringList& groupNames);
     void toggleFoldStatus(int groupIndex);
 
+    //fold status by group name, saved with the session
+    QStringList foldedGroups() const;
+    void setFoldedGroups(const QStringList& groupNames);
+
 private:
     struct GroupItem {
         QString groupName;
@@ -157,8 +228,8 @@ private:
 
 
 /*ExifFileInfo: Object to store multiple items of a single file for display.
-It is saved in ExifList (Backend class member), which is an std::vector of
-all ExifFileInfo objects. */
+It is saved in ExifList (Backend class member), which is a SlotStore of
+all ExifFileInfo objects. Records never move once stored. */
 struct ExifFileInfo
 {
     //set default value to avoid loading error
@@ -173,6 +244,16 @@ struct ExifFileInfo
     int viewX = 0;
     int viewY = 0;
 
+    //compact record, models above are built from it on demand and released again
+    QVector<TagEntry> entries; //metadata, shared with exifModel while built (implicit sharing)
+    QByteArray packedEntries; //entries compressed by EntryCompressor instead, entries is empty then
+    int snapshotIndex = -1; //file index in the mapped session snapshot, entries are read from there if >= 0
+    QStringList foldedGroups; //applied to exifGroupsModel when it is built, saved back on release
+    bool basicOnly = false; //only the basic info tags of the fast import pass so far
+    bool restricted = false; //read under a restricted extraction profile, tags outside it are missing
+
+    bool isMaterialised() const { return exifModel != nullptr; }
+
     //thumbnail is not managed here, thumbnail is owned by FileListModel
 
     //constructors
@@ -184,10 +265,14 @@ struct ExifFileInfo
     explicit ExifFileInfo(const QString& path);
 };
 
+//session storage of all files, see slotStore.h
+using ExifFileStore = SlotStore<ExifFileInfo>;
+
 /*FileListModel class for thumbnail loading in QML.
 This class only stores file name, path and thumbnail path.
-It shares index value with ExifList and can be reconstructed solely from
-the exifList object, but it is a QtListModel instead of std::vector.
+It shares row order with ExifList and can be reconstructed solely from
+the exifList object, but it is a QtListModel instead of a plain store.
+Rows are added and removed together with ExifList, never by a full rebuild.
 All exif data are stored in ExifList[i].ExifFileInfo.exifModel, not here.
 This class is used as a member value m_fileListModel in Backend Class.
 */
@@ -201,17 +286,22 @@ public:
         FileNameRole, //full name with ext
         BaseNameRole, //name without ext
         FileTypeRole, //ext name
-        ThumbUrlRole, //for thumbnail loading
+        ThumbUrlRole, //for thumbnail loading, image provider url, QML picks level by sourceSize
         ThumbStateRole, //  int: 0=NotRequested,1=Generating,2=Ready,3=Failed
         ThumbVersionRole, // update UI when version renewed
+        PlaceholderUrlRole, //tiny blurred preview, painted until thumbnail is ready
+        FileIdRole, //stable id of the file in session (FileId::toInt), survives removal of other rows
     };
     Q_ENUM(Roles)
 
         // null constructor, use rebuildFrom() to fill up
         explicit FileListModel(QObject* parent = nullptr);
 
-    //2nd constructor, construct FileListModel from exifFileList vector
-    explicit FileListModel(const std::vector<ExifFileInfo>& exifList, QObject* parent = nullptr);
+    //2nd constructor, construct FileListModel from exifList store
+    explicit FileListModel(const ExifFileStore& exifList, QObject* parent = nullptr);
+
+    //wait for running thumbnail jobs
+    ~FileListModel() override;
 
     // override implementation of QAbstractListModel mandatory interfaces
     int rowCount(const QModelIndex& parent) const override;
@@ -221,13 +311,26 @@ public:
     //clear all
     void clear();
 
-    // clear and rebuild data of this from an std::vector<ExifFileInfo>
+    // clear and rebuild data of this from the exifList store
     // not to be confused with 2nd constructor
-    void rebuildFrom(const std::vector<ExifFileInfo>& exifFileList);
+    // regenerates every thumbnail request, normal add/remove never needs it
+    void rebuildFrom(const ExifFileStore& exifFileList);
 
     // add operation. used in Backend::loadExifFromFile()
     void addFile(const QString& path); //add using local path
-    void addFile(const ExifFileInfo& info); //add using ExifFileInfo
+    void addFile(const ExifFileInfo& info, FileId fileId = {}); //add using ExifFileInfo and its id in exifList
+    //bulk add: rows [firstRow, end) of the store with one beginInsertRows, used by batched imports
+    void appendFrom(const ExifFileStore& exifFileList, int firstRow);
+
+    //file changed on disk: regenerate thumbnail of this row only
+    void refreshFile(int row);
+    //file renamed on disk: path and name roles of this row, the thumbnail is kept
+    void renameFile(int row, const QString& newPath);
+    //remove rows [first, last] with one beginRemoveRows, thumbnails of other rows are kept
+    void removeFiles(int first, int last);
+
+    //cache governance service of the thumbnail cache dir
+    ThumbCacheManager* cacheManager() { return &m_cacheManager; }
 
 private:
 
@@ -252,6 +355,11 @@ private:
 
         int thumbVersion = 0; //default 0, ++ when update
 
+        FileId fileId; //id of the file in exifList
+
+        QString placeholder; //BlurHash of thumbnail, from the cache index, an early decode or the thumbnail
+        quint64 thumbJob = 0; //id of latest thumbnail job, stale results are dropped
+
         //helper method: check if cache file exists
         bool hasValidThumbnail() const {
             return thumbState == ThumbState::Ready && QFile::exists(thumbCachePath);
@@ -259,19 +367,33 @@ private:
 
     };
 
-    //m_fileList: storage of data
-    std::vector<FileItem> m_fileList;
+    //append item and request its thumbnail
+    void appendItem(FileItem&& item);
+    //item of a store row, placeholder taken from the cache index so the first frame has it
+    FileItem makeItem(const ExifFileStore& exifFileList, int row) const;
+    //generate thumbnail and placeholder in m_thumbPool, result delivered to GUI thread
+    //jobs hold the item id, so results find their row after other rows were removed
+    void requestThumbnail(FileId itemId);
+    void onPlaceholderReady(FileId itemId, quint64 job, const QString& placeholder); //early, before the thumbnail
+    void onThumbnailReady(FileId itemId, quint64 job, const QString& thumbPath, const QString& placeholder);
+
+    //m_fileList: storage of data, chunked, items never move
+    SlotStore<FileItem> m_fileList;
+    //thumbnail workers, providers are called from these threads
+    QThreadPool m_thumbPool;
+    quint64 m_nextThumbJob = 0;
     //Thumb Provider: WIN32 only
 #if defined(Q_OS_WIN)
     WindowsShellThumbProvider thumbProvider;
 #elif defined(Q_OS_MAC)
     MacThumbProvider thumbProvider;
 #else
-    QtThumbProvider thumbProvider;
+    FreedesktopThumbProvider thumbProvider; //shared desktop thumbnail store, QtThumbProvider as fallback
 #endif
     //cache dir: for portable version, put under path of the .exe
-    const QString m_cacheDir = QCoreApplication::applicationDirPath() + "/cache/zviewer_thumbs";
-    //default thumbnail image width and height
-    const int thumbWidth = 300;
-    const int thumbHeight = 200;
+    const QString m_cacheDir = thumbCacheDir();
+    //index, quota and cleanup of m_cacheDir, consulted before generating thumbnails
+    ThumbCacheManager m_cacheManager{ thumbCacheDir() };
+    //providers render the top level only, lower levels are reduced from it (see ThumbLevels)
+    const QSize m_topLevelSize = QSize(ThumbLevels::TopEdge, ThumbLevels::TopEdge);
 };
@@ -6,19 +6,29 @@
 #include <QStandardPaths>
 #include <QDebug>
 #include <QHash>
+#include <QMap>
 #include <QProcess>
 #include <QStringList>
 #include <QVector>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <algorithm>
+#include <iterator>
+
+#include "trace.h"
+#include "metrics.h"
 
 /*
 This file contains the tool functions of the Exif file pipeline:
-1. resolveExifToolProgram(): resolving exiftool program location by platform.
-2. runExifToolJson(filePath): run exiftool using QProcess and get result in
-QByteArray format.
+1. resolveExifToolProgram(): resolving exiftool program location by platform,
+or the program given by environment variable ZVIEWER_EXIFTOOL. Resolved once,
+exifToolProgram() shares the result with other exiftool users.
+2. runExifToolJson(filePath, tagArgs): run exiftool using QProcess and get
+result in QByteArray format, all tags or only those of an extraction profile.
 3. parseExifJson(jsonData): convert QByteArray into QJsonObject.
+4. extractBasicEntries(filePaths): fast first import pass, only the tags of
+the basic info (aliasTable()) for a whole batch of files in one exiftool run.
 This file contains the implementation of ExifModel:QAbstractListModel class.
 This file contains the getExifModelFromFile(filepath,...) method using tool
 functions mentioned above to construct ExifModel object from given local
@@ -28,6 +38,13 @@ path. It is called by Backend class on runtime to import file.
 //determine exiftool program path by platform information.
 static QString resolveExifToolProgram()
 {
+    //explicit program, e.g. zviewer_exiftool_standin for benchmarks without a real exiftool
+    const QString overridden = qEnvironmentVariable("ZVIEWER_EXIFTOOL");
+    if (!overridden.isEmpty()) {
+        qDebug() << "exiftool overridden by ZVIEWER_EXIFTOOL:" << overridden;
+        return overridden;
+    }
+
 #if defined(Q_OS_WIN)
     const QString appDir = QCoreApplication::applicationDirPath();
     const QString bundled = QDir(appDir).filePath("tools/exiftool.exe");
@@ -67,14 +84,30 @@ static QString resolveExifToolProgram()
 #endif
 }
 
+QString exifToolProgram()
+{
+    static const QString program = resolveExifToolProgram(); //resolve once, thread-safe static init
+    return program;
+}
+
 //run exiftool command and get JSON output in QByteArray
-static QByteArray runExifToolJson(const QString& filePath)
+static QByteArray runExifToolJson(const QString& filePath, const QStringList& tagArgs)
 {
+	static Metrics::Histogram& latency = Metrics::histogram("exiftool"); //process start to output, per file
+	const Metrics::ScopedTimer timer(latency);
 	QProcess process;
-    QString program = resolveExifToolProgram();
+    const QString program = exifToolProgram();
 	QStringList args;
-	args << "-G" << "-a" << "-json" << "-charset" << "UTF8" << filePath;
-	process.start(program, args);
+	args << "-G" << "-a" << "-json" << "-charset" << "UTF8" << tagArgs << filePath; //no tag arguments: everything
+	{
+		ZV_TRACE_SCOPE("exiftool.spawn");
+		process.start(program, args);
+		if (!process.waitForStarted()) {
+			qWarning() << "Failed to run exiftool";
+			return QByteArray();
+		}
+	}
+	ZV_TRACE_SCOPE("exiftool.run");
 	if (!process.waitForFinished()) {
 		qWarning() << "Failed to run exiftool";
 		return QByteArray();
@@ -91,6 +124,7 @@ static QByteArray runExifToolJson(const QString& filePath)
 //convert JSON data in QByteArray to QJsonObject
 static QJsonObject parseExifJson(const QByteArray& jsonData)
 {
+	ZV_TRACE_SCOPE("json.parse");
 	QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData);// Parse JSON data
 
 	if (jsonDoc.isNull() || !jsonDoc.isArray()) {
@@ -159,6 +193,120 @@ void ExifModel::setEntries(const QVector<TagEntry>& entries)
 	endResetModel();//end model reset, UI will update on this signal
 }
 
+//rows to change, remove and insert when the entries of some tags are replaced
+struct TagPatch {
+	QVector<QPair<int, QString>> changed; //row, new value
+	QVector<int> removed; //rows, ascending
+	QMap<int, QVector<TagEntry>> inserted; //entries inserted before row
+	QStringList groups; //groups touched by any of the above
+};
+
+static bool matchesTag(const TagEntry& e, const QStringList& tags)
+{
+	for (const QString& t : tags) {
+		const int colon = t.indexOf(QLatin1Char(':'));
+		if (colon < 0 ? e.tag.compare(t, Qt::CaseInsensitive) == 0
+		              : (e.tag.compare(QStringView(t).mid(colon + 1), Qt::CaseInsensitive) == 0
+		                 && e.group.compare(QStringView(t).left(colon), Qt::CaseInsensitive) == 0))
+			return true;
+	}
+	return false;
+}
+
+//old rows of a group:tag take the fresh values in order, surplus rows go, new group:tags
+//are inserted after the last row of their group (appended for a new group)
+static TagPatch planTagPatch(const QVector<TagEntry>& entries, const QStringList& tags, const QVector<TagEntry>& fresh)
+{
+	TagPatch patch;
+	QHash<QString, QVector<int>> freshByKey; //group:tag -> positions in fresh, in order
+	for (int i = 0; i < fresh.size(); ++i) {
+		if (matchesTag(fresh[i], tags))
+			freshByKey[fresh[i].group + QLatin1Char(':') + fresh[i].tag].push_back(i);
+	}
+	QHash<QString, int> lastRowOfGroup;
+	for (int row = 0; row < entries.size(); ++row) {
+		const TagEntry& e = entries[row];
+		lastRowOfGroup.insert(e.group, row);
+		if (!matchesTag(e, tags))
+			continue;
+		auto it = freshByKey.find(e.group + QLatin1Char(':') + e.tag);
+		if (it == freshByKey.end() || it->isEmpty()) {
+			patch.removed << row;
+			patch.groups << e.group;
+			continue;
+		}
+		const QString& value = fresh[it->takeFirst()].value;
+		if (value != e.value) {
+			patch.changed.push_back({ row, value });
+			patch.groups << e.group;
+		}
+	}
+	//fresh entries without a row, in their order in fresh
+	QVector<int> rest;
+	for (const auto& positions : std::as_const(freshByKey))
+		rest << positions;
+	std::sort(rest.begin(), rest.end());
+	for (int i : rest) {
+		const TagEntry& e = fresh[i];
+		patch.inserted[lastRowOfGroup.value(e.group, int(entries.size()) - 1) + 1].push_back(e);
+		patch.groups << e.group;
+	}
+	patch.groups.removeDuplicates();
+	return patch;
+}
+
+QStringList ExifModel::patchTags(const QStringList& tags, const QVector<TagEntry>& fresh)
+{
+	const TagPatch patch = planTagPatch(m_entries, tags, fresh);
+	for (const auto& c : patch.changed) {
+		m_entries[c.first].value = c.second;
+		emit dataChanged(index(c.first), index(c.first), { ValueRole });
+	}
+	//removals and inserts from the back, rows in front keep their numbers
+	int r = int(patch.removed.size()) - 1;
+	auto ins = patch.inserted.constEnd();
+	while (r >= 0 || ins != patch.inserted.constBegin()) {
+		const int insertAt = ins != patch.inserted.constBegin() ? std::prev(ins).key() : -1;
+		if (r >= 0 && patch.removed[r] >= insertAt) {
+			const int row = patch.removed[r--];
+			beginRemoveRows(QModelIndex(), row, row);
+			m_entries.remove(row);
+			endRemoveRows();
+		} else {
+			--ins;
+			const QVector<TagEntry>& block = ins.value();
+			beginInsertRows(QModelIndex(), insertAt, insertAt + int(block.size()) - 1);
+			for (int i = 0; i < block.size(); ++i)
+				m_entries.insert(insertAt + i, block[i]);
+			endInsertRows();
+		}
+	}
+	if (!patch.removed.isEmpty() || !patch.inserted.isEmpty())
+		m_groupsDirty = true; //a group may have appeared or gone
+	rebuildBasicInfo();
+	return patch.groups;
+}
+
+QVector<TagEntry> patchTagEntries(QVector<TagEntry> entries, const QStringList& tags, const QVector<TagEntry>& fresh)
+{
+	const TagPatch patch = planTagPatch(entries, tags, fresh);
+	for (const auto& c : patch.changed)
+		entries[c.first].value = c.second;
+	int r = int(patch.removed.size()) - 1;
+	auto ins = patch.inserted.constEnd();
+	while (r >= 0 || ins != patch.inserted.constBegin()) {
+		const int insertAt = ins != patch.inserted.constBegin() ? std::prev(ins).key() : -1;
+		if (r >= 0 && patch.removed[r] >= insertAt) {
+			entries.remove(patch.removed[r--]);
+		} else {
+			--ins;
+			for (int i = 0; i < ins.value().size(); ++i)
+				entries.insert(insertAt + i, ins.value()[i]);
+		}
+	}
+	return entries;
+}
+
 //query methods
 QStringList ExifModel::getGroups() const
 {
@@ -368,25 +516,9 @@ static inline QString fmtFps(QString v)
     return QStringLiteral("%1 FPS").arg(v);
 }
 
-void ExifModel::rebuildBasicInfo()
+//basic info fields of entries, first match by group priority, formatted; thread-safe
+static void resolveBasicFields(const QVector<TagEntry>& entries, QString (&fields)[static_cast<int>(FieldId::Count)])
 {
-    // 1. clear all basic variables
-    m_fileName.clear();
-    m_fileSize.clear();
-    m_imageSize.clear();
-    m_dateTaken.clear();
-
-    m_aperture.clear();
-    m_shutterSpeed.clear();
-    m_iso.clear();
-    m_focalLength.clear();
-
-    m_camera.clear();
-    m_lensModel.clear();
-
-    m_duration.clear();
-    m_frameRate.clear();
-
     // 2) first-match indicator, if ture, skip this var
     bool filled[static_cast<int>(FieldId::Count)] = { false };
 
@@ -425,27 +557,8 @@ void ExifModel::rebuildBasicInfo()
         if (out.isEmpty())
             return;            // 关键：格式化后为空 -> 不写入、不锁定
 
-        // 真正写入成员变量
-        switch (fid) {
-        case FieldId::FileName:     m_fileName = out; break;
-        case FieldId::FileSize:     m_fileSize = out; break;
-        case FieldId::ImageSize:    m_imageSize = out; break;
-        case FieldId::DateTaken:    m_dateTaken = out; break;
-
-        case FieldId::Aperture:     m_aperture = out; break;
-        case FieldId::ShutterSpeed: m_shutterSpeed = out; break;
-        case FieldId::ISO:          m_iso = out; break;
-        case FieldId::FocalLength:  m_focalLength = out; break;
-
-        case FieldId::Camera:  m_camera = out; break;
-        case FieldId::LensModel:    m_lensModel = out; break;
-
-        case FieldId::Duration:     m_duration = out; break;
-        case FieldId::FrameRate:    m_frameRate = out; break;
-
-        case FieldId::Count:
-            break;
-        }
+        // 真正写入
+        fields[i] = out;
 
         filled[i] = true;      //only mark as written if non-empty value found
     };
@@ -473,22 +586,68 @@ void ExifModel::rebuildBasicInfo()
 
     // 3.1 优先组
     for (const QString& g : GROUP_ORDER) {
-        for (const TagEntry& e : m_entries) {
+        for (const TagEntry& e : entries) {
             if (e.group == g)
                 processEntry(e);
         }
     }
 
     // 3.2 其它组（兜底）
-    for (const TagEntry& e : m_entries) {
+    for (const TagEntry& e : entries) {
         if (!GROUP_ORDER.contains(e.group))
             processEntry(e);
     }
 }
 
+void ExifModel::rebuildBasicInfo()
+{
+    ZV_TRACE_SCOPE("model.rebuildBasicInfo");
+    // 1. all fields empty unless found
+    QString fields[static_cast<int>(FieldId::Count)];
+    resolveBasicFields(m_entries, fields);
+
+    m_fileName = fields[static_cast<int>(FieldId::FileName)];
+    m_fileSize = fields[static_cast<int>(FieldId::FileSize)];
+    m_imageSize = fields[static_cast<int>(FieldId::ImageSize)];
+    m_dateTaken = fields[static_cast<int>(FieldId::DateTaken)];
+
+    m_aperture = fields[static_cast<int>(FieldId::Aperture)];
+    m_shutterSpeed = fields[static_cast<int>(FieldId::ShutterSpeed)];
+    m_iso = fields[static_cast<int>(FieldId::ISO)];
+    m_focalLength = fields[static_cast<int>(FieldId::FocalLength)];
+
+    m_camera = fields[static_cast<int>(FieldId::Camera)];
+    m_lensModel = fields[static_cast<int>(FieldId::LensModel)];
+
+    m_duration = fields[static_cast<int>(FieldId::Duration)];
+    m_frameRate = fields[static_cast<int>(FieldId::FrameRate)];
+}
+
+QVariantMap basicInfoOf(const QVector<TagEntry>& entries)
+{
+    QString fields[static_cast<int>(FieldId::Count)];
+    resolveBasicFields(entries, fields);
+    auto f = [&fields](FieldId id) { return fields[static_cast<int>(id)]; };
+    return {
+        { "fileName",      f(FieldId::FileName) },
+        { "fileSize",      f(FieldId::FileSize) },
+        { "imageSize",     f(FieldId::ImageSize) },
+        { "dateTaken",     f(FieldId::DateTaken) },
+        { "aperture",      f(FieldId::Aperture) },
+        { "shutterSpeed",  f(FieldId::ShutterSpeed) },
+        { "iso",           f(FieldId::ISO) },
+        { "focalLength",   f(FieldId::FocalLength) },
+        { "camera",   f(FieldId::Camera) },
+        { "lensModel",   f(FieldId::LensModel) },
+        { "duration",   f(FieldId::Duration) },
+        { "frameRate",   f(FieldId::FrameRate) }
+    };
+}
+
 //convert QJsonObject to QVector of TagEntry structs
 QVector<TagEntry> parseExifTags(const QJsonObject& jsonObject)
 {
+	ZV_TRACE_SCOPE("json.parseExifTags");
 	QVector<TagEntry> entries;
 	entries.reserve(jsonObject.size());
 	for (auto it = jsonObject.constBegin(); it != jsonObject.constEnd(); ++it) //traverse all 
@@ -546,26 +705,96 @@ QVector<TagEntry> parseExifTags(const QJsonObject& jsonObject)
 
 }
 
-//Single-threaded method of getting ExifModel object from given local file path.
-std::unique_ptr<ExifModel> getExifModelFromFile(const QString& filePath, QObject* parent)
+//tag names of all basic info aliases, as exiftool tag arguments
+static QStringList basicTagArguments()
 {
-	auto modelptr = std::make_unique<ExifModel>();// do not set parent object, or will double delete
+    QStringList args;
+    const auto& a = aliasTable();
+    for (auto it = a.begin(); it != a.end(); ++it) {
+        for (const QString& name : it.value())
+            args << "-" + name;
+    }
+    args.removeDuplicates();
+    return args;
+}
 
-	QByteArray jsonData = runExifToolJson(filePath);
-	if (jsonData.isEmpty()) {
-		//return modelptr; //return pointer to empty model on failure
-		return nullptr;// return nullptr on failure
-	}
+//Thread-safe fast pass over a batch of files: basic info tags only, -fast2 skips maker notes and trailers
+//file names go through stdin (-@ -), so batch size is not limited by command line length
+bool extractBasicEntries(const QStringList& filePaths, QHash<QString, QVector<TagEntry>>* out)
+{
+    if (filePaths.isEmpty())
+        return true;
+
+    const QString program = exifToolProgram();
+    static const QStringList tagArgs = basicTagArguments();
+    QStringList args;
+    args << "-fast2" << "-G" << "-json" << "-charset" << "UTF8" << "-charset" << "filename=UTF8";
+    args << tagArgs << "-@" << "-";
+
+    //exiftool echoes each name as SourceFile, matched back independent of separators
+    QHash<QString, QString> byEcho;
+    QByteArray names;
+    for (const QString& p : filePaths) {
+        byEcho.insert(QDir::cleanPath(QDir::fromNativeSeparators(p)), p);
+        names += p.toUtf8() + '\n';
+    }
+
+    QProcess process;
+    {
+        ZV_TRACE_SCOPE("exiftool.spawn");
+        process.start(program, args);
+        if (!process.waitForStarted()) {
+            qWarning() << "Failed to run exiftool";
+            return false;
+        }
+    }
+    {
+        ZV_TRACE_SCOPE("exiftool.runBatch");
+        process.write(names);
+        process.closeWriteChannel();
+        if (!process.waitForFinished(120000)) {
+            qWarning() << "exiftool basic pass timed out," << filePaths.size() << "files";
+            process.kill();
+            return false;
+        }
+    }
+
+    ZV_TRACE_SCOPE("json.parseBatch");
+    const QJsonDocument jsonDoc = QJsonDocument::fromJson(process.readAllStandardOutput());
+    if (!jsonDoc.isArray())
+        return false; //no file readable at all, exiftool prints nothing
+
+    for (const QJsonValue& v : jsonDoc.array()) {
+        const QJsonObject obj = v.toObject();
+        const QString echo = QDir::cleanPath(QDir::fromNativeSeparators(obj.value("SourceFile").toString()));
+        const auto it = byEcho.constFind(echo);
+        if (it != byEcho.constEnd() && out)
+            out->insert(it.value(), parseExifTags(obj));
+    }
+    return true;
+}
+
+//Thread-safe method of getting parsed entries from given local file path.
+bool extractExifEntries(const QString& filePath, QVector<TagEntry>* out, const QStringList& tagArgs)
+{
+	QByteArray jsonData = runExifToolJson(filePath, tagArgs);
+	if (jsonData.isEmpty())
+		return false;
 
 	QJsonObject jsonObject = parseExifJson(jsonData);
-	if (jsonObject.isEmpty()) {
-		//return modelptr; //return pointer to empty model on failure
-		return nullptr; // return nullptr on failure
-	}
+	if (jsonObject.isEmpty())
+		return false;
 
-	QVector<TagEntry> entries = parseExifTags(jsonObject);
 	//this step does not do sanity check because some files does not contain metadata
+	if (out)
+		*out = parseExifTags(jsonObject);
+	return true;
+}
 
+//construct ExifModel from entries on GUI thread
+std::unique_ptr<ExifModel> makeExifModel(const QVector<TagEntry>& entries)
+{
+	auto modelptr = std::make_unique<ExifModel>();// do not set parent object, or will double delete
 	modelptr->setEntries(entries);
 
     //set basic values
@@ -573,3 +802,14 @@ std::unique_ptr<ExifModel> getExifModelFromFile(const QString& filePath, QObject
 
 	return modelptr;//it is safe to return unique_ptr
 }
+
+//Single-threaded method of getting ExifModel object from given local file path.
+std::unique_ptr<ExifModel> getExifModelFromFile(const QString& filePath, QObject* parent)
+{
+	Q_UNUSED(parent);
+	QVector<TagEntry> entries;
+	if (!extractExifEntries(filePath, &entries))
+		return nullptr;// return nullptr on failure
+
+	return makeExifModel(entries);
+}
@@ -3,6 +3,8 @@
 #include <QDebug> //only for debug and testing purposes
 #include <QVector>
 #include <QString>
+#include <QHash>
+#include <QStringList>
 #include <QAbstractListModel>
 #include <memory>
 
@@ -54,6 +56,9 @@ public:
 	//I/O methods
 	void setEntries(const QVector<TagEntry>& entries); //set entries from QVector<TagEntry>
 	const QVector<TagEntry>& entries() const { return m_entries; } //get all entries
+	//replace the entries of the given tags ("Group:Tag" or tag name) by fresh ones, e.g. after a write
+	//rows of other tags stay untouched, basic info is rebuilt; returns the groups whose rows changed
+	QStringList patchTags(const QStringList& tags, const QVector<TagEntry>& fresh);
 
 	//query methods
 	QStringList getGroups() const; //get list of unique groups in entries
@@ -97,9 +102,32 @@ private:
 
 };
 
+//basic info of plain entries, same keys and formatting as ExifModel::getBasicInfo, thread-safe
+QVariantMap basicInfoOf(const QVector<TagEntry>& entries);
+
+//ExifModel::patchTags on a plain record, for files without a built model
+QVector<TagEntry> patchTagEntries(QVector<TagEntry> entries, const QStringList& tags, const QVector<TagEntry>& fresh);
+
+//exiftool program of this platform or ZVIEWER_EXIFTOOL, resolved once, thread-safe
+QString exifToolProgram();
+
 //convert QJsonObject to QVector of TagEntry structs
 QVector<TagEntry> parseExifTags(const QJsonObject& jsonObject);
 
+//thread-safe part of the pipeline: run exiftool on a local path and parse into entries
+//no QObject is involved, so it can run in import worker threads
+//returns false when exiftool fails or returns no usable JSON
+//tagArgs restricts the tags read (ExtractionProfile::exifToolArgs()), empty for all
+bool extractExifEntries(const QString& filePath, QVector<TagEntry>* out, const QStringList& tagArgs = QStringList());
+
+//thread-safe fast pass of a batch: only the tags needed for basic info, keyed by the given paths
+//files exiftool cannot read are missing from out; false when exiftool did not run
+bool extractBasicEntries(const QStringList& filePaths, QHash<QString, QVector<TagEntry>>* out);
+
+//build ExifModel from parsed entries, basic info included
+//GUI thread only（AbstractListModel items are not thread-safe）
+std::unique_ptr<ExifModel> makeExifModel(const QVector<TagEntry>& entries);
+
 //function from file path to ExifModel object
 //use unique pointer to manage ownership
 //single-threaded version （AbstractListModel items are not thread-safe）
@@ -0,0 +1,39 @@
+#include "imageProviders.h"
+
+#include <QByteArray>
+
+#include "placeholder.h"
+#include "thumbImage.h"
+
+QImage PlaceholderImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    //a few pixels are enough, QML smooth scaling does the blur
+    //default matches the 3:2 thumbnail tiles
+    QSize decodeSize(24, 16);
+    if (requestedSize.width() > 0 && requestedSize.height() > 0)
+        decodeSize = requestedSize.boundedTo(QSize(64, 64));
+
+    const QImage img = Placeholder::decode(Placeholder::fromUrlId(id), decodeSize);
+    if (size)
+        *size = img.size();
+    return img;
+}
+
+QImage ThumbImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    //strip version part
+    const int slash = id.indexOf(QLatin1Char('/'));
+    const QString topPath = QString::fromUtf8(QByteArray::fromHex(id.mid(slash + 1).toLatin1()));
+
+    //no sourceSize set in QML: serve top level
+    const int requestedEdge = qMax(requestedSize.width(), requestedSize.height());
+    const int edge = requestedEdge > 0 ? ThumbLevels::nearest(requestedEdge) : ThumbLevels::TopEdge;
+
+    QImage img(ThumbLevels::levelPath(topPath, edge));
+    if (img.isNull() && edge < ThumbLevels::TopEdge)
+        img = QImage(topPath); //level missing (e.g. cache cleared), fall back to top
+
+    if (size)
+        *size = img.size();
+    return img;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QQuickImageProvider>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+/*
+This file contains the QQuickImageProvider subclasses registered on the QML
+engine in main(). Providers are called by QML Image items with "image://<name>/<id>"
+sources, possibly from Qt Quick loader threads, so they must not touch models.
+*/
+
+//"image://placeholder/<hex of BlurHash>": tiny blurred preview of a thumbnail
+class PlaceholderImageProvider : public QQuickImageProvider
+{
+public:
+    PlaceholderImageProvider() : QQuickImageProvider(QQuickImageProvider::Image) {}
+
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+};
+
+//"image://thumb/<version>/<hex of top level path>": thumbnail level nearest to sourceSize
+//urls are built by ThumbLevels::toUrl()
+class ThumbImageProvider : public QQuickImageProvider
+{
+public:
+    ThumbImageProvider() : QQuickImageProvider(QQuickImageProvider::Image) {}
+
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+};
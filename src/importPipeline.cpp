@@ -0,0 +1,374 @@
+#include "importPipeline.h"
+
+#include <QDebug>
+#include <QThread>
+#include <algorithm>
+
+#include "metrics.h"
+#include "trace.h"
+
+static Metrics::Gauge& queueDepth(int priority)
+{
+    static Metrics::Gauge* const gauges[ImportPipeline::kPriorityCount] = {
+        &Metrics::gauge("import.queue.selected"),
+        &Metrics::gauge("import.queue.visible"),
+        &Metrics::gauge("import.queue.neighbour"),
+        &Metrics::gauge("import.queue.basic"),
+        &Metrics::gauge("import.queue.bulk"),
+    };
+    return *gauges[priority];
+}
+
+ImportPipeline::ImportPipeline(QObject* parent, int workerCount)
+    : QObject{parent}
+    , m_extractor(extractExifEntries)
+    , m_batchExtractor(extractBasicEntries)
+{
+    m_clock.start();
+    m_profile = std::make_shared<const ExtractionProfile>();
+    m_twoPhase = qEnvironmentVariable("ZVIEWER_TWO_PHASE") != "0";
+
+    //exiftool is a separate process per file, so extraction scales with cores
+    const int workers = std::max(1, workerCount > 0 ? workerCount : QThread::idealThreadCount());
+    m_pool.setMaxThreadCount(workers);
+    m_pool.setExpiryTimeout(-1); //workers live as long as the pipeline
+    for (int i = 0; i < workers; ++i)
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    for (int i = 0; i < workers; ++i)
+        m_pool.start([this, i] { workerLoop(i); });
+}
+
+ImportPipeline::~ImportPipeline()
+{
+    cancel();
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_pool.waitForDone();
+    for (const auto& queue : m_queues) {
+        for (const auto& tasks : queue->tasks) {
+            for (const TaskPtr& task : tasks)
+                uncount(*task); //never taken
+        }
+    }
+}
+
+void ImportPipeline::count(Task& task, int priority)
+{
+    task.counted = priority;
+    queueDepth(priority).add(task.files);
+}
+
+void ImportPipeline::uncount(Task& task)
+{
+    const int counted = task.counted.exchange(-1);
+    if (counted >= 0)
+        queueDepth(counted).add(-task.files);
+}
+
+void ImportPipeline::enqueue(const QString& localPath, int requestId, Priority priority)
+{
+    if (localPath.isEmpty())
+        return;
+
+    ++m_pending;
+    schedulePendingNotify();
+
+    auto task = std::make_shared<Task>();
+    task->localPath = localPath;
+    task->requestId = requestId;
+    task->generation = m_generation.load();
+    task->priority = int(priority);
+    task->requestedNs = m_clock.nsecsElapsed();
+    {
+        std::lock_guard<std::mutex> lock(m_byPathMutex);
+        m_byPath.insert(localPath, task); //a later request of the same path is the one promoted
+    }
+    count(*task, int(priority));
+    push(task, int(priority));
+}
+
+void ImportPipeline::enqueueFiles(const QStringList& localPaths, int requestId)
+{
+    if (!m_twoPhase.load()) {
+        //listed right away without metadata, so the rows can be selected and promoted while queued
+        QMetaObject::invokeMethod(this, [this, localPaths, requestId, generation = m_generation.load()] {
+            if (generation != m_generation.load())
+                return;
+            for (const QString& p : localPaths) {
+                if (!p.isEmpty())
+                    emit basicExtracted(p, {}, requestId);
+            }
+        }, Qt::QueuedConnection);
+        for (const QString& p : localPaths)
+            enqueue(p, requestId);
+        return;
+    }
+
+    //one exiftool run per batch, large enough to amortise process start
+    static constexpr int kBasicBatch = 256;
+    for (int first = 0; first < localPaths.size(); first += kBasicBatch) {
+        auto task = std::make_shared<Task>();
+        task->batch = localPaths.mid(first, kBasicBatch);
+        task->batch.removeAll(QString());
+        if (task->batch.isEmpty())
+            continue;
+        task->requestId = requestId;
+        task->generation = m_generation.load();
+        task->priority = int(Priority::Basic);
+        task->requestedNs = m_clock.nsecsElapsed();
+
+        m_pending += task->batch.size();
+        schedulePendingNotify();
+        {
+            //a click on a file of the batch promotes the whole fast pass
+            std::lock_guard<std::mutex> lock(m_byPathMutex);
+            for (const QString& p : std::as_const(task->batch))
+                m_byPath.insert(p, task);
+        }
+        task->files = int(task->batch.size());
+        count(*task, int(Priority::Basic));
+        push(task, int(Priority::Basic));
+    }
+}
+
+bool ImportPipeline::promote(const QString& localPath, Priority priority)
+{
+    TaskPtr task;
+    {
+        std::lock_guard<std::mutex> lock(m_byPathMutex);
+        task = m_byPath.value(localPath).lock();
+    }
+    if (!task || task->claimed.load())
+        return false;
+
+    //only ever raised, the copy in the lower class is skipped when reached
+    int current = task->priority.load();
+    while (int(priority) < current) {
+        if (task->priority.compare_exchange_weak(current, int(priority))) {
+            task->requestedNs = m_clock.nsecsElapsed();
+            //depth moves with the task, unless a worker took it meanwhile
+            int counted = task->counted.load();
+            while (counted >= 0 && !task->counted.compare_exchange_weak(counted, int(priority))) {
+            }
+            if (counted >= 0) {
+                queueDepth(counted).add(-task->files);
+                queueDepth(int(priority)).add(task->files);
+            }
+            push(task, int(priority));
+            break;
+        }
+    }
+    return true;
+}
+
+void ImportPipeline::push(const TaskPtr& task, int priority)
+{
+    const unsigned target = m_nextQueue.fetch_add(1) % unsigned(m_queues.size());
+    {
+        std::lock_guard<std::mutex> lock(m_queues[target]->mutex);
+        m_queues[target]->tasks[priority].push_back(task);
+    }
+    {
+        //counted under the sleep mutex, so no worker misses the wake up
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        ++m_queued;
+    }
+    m_wake.notify_one();
+}
+
+ImportPipeline::TaskPtr ImportPipeline::take(int self)
+{
+    const int count = int(m_queues.size());
+    for (int p = 0; p < kPriorityCount; ++p) {
+        for (int k = 0; k < count; ++k) {
+            const int q = (self + k) % count;
+            WorkerQueue& queue = *m_queues[q];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            auto& tasks = queue.tasks[p];
+            while (!tasks.empty()) {
+                //own queue in order, stolen work from the back
+                TaskPtr task;
+                if (k == 0) {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                } else {
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                }
+                --m_queued;
+                if (!task->claimed.exchange(true)) {
+                    uncount(*task);
+                    return task;
+                }
+                //copy of a promoted or already taken file, look further
+            }
+        }
+    }
+    return nullptr;
+}
+
+void ImportPipeline::workerLoop(int self)
+{
+    while (!m_stopping.load()) {
+        if (TaskPtr task = take(self)) {
+            run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_stopping.load() || m_queued.load() > 0; });
+    }
+}
+
+void ImportPipeline::run(const TaskPtr& task)
+{
+    if (!task->batch.isEmpty()) {
+        runBatch(task);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_byPathMutex);
+        const auto it = m_byPath.find(task->localPath);
+        if (it != m_byPath.end() && it.value().lock() == task)
+            m_byPath.erase(it);
+    }
+
+    const quint64 generation = task->generation;
+    if (generation != m_generation.load()) { //cancelled while queued
+        --m_pending;
+        schedulePendingNotify();
+        return;
+    }
+
+    const std::shared_ptr<const ExtractionProfile> tags = profile();
+    const bool restricted = !tags->isFull();
+    QVector<TagEntry> entries;
+    bool ok = false;
+    {
+        ZV_TRACE_SCOPE("import.extract");
+        ok = m_extractor(task->localPath, &entries, tags->exifToolArgs());
+        if (ok)
+            entries = tags->filter(entries);
+    }
+
+    //deliver on GUI thread, pending is decremented there so it never hits 0 before the last file is appended
+    QMetaObject::invokeMethod(this, [this, task, generation, ok, restricted, entries = std::move(entries)] {
+        --m_pending;
+        schedulePendingNotify();
+        if (generation != m_generation.load())
+            return;
+
+        const int p = task->priority.load();
+        const qint64 ns = m_clock.nsecsElapsed() - task->requestedNs.load();
+        LatencyAcc& acc = m_latency[p];
+        ++acc.count;
+        acc.sumNs += ns;
+        acc.maxNs = std::max(acc.maxNs, ns);
+
+        if (ok)
+            emit fileExtracted(task->localPath, entries, task->requestId, restricted);
+        else
+            emit fileFailed(task->localPath, task->requestId);
+    }, Qt::QueuedConnection);
+}
+
+void ImportPipeline::runBatch(const TaskPtr& task)
+{
+    const QStringList& files = task->batch;
+    {
+        std::lock_guard<std::mutex> lock(m_byPathMutex);
+        for (const QString& p : files) {
+            const auto it = m_byPath.find(p);
+            if (it != m_byPath.end() && it.value().lock() == task)
+                m_byPath.erase(it);
+        }
+    }
+
+    const quint64 generation = task->generation;
+    if (generation != m_generation.load()) { //cancelled while queued
+        m_pending -= files.size();
+        schedulePendingNotify();
+        return;
+    }
+
+    QHash<QString, QVector<TagEntry>> results;
+    if (!profile()->isFull()) {
+        //basic tags outside a restricted profile would be filtered away, list the files without them
+        for (const QString& f : files)
+            results.insert(f, {});
+    } else if (!m_batchExtractor(files, &results)) {
+        qWarning() << "ImportPipeline: fast pass failed, files get the full pass only";
+    }
+
+    //fast results first; full passes are delivered later through the same queue, so never before them
+    QMetaObject::invokeMethod(this, [this, task, generation, results = std::move(results)] {
+        if (generation != m_generation.load())
+            return;
+        const int p = task->priority.load();
+        const qint64 ns = m_clock.nsecsElapsed() - task->requestedNs.load();
+        LatencyAcc& acc = m_latency[p];
+        ++acc.count;
+        acc.sumNs += ns;
+        acc.maxNs = std::max(acc.maxNs, ns);
+        for (const QString& f : task->batch) {
+            const auto it = results.constFind(f);
+            if (it != results.constEnd())
+                emit basicExtracted(f, it.value(), task->requestId);
+        }
+    }, Qt::QueuedConnection);
+
+    //full pass of every file, the batch stops counting as pending once they are queued
+    for (const QString& f : files)
+        enqueue(f, task->requestId, Priority::Bulk);
+    m_pending -= files.size();
+    schedulePendingNotify();
+}
+
+void ImportPipeline::setProfile(const ExtractionProfile& profile)
+{
+    auto p = std::make_shared<const ExtractionProfile>(profile);
+    std::lock_guard<std::mutex> lock(m_profileMutex);
+    m_profile = std::move(p);
+}
+
+std::shared_ptr<const ExtractionProfile> ImportPipeline::profile() const
+{
+    std::lock_guard<std::mutex> lock(m_profileMutex);
+    return m_profile;
+}
+
+void ImportPipeline::cancel()
+{
+    ++m_generation;
+    std::lock_guard<std::mutex> lock(m_byPathMutex);
+    m_byPath.clear(); //queued copies are skipped by generation
+}
+
+ImportPipeline::LatencyStats ImportPipeline::latency(Priority priority) const
+{
+    const LatencyAcc& acc = m_latency[int(priority)];
+    LatencyStats s;
+    s.count = acc.count;
+    s.averageMs = acc.count > 0 ? double(acc.sumNs) / double(acc.count) / 1e6 : 0.0;
+    s.maxMs = double(acc.maxNs) / 1e6;
+    return s;
+}
+
+void ImportPipeline::resetLatency()
+{
+    for (LatencyAcc& acc : m_latency)
+        acc = LatencyAcc();
+}
+
+void ImportPipeline::schedulePendingNotify()
+{
+    bool expected = false;
+    if (!m_notifyQueued.compare_exchange_strong(expected, true))
+        return; //already queued
+    QMetaObject::invokeMethod(this, [this] {
+        m_notifyQueued = false;
+        emit pendingChanged();
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "getExif.h"
+#include "extractionProfile.h"
+
+/*
+This file contains the ImportPipeline class, the background stage of file
+import. enqueue() is thread-safe, so the folder scanner feeds it from its
+workers while the scan is still running.
+
+Each queued file runs exiftool and parseExifTags in a worker thread
+(extractExifEntries). Parsed entries are handed to the GUI thread through
+fileExtracted(), where Backend builds the models; ExifModel and the other
+list models never leave the GUI thread.
+
+Scheduling: every file has a priority class. The selected file goes first,
+then visible thumbnails, then neighbours of the current file, then bulk
+import. Each worker owns one queue per class and steals from the other
+workers when its own queues of a class are empty, so a promoted file is
+picked up by the next worker that finishes, whichever queue it landed in.
+promote() moves a queued file to a higher class without a queue scan: the
+file is queued again and whichever copy is taken first runs it.
+
+Two-phase mode: files queued with enqueueFiles() first go through a fast pass
+in batches (extractBasicEntries, basic info tags only), delivered by
+basicExtracted() so the files can be listed right away. Each file is then
+queued for the full dump in the bulk class and delivered by fileExtracted()
+as usual. With two-phase mode off, enqueueFiles() still delivers every file
+through basicExtracted(), with no entries, before queueing its full pass, so
+rows exist (and can be promoted) while the files wait.
+
+The extraction profile (setProfile()) restricts the full pass to its tags,
+both in the exiftool arguments and in the parsed entries. fileExtracted()
+tells whether a file was read under a restricted profile, the profile in
+effect when its extraction started. Under a restricted profile the fast pass
+does not run exiftool; its files are listed with no entries, like in
+single-pass mode.
+
+Time from request (or promotion) to delivery is measured per class, see
+latency(). Queued files per class are kept in the metrics gauges
+"import.queue.<class>" (selected, visible, neighbour, basic, bulk), shared
+by all pipelines of the process.
+*/
+
+class ImportPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Priority {
+        Selected, //file on display, waiting for its metadata
+        Visible, //thumbnails in the visible part of the list
+        Neighbour, //next and previous of the current file
+        Basic, //fast first pass of two-phase imports
+        Bulk //everything else
+    };
+    static constexpr int kPriorityCount = 5;
+
+    //time to metadata of one priority class, GUI thread
+    struct LatencyStats {
+        qint64 count = 0;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    //extraction step, exchangeable for benchmarks
+    using Extractor = std::function<bool(const QString& localPath, QVector<TagEntry>* out, const QStringList& tagArgs)>;
+    using BatchExtractor = std::function<bool(const QStringList& localPaths, QHash<QString, QVector<TagEntry>>* out)>;
+
+    explicit ImportPipeline(QObject* parent = nullptr, int workers = 0); //0: one worker per core
+    ~ImportPipeline() override; //drop queued files, wait for running extractions
+
+    //thread-safe: queue a local file path, requestId is passed through to the signals
+    void enqueue(const QString& localPath, int requestId, Priority priority = Priority::Bulk);
+
+    //thread-safe: queue files of one import, through the fast pass first in two-phase mode
+    void enqueueFiles(const QStringList& localPaths, int requestId);
+
+    //two-phase import for enqueueFiles(), on by default (ZVIEWER_TWO_PHASE=0 turns it off)
+    bool isTwoPhase() const { return m_twoPhase.load(); }
+    void setTwoPhase(bool enabled) { m_twoPhase = enabled; }
+
+    //thread-safe: raise a queued file to a higher class, false if it is not queued (running, done or unknown)
+    bool promote(const QString& localPath, Priority priority);
+
+    //files queued or extracting, thread-safe
+    int pending() const { return m_pending.load(); }
+
+    //drop all queued files, running extractions finish but are not delivered
+    void cancel();
+
+    //thread-safe: profile of files extracted from now on, queued files included
+    void setProfile(const ExtractionProfile& profile);
+    std::shared_ptr<const ExtractionProfile> profile() const;
+
+    LatencyStats latency(Priority priority) const;
+    void resetLatency();
+
+    //replace extractExifEntries / extractBasicEntries, only before the first enqueue
+    void setExtractor(Extractor extractor) { m_extractor = std::move(extractor); }
+    void setBatchExtractor(BatchExtractor extractor) { m_batchExtractor = std::move(extractor); }
+
+signals:
+    //emitted on GUI thread
+    void basicExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId); //fast pass, full follows
+    //restricted: read under a restricted profile, tags outside it are missing
+    void fileExtracted(const QString& localPath, const QVector<TagEntry>& entries, int requestId, bool restricted);
+    void fileFailed(const QString& localPath, int requestId);
+    void pendingChanged(); //coalesced per event loop pass
+
+private:
+    struct Task {
+        QString localPath;
+        QStringList batch; //files of a fast pass task, localPath is empty then
+        int requestId = 0;
+        quint64 generation = 0;
+        std::atomic<int> priority{ int(Priority::Bulk) };
+        std::atomic<qint64> requestedNs{ 0 }; //enqueue or last promotion, for latency
+        std::atomic<bool> claimed{ false }; //taken by a worker, other copies are skipped
+        std::atomic<int> counted{ -1 }; //class whose queue depth gauge holds the task, -1 once taken
+        int files = 1; //weight in the gauge, the batch size of a fast pass task
+    };
+    using TaskPtr = std::shared_ptr<Task>;
+
+    //one per worker, other workers steal from the back
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<TaskPtr> tasks[kPriorityCount];
+    };
+
+    void push(const TaskPtr& task, int priority);
+    static void count(Task& task, int priority); //queue depth gauges, when first queued
+    static void uncount(Task& task); //taken or dropped
+    TaskPtr take(int self); //highest class first: own queue, then steal
+    void workerLoop(int self);
+    void run(const TaskPtr& task);
+    void runBatch(const TaskPtr& task);
+    void schedulePendingNotify(); //thread-safe
+
+    QThreadPool m_pool; //long running workers, one exiftool process each
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+    std::atomic<unsigned> m_nextQueue{ 0 }; //round robin target of push
+    std::atomic<int> m_queued{ 0 }; //queue entries incl. promoted copies
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stopping{ false };
+
+    //queued files by path, for promotion
+    std::mutex m_byPathMutex;
+    QHash<QString, std::weak_ptr<Task>> m_byPath;
+
+    mutable std::mutex m_profileMutex;
+    std::shared_ptr<const ExtractionProfile> m_profile;
+
+    Extractor m_extractor;
+    BatchExtractor m_batchExtractor;
+    std::atomic<bool> m_twoPhase{ true };
+    QElapsedTimer m_clock; //monotonic time base of requestedNs
+    std::atomic<int> m_pending{ 0 };
+    std::atomic<quint64> m_generation{ 0 }; //bumped by cancel, stale jobs are skipped
+    std::atomic<bool> m_notifyQueued{ false };
+
+    //latency per class, GUI thread only
+    struct LatencyAcc { qint64 count = 0; qint64 sumNs = 0; qint64 maxNs = 0; };
+    LatencyAcc m_latency[kPriorityCount];
+};
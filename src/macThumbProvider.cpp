@@ -1,4 +1,5 @@
 #include "macThumbProvider.h"
+#include "trace.h"
 #include <QDir>
 #include <QFileInfo>
 
@@ -22,6 +23,7 @@ QString MacThumbProvider::makeThumbnail(const QString& filePath,
     const QString outPath = QDir(cacheDir).filePath(key + ".png");
 
     // 1) Use QuickLook to generate system thumbnail image
+    ZV_TRACE_SCOPE("thumb.quickLook");
     if (macGenerateThumbnailToPng(filePath, targetSize, outPath))
         return outPath;
 
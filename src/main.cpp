@@ -6,6 +6,8 @@
 #include <QDebug>
 #include "backend.h"
 #include "platform.h"
+#include "imageProviders.h"
+#include "trace.h"
 
 //font loading function
 static QString registerAppFont(const QString& qrcPath)
@@ -31,12 +33,16 @@ int main(int argc, char *argv[])
 
     //register Backend as usable type
     qmlRegisterType<Backend>("CppComm", 1, 0, "Backend");
+    Backend::setAutoSession(true); //restore the last session on start, save it on quit
 
     //not required, but precaution
     qmlRegisterUncreatableType<ExifModel>("CppComm", 1, 0, "ExifModel", "C++ only");
     qmlRegisterUncreatableType<FileListModel>("CppComm", 1, 0, "FileListModel", "C++ only");
     qmlRegisterUncreatableType<ExifGroupsModel>("CppComm", 1, 0, "ExifGroupsModel", "C++ only");
     qmlRegisterUncreatableType<EntryListModel>("CppComm", 1, 0, "EntryListModel", "C++ only");
+    qmlRegisterUncreatableType<ThumbCacheManager>("CppComm", 1, 0, "ThumbCacheManager", "C++ only");
+    qmlRegisterUncreatableType<MetricsModel>("CppComm", 1, 0, "MetricsModel", "C++ only");
+    qmlRegisterUncreatableType<RenamePreviewModel>("CppComm", 1, 0, "RenamePreviewModel", "C++ only");
 
     //register fonts
     const QString LatinFamily =
@@ -63,6 +69,10 @@ int main(int argc, char *argv[])
     //pass UI scaling factor to QML
     engine.rootContext()->setContextProperty("FontScale", UiScale::FontScale);
 
+    //image providers, engine takes ownership
+    engine.addImageProvider("placeholder", new PlaceholderImageProvider);
+    engine.addImageProvider("thumb", new ThumbImageProvider);
+
     QObject::connect(
         &engine,
         &QQmlApplicationEngine::objectCreationFailed,
@@ -71,5 +81,7 @@ int main(int argc, char *argv[])
         Qt::QueuedConnection);
     engine.loadFromModule("ZViewerCMake1", "Main");
 
-    return app.exec();
+    const int status = app.exec();
+    Trace::writeRequested(); //ZVIEWER_TRACE=<file> in tracing builds
+    return status;
 }
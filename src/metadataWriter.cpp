@@ -0,0 +1,154 @@
+#include "metadataWriter.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QSet>
+
+#include "exifToolSession.h"
+#include "trace.h"
+
+//exiftool echoes file names in its own way, matched back independent of separators
+static QString echoKey(const QString& path)
+{
+    return QDir::cleanPath(QDir::fromNativeSeparators(path));
+}
+
+MetadataWriter::MetadataWriter(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_pool.setExpiryTimeout(-1); //the exiftool process belongs to this thread
+}
+
+MetadataWriter::~MetadataWriter()
+{
+    m_pool.waitForDone();
+    m_pool.start([this] { m_session.reset(); }); //ended on the thread that started it
+    m_pool.waitForDone();
+}
+
+QStringList MetadataWriter::refreshedTags(const QVector<TagEdit>& edits)
+{
+    QStringList tags;
+    for (const TagEdit& e : edits)
+        tags << e.tag;
+    tags << "File:FileSize" << "File:FileModifyDate"; //changed by every write
+    tags.removeDuplicates();
+    return tags;
+}
+
+int MetadataWriter::write(const QStringList& filePaths, const QVector<TagEdit>& edits)
+{
+    if (filePaths.isEmpty() || edits.isEmpty())
+        return -1;
+    const int id = ++m_nextId;
+    ++m_pending;
+    emit pendingChanged();
+    m_pool.start([this, id, filePaths, edits] { run(id, filePaths, edits); });
+    return id;
+}
+
+void MetadataWriter::run(int id, const QStringList& filePaths, const QVector<TagEdit>& edits)
+{
+    ZV_TRACE_SCOPE("metadata.write");
+    if (!m_session)
+        m_session = std::make_unique<ExifToolSession>();
+
+    QStringList failed;
+    QString error;
+    QHash<QString, QVector<TagEntry>> updated;
+    const QStringList tags = refreshedTags(edits);
+    //bounded commands, a timeout or crash only costs the files of one batch
+    for (int first = 0; first < filePaths.size(); first += kBatchFiles)
+        writeBatch(filePaths.mid(first, kBatchFiles), edits, tags, &updated, &failed, &error);
+    if (!error.isEmpty())
+        qWarning() << "MetadataWriter: write" << id << "failed:" << error;
+
+    QMetaObject::invokeMethod(this, [this, id, tags, updated, failed, error] {
+        --m_pending;
+        emit pendingChanged();
+        emit written(id, tags, updated, failed, error);
+    }, Qt::QueuedConnection);
+}
+
+void MetadataWriter::writeBatch(const QStringList& filePaths, const QVector<TagEdit>& edits, const QStringList& tags,
+                                QHash<QString, QVector<TagEntry>>* updated, QStringList* failed, QString* error)
+{
+    //one command for all files: the edits, then the file names
+    QStringList args;
+    args << "-charset" << "filename=UTF8" << "-overwrite_original";
+    for (const TagEdit& e : edits)
+        args << "-" + e.tag + "=" + (e.remove ? QString() : e.value);
+    args << filePaths;
+
+    QHash<QString, QString> byEcho;
+    for (const QString& p : filePaths)
+        byEcho.insert(echoKey(p), p);
+
+    QByteArray out;
+    QByteArray err;
+    const int timeoutMs = kTimeoutBaseMs + kTimeoutPerFileMs * int(filePaths.size());
+    if (!m_session->execute(args, &out, &err, timeoutMs)) {
+        *failed << filePaths;
+        *error = QStringLiteral("exiftool did not run");
+        return;
+    }
+
+    //"Error: <message> - <file>" per file that was not written, warnings are ignored
+    QSet<QString> failedSet;
+    for (const QByteArray& raw : err.split('\n')) {
+        const QString line = QString::fromUtf8(raw).trimmed();
+        const int dash = line.lastIndexOf(" - ");
+        if (!line.startsWith("Error") || dash < 0)
+            continue;
+        const auto it = byEcho.constFind(echoKey(line.mid(dash + 3)));
+        if (it != byEcho.constEnd())
+            failedSet.insert(it.value());
+    }
+    //nothing updated nor unchanged: the edits themselves are wrong ("Tag 'X' is not defined", "Nothing to do.")
+    static const QRegularExpression done(R"((\d+) image files (updated|unchanged))");
+    int doneCount = 0;
+    for (auto m = done.globalMatch(QString::fromUtf8(out)); m.hasNext();)
+        doneCount += m.next().captured(1).toInt();
+    if (doneCount == 0) {
+        failedSet = QSet<QString>(filePaths.cbegin(), filePaths.cend());
+        *error = QString::fromUtf8(err).trimmed();
+        if (error->isEmpty())
+            *error = QStringLiteral("no file was written");
+    }
+
+    QStringList writtenFiles;
+    for (const QString& p : filePaths) {
+        if (failedSet.contains(p))
+            *failed << p;
+        else
+            writtenFiles << p;
+    }
+    if (writtenFiles.isEmpty())
+        return;
+
+    //read back only what the write touched, one command for all written files
+    //-a like the extraction, so tags present in several groups all come back
+    QStringList readArgs;
+    readArgs << "-G" << "-a" << "-json" << "-charset" << "filename=UTF8";
+    for (const QString& t : tags)
+        readArgs << "-" + t;
+    readArgs << writtenFiles;
+    QByteArray json;
+    if (!m_session->execute(readArgs, &json, nullptr, timeoutMs)) {
+        qWarning() << "MetadataWriter: read back failed," << writtenFiles.size() << "files written";
+        return;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(json);
+    for (const QJsonValue& v : doc.array()) {
+        const QJsonObject obj = v.toObject();
+        const auto it = byEcho.constFind(echoKey(obj.value("SourceFile").toString()));
+        if (it != byEcho.constEnd())
+            updated->insert(it.value(), parseExifTags(obj));
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+
+#include "getExif.h"
+
+class ExifToolSession;
+
+/*
+This file contains the MetadataWriter class, tag editing of session files
+through one long running exiftool (see exifToolSession.h).
+
+1. A write is a list of tag edits applied to a list of files. Each write is
+one exiftool command per kBatchFiles files, with a timeout that grows with
+the batch, so a large selection is never killed as a whole. Writes run one
+after the other on a single background thread that owns the exiftool
+session.
+
+2. A tag is "Group:Tag" (family 0 group, as shown in the info panel, e.g.
+"EXIF:Artist") or a bare tag name, which exiftool writes to its preferred
+groups. An edit with remove set deletes the tag.
+
+3. After writing, only the edited tags (and the file size and date, which
+every write changes) are read back, in a second command for all written
+files. written() delivers them per file, so the session patches its records
+instead of extracting the files again. Composite tags derived from edited
+tags are not read back.
+
+4. Files exiftool reports errors for are not modified (exiftool writes a new
+file and replaces the original only on success) and listed as failed.
+*/
+
+class MetadataWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct TagEdit {
+        QString tag; //"Group:Tag" or tag name
+        QString value;
+        bool remove = false;
+    };
+
+    explicit MetadataWriter(QObject* parent = nullptr);
+    ~MetadataWriter() override; //finish queued writes, then end exiftool
+
+    //queue one write, returns its id, -1 if there are no files or edits
+    int write(const QStringList& filePaths, const QVector<TagEdit>& edits);
+
+    int pending() const { return m_pending; }
+
+    //tags read back after a write of these edits, the keys given to ExifModel::patchTags
+    static QStringList refreshedTags(const QVector<TagEdit>& edits);
+
+signals:
+    void pendingChanged();
+    //GUI thread; updated: fresh entries of the refreshed tags per written file
+    //failed: files exiftool did not write; error: message of a write that did not run at all
+    void written(int id, const QStringList& tags, const QHash<QString, QVector<TagEntry>>& updated,
+                 const QStringList& failed, const QString& error);
+
+private:
+    void run(int id, const QStringList& filePaths, const QVector<TagEdit>& edits); //writer thread
+    //write and read back one batch, results are added to the outputs
+    void writeBatch(const QStringList& filePaths, const QVector<TagEdit>& edits, const QStringList& tags,
+                    QHash<QString, QVector<TagEntry>>* updated, QStringList* failed, QString* error);
+
+    static constexpr int kBatchFiles = 256;
+    static constexpr int kTimeoutBaseMs = 30000; //exiftool start up
+    static constexpr int kTimeoutPerFileMs = 2000; //rewriting a large raw file on a slow disk
+
+    QThreadPool m_pool; //single thread that never expires, the exiftool process belongs to it
+    std::unique_ptr<ExifToolSession> m_session; //writer thread only
+    int m_nextId = 0;
+    int m_pending = 0; //GUI thread
+};
@@ -0,0 +1,130 @@
+#include "metrics.h"
+
+#include <QFile>
+#include <QHash>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+#if defined(Q_OS_WIN)
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(Q_OS_MACOS)
+    #include <mach/mach.h>
+    #include <sys/resource.h>
+#elif defined(Q_OS_UNIX)
+    #include <unistd.h>
+#endif
+
+namespace Metrics {
+
+namespace {
+
+template <typename T>
+T& lookup(const QString& name)
+{
+    static std::mutex mutex;
+    static QHash<QString, std::shared_ptr<T>> registry; //never shrinks, references stay valid
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& slot = registry[name];
+    if (!slot)
+        slot = std::make_shared<T>();
+    return *slot;
+}
+
+}
+
+Counter& counter(const QString& name) { return lookup<Counter>(name); }
+Gauge& gauge(const QString& name) { return lookup<Gauge>(name); }
+Histogram& histogram(const QString& name) { return lookup<Histogram>(name); }
+
+int Histogram::bucketOf(qint64 us)
+{
+    if (us < 1)
+        return 0;
+    const int b = int(std::log2(double(us)) * kPerOctave);
+    return std::min(b, kBuckets - 1);
+}
+
+double Histogram::bucketMidUs(int bucket)
+{
+    return std::exp2((bucket + 0.5) / kPerOctave);
+}
+
+void Histogram::record(qint64 us)
+{
+    m_buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+double Histogram::percentileMs(double p) const
+{
+    const qint64 total = count();
+    if (total <= 0)
+        return 0.0;
+    const qint64 rank = std::max<qint64>(1, qint64(std::ceil(p * double(total))));
+    qint64 seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += m_buckets[b].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return bucketMidUs(b) / 1000.0;
+    }
+    return bucketMidUs(kBuckets - 1) / 1000.0; //concurrent records, count ran ahead of the buckets
+}
+
+qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return qint64(pmc.WorkingSetSize);
+    return -1;
+#elif defined(Q_OS_MACOS)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return qint64(info.resident_size);
+    return -1;
+#elif defined(Q_OS_UNIX)
+    //second field of statm: resident pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly))
+        return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+qint64 peakResidentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return qint64(pmc.PeakWorkingSetSize);
+    return -1;
+#elif defined(Q_OS_MACOS)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return qint64(usage.ru_maxrss); //bytes on macOS
+    return -1;
+#elif defined(Q_OS_UNIX)
+    //"VmHWM:   123456 kB"
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly))
+        return -1;
+    for (const QByteArray& line : status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong() * 1024;
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+/*
+This file contains the runtime metrics registry: counters, gauges and
+latency histograms, registered by name and updated from any thread without
+locks. Backend reads them once per second for the metrics overlay and the
+periodic log line (see Backend::metrics).
+
+Lookups by name take a lock, so hot paths keep the reference:
+    static Metrics::Histogram& h = Metrics::histogram("exiftool");
+    const Metrics::ScopedTimer timer(h);
+
+Histograms keep 4 buckets per power of two of microseconds, percentiles are
+accurate to about 10%. Values are cumulative since start.
+*/
+
+namespace Metrics {
+
+class Counter
+{
+public:
+    void add(qint64 n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{ 0 };
+};
+
+class Gauge
+{
+public:
+    void set(qint64 v) { m_value.store(v, std::memory_order_relaxed); }
+    void add(qint64 n) { m_value.fetch_add(n, std::memory_order_relaxed); } //up and down, e.g. queue depths
+    qint64 value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> m_value{ 0 };
+};
+
+class Histogram
+{
+public:
+    void record(qint64 us);
+    qint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    double percentileMs(double p) const; //p in 0..1, 0 if empty
+
+private:
+    static constexpr int kPerOctave = 4;
+    static constexpr int kBuckets = kPerOctave * 40; //up to ~12 days
+    static int bucketOf(qint64 us);
+    static double bucketMidUs(int bucket);
+
+    std::atomic<qint64> m_buckets[kBuckets] = {};
+    std::atomic<qint64> m_count{ 0 };
+};
+
+//registered on first use, references stay valid for the whole run
+Counter& counter(const QString& name);
+Gauge& gauge(const QString& name);
+Histogram& histogram(const QString& name);
+
+//records the lifetime of the scope into a histogram
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram) : m_histogram(histogram) { m_timer.start(); }
+    ~ScopedTimer() { m_histogram.record(m_timer.nsecsElapsed() / 1000); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& m_histogram;
+    QElapsedTimer m_timer;
+};
+
+//resident memory of this process in bytes, -1 if unknown on this platform
+qint64 residentBytes();
+qint64 peakResidentBytes(); //high-water mark since start
+
+}
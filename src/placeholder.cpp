@@ -0,0 +1,222 @@
+#include "placeholder.h"
+
+#include <QByteArray>
+#include <QImageReader>
+#include <QVector>
+#include <QtMath>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "areaScaler.h"
+#include "thumbImage.h"
+#include "trace.h"
+
+namespace Placeholder {
+
+static const char kBase83[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz#$%*+,-.:;=?@[]^_{|}~";
+
+//encoding works on a tiny copy, the result does not change visibly above 32 px
+static constexpr int kSampleEdge = 32;
+
+static void appendBase83(QString& out, int value, int length)
+{
+    for (int i = 1; i <= length; ++i) {
+        int divisor = 1;
+        for (int k = 0; k < length - i; ++k)
+            divisor *= 83;
+        out.append(QLatin1Char(kBase83[(value / divisor) % 83]));
+    }
+}
+
+static int decodeBase83(const QString& str, int from, int length)
+{
+    int value = 0;
+    for (int i = from; i < from + length; ++i) {
+        const char* p = std::strchr(kBase83, str.at(i).toLatin1());
+        if (!p || *p == '\0')
+            return -1;
+        value = value * 83 + int(p - kBase83);
+    }
+    return value;
+}
+
+//sRGB <-> linear conversion, a LUT for the 256 input values
+static double srgbToLinear(int v)
+{
+    static const std::array<double, 256> lut = [] {
+        std::array<double, 256> t{};
+        for (int i = 0; i < 256; ++i) {
+            const double c = i / 255.0;
+            t[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+        }
+        return t;
+    }();
+    return lut[std::clamp(v, 0, 255)];
+}
+
+static int linearToSrgb(double v)
+{
+    v = std::clamp(v, 0.0, 1.0);
+    if (v <= 0.0031308)
+        return int(v * 12.92 * 255.0 + 0.5);
+    return int((1.055 * std::pow(v, 1.0 / 2.4) - 0.055) * 255.0 + 0.5);
+}
+
+static double signPow(double v, double exp)
+{
+    return std::copysign(std::pow(std::abs(v), exp), v);
+}
+
+QString encode(const QImage& image)
+{
+    ZV_TRACE_SCOPE("thumb.placeholder");
+    if (image.isNull())
+        return {};
+
+    //reduce first, then work in 32 bit RGB
+    QImage small = AreaScaler::downscale(image, QSize(kSampleEdge, kSampleEdge))
+        .convertToFormat(QImage::Format_RGB32);
+    if (small.isNull())
+        return {};
+
+    const int w = small.width();
+    const int h = small.height();
+
+    //DCT factors of every component
+    std::array<std::array<double, 3>, ComponentsX * ComponentsY> factors{};
+    for (int j = 0; j < ComponentsY; ++j) {
+        for (int i = 0; i < ComponentsX; ++i) {
+            double r = 0, g = 0, b = 0;
+            for (int y = 0; y < h; ++y) {
+                const QRgb* line = reinterpret_cast<const QRgb*>(small.constScanLine(y));
+                const double cy = std::cos(M_PI * j * y / h);
+                for (int x = 0; x < w; ++x) {
+                    const double basis = std::cos(M_PI * i * x / w) * cy;
+                    r += basis * srgbToLinear(qRed(line[x]));
+                    g += basis * srgbToLinear(qGreen(line[x]));
+                    b += basis * srgbToLinear(qBlue(line[x]));
+                }
+            }
+            const double scale = ((i == 0 && j == 0) ? 1.0 : 2.0) / (w * h);
+            factors[j * ComponentsX + i] = { r * scale, g * scale, b * scale };
+        }
+    }
+
+    QString hash;
+    hash.reserve(4 + 2 * ComponentsX * ComponentsY);
+    appendBase83(hash, (ComponentsX - 1) + (ComponentsY - 1) * 9, 1); //size flag
+
+    //AC components share one quantised maximum
+    double actualMax = 0;
+    for (size_t k = 1; k < factors.size(); ++k)
+        for (double c : factors[k])
+            actualMax = std::max(actualMax, std::abs(c));
+    const int quantisedMax = std::clamp(int(std::floor(actualMax * 166 - 0.5)), 0, 82);
+    const double maxValue = (quantisedMax + 1) / 166.0;
+    appendBase83(hash, quantisedMax, 1);
+
+    //DC: average colour
+    const auto& dc = factors[0];
+    appendBase83(hash, (linearToSrgb(dc[0]) << 16) + (linearToSrgb(dc[1]) << 8) + linearToSrgb(dc[2]), 4);
+
+    //AC: 19 levels per channel
+    for (size_t k = 1; k < factors.size(); ++k) {
+        int q[3];
+        for (int c = 0; c < 3; ++c)
+            q[c] = std::clamp(int(std::floor(signPow(factors[k][c] / maxValue, 0.5) * 9 + 9.5)), 0, 18);
+        appendBase83(hash, q[0] * 19 * 19 + q[1] * 19 + q[2], 2);
+    }
+    return hash;
+}
+
+QString encodeFile(const QString& imagePath)
+{
+    if (imagePath.isEmpty())
+        return {};
+    QImageReader reader(imagePath);
+    return encode(readThumbImage(reader, QSize(kSampleEdge, kSampleEdge)));
+}
+
+QString encodeSource(const QString& filePath)
+{
+    QImageReader reader(filePath);
+    if (!scalesWhileDecoding(reader))
+        return {}; //the placeholder comes with the thumbnail then
+    return encode(readThumbImage(reader, QSize(kSampleEdge, kSampleEdge)));
+}
+
+bool isValid(const QString& hash)
+{
+    if (hash.size() < 6)
+        return false;
+    const int flag = decodeBase83(hash, 0, 1);
+    if (flag < 0)
+        return false;
+    const int nx = flag % 9 + 1;
+    const int ny = flag / 9 + 1;
+    return hash.size() == 4 + 2 * nx * ny;
+}
+
+QImage decode(const QString& hash, const QSize& size)
+{
+    if (!isValid(hash) || size.isEmpty())
+        return {};
+
+    const int flag = decodeBase83(hash, 0, 1);
+    const int nx = flag % 9 + 1;
+    const int ny = flag / 9 + 1;
+    const double maxValue = (decodeBase83(hash, 1, 1) + 1) / 166.0;
+
+    QVector<std::array<double, 3>> colors(nx * ny);
+    const int dc = decodeBase83(hash, 2, 4);
+    if (dc < 0)
+        return {};
+    colors[0] = { srgbToLinear(dc >> 16), srgbToLinear((dc >> 8) & 0xff), srgbToLinear(dc & 0xff) };
+    for (int k = 1; k < nx * ny; ++k) {
+        const int v = decodeBase83(hash, 4 + k * 2, 2);
+        if (v < 0)
+            return {};
+        colors[k] = { signPow((v / (19 * 19) - 9) / 9.0, 2.0) * maxValue,
+                      signPow(((v / 19) % 19 - 9) / 9.0, 2.0) * maxValue,
+                      signPow((v % 19 - 9) / 9.0, 2.0) * maxValue };
+    }
+
+    QImage out(size, QImage::Format_RGB32);
+    const int w = size.width();
+    const int h = size.height();
+    for (int y = 0; y < h; ++y) {
+        QRgb* line = reinterpret_cast<QRgb*>(out.scanLine(y));
+        for (int x = 0; x < w; ++x) {
+            double r = 0, g = 0, b = 0;
+            for (int j = 0; j < ny; ++j) {
+                const double cy = std::cos(M_PI * y * j / h);
+                for (int i = 0; i < nx; ++i) {
+                    const double basis = std::cos(M_PI * x * i / w) * cy;
+                    const auto& c = colors[j * nx + i];
+                    r += c[0] * basis;
+                    g += c[1] * basis;
+                    b += c[2] * basis;
+                }
+            }
+            line[x] = qRgb(linearToSrgb(r), linearToSrgb(g), linearToSrgb(b));
+        }
+    }
+    return out;
+}
+
+QString toUrl(const QString& hash)
+{
+    if (hash.isEmpty())
+        return {};
+    return QStringLiteral("image://placeholder/") + QString::fromLatin1(hash.toLatin1().toHex());
+}
+
+QString fromUrlId(const QString& id)
+{
+    return QString::fromLatin1(QByteArray::fromHex(id.toLatin1()));
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+/*
+This file contains the tiny placeholder previews of thumbnails. A placeholder
+is a BlurHash string (4x3 DCT components, 28 chars) computed from the finished
+thumbnail during thumbnail generation. It is stored with the file record and
+decoded into a few pixels by PlaceholderImageProvider, so QML can paint a
+blurred colour impression of every tile before the real thumbnail is loaded.
+Rows take known placeholders from the thumbnail cache index when they are
+built. For new files a first placeholder comes from a cheap scaled decode of
+the source (encodeSource) while the thumbnail is still being generated.
+
+Reference of the format: https://github.com/woltapp/blurhash
+*/
+
+namespace Placeholder {
+
+//number of components, 4x3 matches the 3:2 tiles of the thumbnail panel
+inline constexpr int ComponentsX = 4;
+inline constexpr int ComponentsY = 3;
+
+//encode image into a BlurHash string, empty on failure
+//image is reduced internally, any size is accepted
+QString encode(const QImage& image);
+
+//encode from an image file (thumbnail cache), empty on failure
+QString encodeFile(const QString& imagePath);
+
+//encode straight from a source file before its thumbnail exists, empty on failure
+//only for decoders that scale while decoding (JPEG), anything else would cost a full decode
+QString encodeSource(const QString& filePath);
+
+//decode BlurHash string into an image of given size, null image on invalid hash
+QImage decode(const QString& hash, const QSize& size);
+
+//check length and size flag of a BlurHash string
+bool isValid(const QString& hash);
+
+//QML url of the placeholder, served by PlaceholderImageProvider ("image://placeholder/...")
+//hash chars like # ? % are not url safe, so the id is hex encoded
+QString toUrl(const QString& hash);
+QString fromUrlId(const QString& id);
+
+}
@@ -0,0 +1,355 @@
+#include "renamePlanner.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMetaObject>
+#include <QSet>
+#include <algorithm>
+
+#include "trace.h"
+
+struct RenamePlanner::Job {
+    quint64 generation = 0;
+    QVector<Token> tokens;
+    QStringList paths;
+    EntryLoader loader;
+    int firstNumber = 1;
+    QVector<Item> items; //each chunk writes its own range
+    std::atomic<int> remaining{ 0 }; //chunks not finished
+};
+
+//keys of ExifModel::getBasicInfo, fields of the template in lower camel case
+static const QStringList& basicFieldNames()
+{
+    static const QStringList names = basicInfoOf({}).keys();
+    return names;
+}
+
+//exiftool date "2024:05:01 12:30:00[.ss][+hh:mm]", invalid for other values
+static QDateTime exifDate(const QString& value)
+{
+    if (value.size() < 19 || value[4] != ':' || value[7] != ':')
+        return {};
+    return QDateTime::fromString(value.left(19), "yyyy:MM:dd HH:mm:ss");
+}
+
+static QString sanitized(QString name)
+{
+    static const QString forbidden = QStringLiteral("/\\:*?\"<>|");
+    for (QChar& c : name) {
+        if (forbidden.contains(c) || c.unicode() < 0x20)
+            c = '-';
+    }
+    //trailing dots and spaces are dropped by Windows
+    while (name.endsWith('.') || name.endsWith(' '))
+        name.chop(1);
+    return name.trimmed();
+}
+
+RenamePlanner::RenamePlanner(QObject* parent)
+    : QObject(parent)
+{
+}
+
+RenamePlanner::~RenamePlanner()
+{
+    ++m_generation;
+    m_pool.waitForDone();
+}
+
+int RenamePlanner::renameCount() const
+{
+    return int(std::count_if(m_items.cbegin(), m_items.cend(), [](const Item& i) { return i.status == Status::Ok; }));
+}
+
+QVector<RenamePlanner::Token> RenamePlanner::parse(const QString& pattern, QString* error)
+{
+    QVector<Token> tokens;
+    QString literal;
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        if (c == '}') {
+            if (error)
+                *error = QStringLiteral("unmatched } at %1").arg(i + 1);
+            return {};
+        }
+        if (c != '{') {
+            literal += c;
+            continue;
+        }
+        const int close = pattern.indexOf('}', i + 1);
+        const QString inner = close < 0 ? QString() : pattern.mid(i + 1, close - i - 1).trimmed();
+        if (close < 0 || inner.isEmpty() || inner.contains('{')) {
+            if (error)
+                *error = QStringLiteral("unterminated field at %1").arg(i + 1);
+            return {};
+        }
+        if (!literal.isEmpty())
+            tokens.push_back({ false, literal, QString() });
+        literal.clear();
+        const int bar = inner.indexOf('|');
+        Token t{ true, inner.left(bar).trimmed(), bar < 0 ? QString() : inner.mid(bar + 1) };
+        if (t.text == QLatin1String("seq") && !t.spec.isEmpty()) {
+            bool ok = false;
+            const int width = t.spec.toInt(&ok);
+            if (!ok || width < 1 || width > 12) {
+                if (error)
+                    *error = QStringLiteral("{seq|n}: n must be 1 to 12");
+                return {};
+            }
+        }
+        tokens.push_back(t);
+        i = close;
+    }
+    if (!literal.isEmpty())
+        tokens.push_back({ false, literal, QString() });
+    if (tokens.isEmpty() && error)
+        *error = QStringLiteral("empty template");
+    return tokens;
+}
+
+bool RenamePlanner::checkTemplate(const QString& pattern, QString* error)
+{
+    QString e;
+    const bool ok = !parse(pattern, &e).isEmpty();
+    if (error)
+        *error = e;
+    return ok;
+}
+
+//new base name of one file, empty with the missing field when a field has no value
+QString RenamePlanner::evaluate(const QVector<Token>& tokens, const QString& filePath,
+                                const QVector<TagEntry>& entries, int number, QString* missing)
+{
+    QString out;
+    QVariantMap basic; //built on first use only
+    for (const Token& t : tokens) {
+        if (!t.field) {
+            out += t.text;
+            continue;
+        }
+        QString value;
+        if (t.text == QLatin1String("seq")) {
+            value = QString::number(number).rightJustified(t.spec.isEmpty() ? 4 : t.spec.toInt(), '0');
+        } else if (t.text == QLatin1String("name")) {
+            value = QFileInfo(filePath).completeBaseName();
+        } else if (basicFieldNames().contains(t.text)) {
+            if (basic.isEmpty())
+                basic = basicInfoOf(entries);
+            value = basic.value(t.text).toString();
+        } else {
+            const int colon = t.text.indexOf(':');
+            const QStringView group = colon < 0 ? QStringView() : QStringView(t.text).left(colon);
+            const QStringView tag = QStringView(t.text).mid(colon + 1);
+            for (const TagEntry& e : entries) {
+                if (e.tag.compare(tag, Qt::CaseInsensitive) == 0
+                    && (group.isEmpty() || e.group.compare(group, Qt::CaseInsensitive) == 0)) {
+                    value = e.value.trimmed();
+                    break;
+                }
+            }
+        }
+        if (t.text != QLatin1String("seq")) {
+            const QDateTime date = exifDate(value);
+            if (date.isValid())
+                value = date.toString(t.spec.isEmpty() ? QStringLiteral("yyyyMMdd_HHmmss") : t.spec);
+        }
+        if (value.isEmpty()) {
+            if (missing)
+                *missing = t.text;
+            return {};
+        }
+        out += value;
+    }
+    return sanitized(out);
+}
+
+bool RenamePlanner::plan(const QString& pattern, const QStringList& filePaths, EntryLoader loader, int firstNumber)
+{
+    if (m_applying)
+        return false;
+    QString error;
+    auto job = std::make_shared<Job>();
+    job->tokens = parse(pattern, &error);
+    if (job->tokens.isEmpty()) {
+        qWarning() << "RenamePlanner: invalid template" << pattern << "-" << error;
+        return false;
+    }
+    job->generation = ++m_generation;
+    job->paths = filePaths;
+    job->loader = std::move(loader);
+    job->firstNumber = firstNumber;
+    job->items.resize(filePaths.size());
+    const int chunks = (int(filePaths.size()) + kChunkFiles - 1) / kChunkFiles;
+    job->remaining = chunks;
+
+    if (!m_planning) {
+        m_planning = true;
+        emit busyChanged();
+    }
+    if (chunks == 0) {
+        QMetaObject::invokeMethod(this, [this, job] { onPlanned(job); }, Qt::QueuedConnection);
+        return true;
+    }
+    for (int c = 0; c < chunks; ++c) {
+        const int first = c * kChunkFiles;
+        const int last = std::min(first + kChunkFiles, int(filePaths.size())) - 1;
+        m_pool.start([this, job, first, last] { evaluateChunk(job, first, last); });
+    }
+    return true;
+}
+
+void RenamePlanner::evaluateChunk(const std::shared_ptr<Job>& job, int first, int last)
+{
+    ZV_TRACE_SCOPE("rename.evaluate");
+    for (int i = first; i <= last; ++i) {
+        if (job->generation != m_generation)
+            break; //replaced by a newer plan, the result is dropped anyway
+        Item& item = job->items[i];
+        item.oldPath = job->paths[i];
+        item.newPath = item.oldPath;
+        QString missing;
+        const QString base = evaluate(job->tokens, item.oldPath, job->loader(i), job->firstNumber + i, &missing);
+        if (base.isEmpty()) {
+            item.status = Status::MissingValue;
+            item.message = missing.isEmpty() ? QStringLiteral("empty name") : QStringLiteral("no ") + missing;
+            continue;
+        }
+        const QFileInfo fi(item.oldPath);
+        const QString suffix = fi.suffix();
+        item.newPath = QDir(fi.path()).filePath(suffix.isEmpty() ? base : base + '.' + suffix);
+        item.status = item.newPath == item.oldPath ? Status::Unchanged : Status::Ok;
+    }
+    //the last chunk finds the conflicts of the whole plan
+    if (job->remaining.fetch_sub(1) == 1) {
+        if (job->generation == m_generation) {
+            ZV_TRACE_SCOPE("rename.conflicts");
+            markConflicts(job->items);
+        }
+        QMetaObject::invokeMethod(this, [this, job] { onPlanned(job); }, Qt::QueuedConnection);
+    }
+}
+
+void RenamePlanner::markConflicts(QVector<Item>& items)
+{
+    //every file ends at its new path if renamed, at its old path otherwise
+    QHash<QString, int> finalPaths; //lower case path -> first item
+    QSet<QString> sources;
+    finalPaths.reserve(items.size());
+    sources.reserve(items.size());
+    for (const Item& item : std::as_const(items))
+        sources.insert(item.oldPath.toLower());
+    for (int i = 0; i < items.size(); ++i) {
+        Item& item = items[i];
+        const QString key = item.newPath.toLower();
+        const auto it = finalPaths.constFind(key);
+        if (it == finalPaths.constEnd()) {
+            finalPaths.insert(key, i);
+        } else {
+            Item& other = items[it.value()];
+            const QString otherName = QFileInfo(other.oldPath).fileName();
+            if (item.status == Status::Ok) {
+                item.status = Status::Collision;
+                item.message = QStringLiteral("same name as ") + otherName;
+            }
+            if (other.status == Status::Ok) {
+                other.status = Status::Collision;
+                other.message = QStringLiteral("same name as ") + QFileInfo(item.oldPath).fileName();
+            }
+        }
+        //a file outside the plan has the name already
+        if (item.status == Status::Ok && !sources.contains(key) && QFileInfo::exists(item.newPath)) {
+            item.status = Status::Exists;
+            item.message = QStringLiteral("file exists");
+        }
+    }
+}
+
+void RenamePlanner::onPlanned(const std::shared_ptr<Job>& job)
+{
+    if (job->generation != m_generation)
+        return; //a newer plan is running
+    m_items = std::move(job->items);
+    m_conflicts = int(std::count_if(m_items.cbegin(), m_items.cend(), [](const Item& i) {
+        return i.status == Status::Collision || i.status == Status::Exists;
+    }));
+    m_planning = false;
+    emit busyChanged();
+    emit planned();
+}
+
+bool RenamePlanner::apply()
+{
+    if (isBusy() || m_conflicts > 0)
+        return false;
+    QVector<QPair<QString, QString>> moves;
+    for (const Item& item : std::as_const(m_items)) {
+        if (item.status == Status::Ok)
+            moves.push_back({ item.oldPath, item.newPath });
+    }
+    if (moves.isEmpty())
+        return false;
+    m_applying = true;
+    emit busyChanged();
+    m_pool.start([this, moves] { runApply(moves); });
+    return true;
+}
+
+void RenamePlanner::runApply(const QVector<QPair<QString, QString>>& moves)
+{
+    ZV_TRACE_SCOPE("rename.apply");
+    //completed steps, undone in reverse order on failure
+    QVector<QPair<QString, QString>> done;
+    QString error;
+    auto step = [&](const QString& from, const QString& to) {
+        if (QFile::rename(from, to)) {
+            done.push_back({ from, to });
+            return true;
+        }
+        error = QStringLiteral("cannot rename %1 to %2").arg(QDir::toNativeSeparators(from), QFileInfo(to).fileName());
+        return false;
+    };
+
+    //phase 1: out of the way, to a hidden temporary name in the same folder
+    const QString tag = QStringLiteral(".zvrename-%1-").arg(QCoreApplication::applicationPid());
+    QStringList temps;
+    temps.reserve(moves.size());
+    bool ok = true;
+    for (int i = 0; ok && i < moves.size(); ++i) {
+        const QFileInfo fi(moves[i].first);
+        temps << QDir(fi.absolutePath()).filePath(tag + QString::number(i) + '-' + fi.fileName());
+        ok = step(moves[i].first, temps.last());
+    }
+    //phase 2: to the new names, a name taken meanwhile by another program fails the whole apply
+    for (int i = 0; ok && i < moves.size(); ++i) {
+        if (QFileInfo::exists(moves[i].second)) {
+            error = QStringLiteral("%1 exists").arg(QDir::toNativeSeparators(moves[i].second));
+            ok = false;
+        } else {
+            ok = step(temps[i], moves[i].second);
+        }
+    }
+
+    if (!ok) {
+        for (auto it = done.crbegin(); it != done.crend(); ++it) {
+            if (!QFile::rename(it->second, it->first))
+                qWarning() << "RenamePlanner: rollback failed," << it->second << "stays";
+        }
+        qWarning() << "RenamePlanner: rename rolled back:" << error;
+    }
+
+    const QVector<QPair<QString, QString>> renamed = ok ? moves : QVector<QPair<QString, QString>>();
+    QMetaObject::invokeMethod(this, [this, ok, renamed, error] {
+        m_applying = false;
+        if (ok)
+            m_items.clear(); //names changed, the plan is used up
+        m_conflicts = 0;
+        emit busyChanged();
+        emit applied(ok, renamed, error);
+    }, Qt::QueuedConnection);
+}
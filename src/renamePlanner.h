@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "getExif.h"
+
+/*
+This file contains the RenamePlanner class, batch renaming of session files
+by a file name template over the metadata already in the session.
+
+1. Template: literal text and fields in braces, the file extension is kept.
+    {Tag}, {Group:Tag}   value of the tag, first entry in any group for a bare tag
+    {camera}, {iso} ...  basic info fields as in the bottom panel (keys of
+                         ExifModel::getBasicInfo, lower camel case)
+    {name}               current file name without extension
+    {seq}                running number in plan order, from the first number
+    {Field|spec}         {seq|3}: zero padded width (default 4); date values
+                         ("2024:05:01 12:30:00"): QDateTime format, default
+                         yyyyMMdd_HHmmss
+Characters not allowed in file names (/ \ : * ? " < > |) become '-'.
+
+2. plan() evaluates the template in parallel, in chunks on a thread pool.
+Entries come from a loader that is called from those threads. A file
+missing a field keeps its name and is reported. Afterwards one pass with a
+hash set of the resulting paths (case insensitive, for Windows and macOS
+file systems) marks collisions, and targets that exist on disk and are not
+renamed away themselves. planned() delivers the result on the GUI thread.
+
+3. apply() renames all files of a plan without conflicts, in background.
+Every file first moves to a temporary name in its folder, then to its new
+name, so swaps and chains (a -> b, b -> c) work. If any step fails, all
+completed steps are undone in reverse order and no file keeps a new name.
+*/
+
+class RenamePlanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Status {
+        Ok, //renamed on apply
+        Unchanged, //new name equals the current one
+        MissingValue, //a field has no value, the file keeps its name
+        Collision, //another file of the plan ends up with the same path
+        Exists //another file has the new name already
+    };
+
+    struct Item {
+        QString oldPath;
+        QString newPath; //old path unless Ok or a conflict
+        Status status = Status::Ok;
+        QString message; //missing field or conflicting file
+    };
+
+    //metadata of file i of the plan, called from worker threads concurrently
+    using EntryLoader = std::function<QVector<TagEntry>(int index)>;
+
+    explicit RenamePlanner(QObject* parent = nullptr);
+    ~RenamePlanner() override; //wait for running plan or apply jobs
+
+    //false with a message if the template does not parse
+    static bool checkTemplate(const QString& pattern, QString* error);
+
+    //start a plan, replaces the previous one; false if the template is invalid or an apply runs
+    bool plan(const QString& pattern, const QStringList& filePaths, EntryLoader loader, int firstNumber = 1);
+    //rename the files of the finished plan; false if there is none, it has conflicts or a job runs
+    bool apply();
+    void waitForDone() { m_pool.waitForDone(); } //e.g. before the loader's data goes away
+
+    bool isBusy() const { return m_planning || m_applying; }
+    const QVector<Item>& items() const { return m_items; }
+    int conflicts() const { return m_conflicts; }
+    int renameCount() const; //items with status Ok
+
+signals:
+    void busyChanged();
+    void planned(); //GUI thread, items() holds the plan
+    //GUI thread; renamed: old and new path of every renamed file, empty if rolled back
+    void applied(bool ok, const QVector<QPair<QString, QString>>& renamed, const QString& error);
+
+private:
+    struct Token {
+        bool field = false;
+        QString text; //literal or field name
+        QString spec; //after '|'
+    };
+    struct Job; //shared by the chunks of one plan
+
+    static QVector<Token> parse(const QString& pattern, QString* error);
+    static QString evaluate(const QVector<Token>& tokens, const QString& filePath,
+                            const QVector<TagEntry>& entries, int number, QString* missing);
+    static void markConflicts(QVector<Item>& items); //after all chunks, one thread
+    void evaluateChunk(const std::shared_ptr<Job>& job, int first, int last); //worker threads
+    void onPlanned(const std::shared_ptr<Job>& job);
+    void runApply(const QVector<QPair<QString, QString>>& moves); //worker thread
+
+    static constexpr int kChunkFiles = 256;
+
+    QThreadPool m_pool; //plan chunks and the apply job
+    QVector<Item> m_items;
+    int m_conflicts = 0;
+    bool m_planning = false;
+    bool m_applying = false;
+    std::atomic<quint64> m_generation{ 0 }; //bumped by every plan, chunks of older plans stop early
+};
@@ -0,0 +1,442 @@
+#include "sessionExporter.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+//per column value of a file: "Group:Tag" columns first, then bare tag names
+class ColumnMatcher
+{
+public:
+    explicit ColumnMatcher(const QStringList& columns) : m_count(columns.size())
+    {
+        for (int i = 0; i < columns.size(); ++i) {
+            QHash<QString, int>& index = columns[i].contains(':') ? m_qualified : m_bare;
+            if (!index.contains(columns[i]))
+                index.insert(columns[i], i);
+        }
+    }
+
+    int count() const { return m_count; }
+
+    //null for missing values, present values are never null
+    QVector<QString> values(const QVector<TagEntry>& entries) const
+    {
+        QVector<QString> out(m_count);
+        for (const TagEntry& e : entries) {
+            const QString value = e.value.isNull() ? QString("") : e.value;
+            int i = m_qualified.isEmpty() ? -1 : m_qualified.value(e.group + ':' + e.tag, -1);
+            if (i >= 0 && out[i].isNull())
+                out[i] = value;
+            i = m_bare.value(e.tag, -1);
+            if (i >= 0 && out[i].isNull())
+                out[i] = value;
+        }
+        return out;
+    }
+
+    bool matches(const TagEntry& e) const
+    {
+        return m_bare.contains(e.tag) || (!m_qualified.isEmpty() && m_qualified.contains(e.group + ':' + e.tag));
+    }
+
+private:
+    int m_count;
+    QHash<QString, int> m_qualified;
+    QHash<QString, int> m_bare;
+};
+
+class FormatWriter
+{
+public:
+    virtual ~FormatWriter() = default;
+    virtual void begin(QIODevice&) {}
+    virtual void write(QIODevice& out, const SessionExporter::Record& record) = 0;
+    virtual void end(QIODevice&) {}
+};
+
+static QByteArray csvField(const QString& s)
+{
+    if (!s.contains(',') && !s.contains('"') && !s.contains('\n') && !s.contains('\r'))
+        return s.toUtf8();
+    QString q = s;
+    q.replace("\"", "\"\"");
+    return "\"" + q.toUtf8() + "\"";
+}
+
+class CsvWriter : public FormatWriter
+{
+public:
+    explicit CsvWriter(const QStringList& columns) : m_columns(columns), m_matcher(columns) {}
+
+    void begin(QIODevice& out) override
+    {
+        QByteArray line = "SourceFile";
+        for (const QString& c : m_columns)
+            line += "," + csvField(c);
+        out.write(line + "\n");
+    }
+
+    void write(QIODevice& out, const SessionExporter::Record& record) override
+    {
+        QByteArray line = csvField(record.filePath);
+        for (const QString& v : m_matcher.values(record.entries))
+            line += "," + csvField(v);
+        out.write(line + "\n");
+    }
+
+private:
+    QStringList m_columns;
+    ColumnMatcher m_matcher;
+};
+
+class NdjsonWriter : public FormatWriter
+{
+public:
+    explicit NdjsonWriter(const QStringList& columns) : m_matcher(columns), m_all(columns.isEmpty()) {}
+
+    void write(QIODevice& out, const SessionExporter::Record& record) override
+    {
+        QJsonArray list;
+        for (const TagEntry& e : record.entries) {
+            if (m_all || m_matcher.matches(e))
+                list.append(QJsonObject{ { "group", e.group }, { "tag", e.tag }, { "value", e.value } });
+        }
+        const QJsonObject o{ { "file", record.filePath }, { "entries", list } };
+        out.write(QJsonDocument(o).toJson(QJsonDocument::Compact) + "\n");
+    }
+
+private:
+    ColumnMatcher m_matcher;
+    bool m_all;
+};
+
+template <typename T>
+static void put(QByteArray& b, T v)
+{
+    v = qToLittleEndian(v);
+    b.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+//row groups of up to kRows files, see the format in sessionExporter.h
+class ColumnarWriter : public FormatWriter
+{
+public:
+    explicit ColumnarWriter(const QStringList& columns)
+        : m_names(QStringList{ "SourceFile" } + columns), m_matcher(columns), m_columns(m_names.size())
+    {
+    }
+
+    void begin(QIODevice& out) override
+    {
+        QByteArray b("ZVCOLS01", 8);
+        put<quint32>(b, 1);
+        put<quint32>(b, quint32(m_names.size()));
+        for (const QString& name : m_names) {
+            const QByteArray utf8 = name.toUtf8();
+            put<quint32>(b, quint32(utf8.size()));
+            b += utf8;
+        }
+        out.write(b);
+    }
+
+    void write(QIODevice& out, const SessionExporter::Record& record) override
+    {
+        m_columns[0] << record.filePath;
+        const QVector<QString> values = m_matcher.values(record.entries);
+        for (int c = 0; c < values.size(); ++c)
+            m_columns[c + 1] << values[c];
+        if (++m_rows == kRows)
+            flush(out);
+    }
+
+    void end(QIODevice& out) override
+    {
+        flush(out);
+        QByteArray b;
+        put<quint32>(b, 0);
+        out.write(b);
+    }
+
+private:
+    enum Type : quint8 { String = 0, Int64 = 1, Float64 = 2 };
+    static constexpr int kRows = 4096;
+
+    void flush(QIODevice& out)
+    {
+        if (m_rows == 0)
+            return;
+        QByteArray b;
+        put<quint32>(b, quint32(m_rows));
+        for (QVector<QString>& column : m_columns) {
+            writeColumn(b, column);
+            column.clear();
+        }
+        out.write(b);
+        m_rows = 0;
+    }
+
+    void writeColumn(QByteArray& b, const QVector<QString>& column) const
+    {
+        //narrowest type that holds every present value
+        bool allInt = true;
+        bool allNumber = true;
+        for (const QString& v : column) {
+            if (v.isNull())
+                continue;
+            bool ok = false;
+            v.toLongLong(&ok);
+            allInt = allInt && ok;
+            const double d = v.toDouble(&ok);
+            allNumber = allNumber && ok && std::isfinite(d);
+            if (!allInt && !allNumber)
+                break;
+        }
+        const Type type = allInt ? Int64 : (allNumber ? Float64 : String);
+        b.append(char(type));
+
+        QByteArray validity((column.size() + 7) / 8, '\0');
+        for (int i = 0; i < column.size(); ++i) {
+            if (!column[i].isNull())
+                validity[i / 8] = char(quint8(validity[i / 8]) | (1u << (i % 8)));
+        }
+        b += validity;
+
+        if (type == Int64) {
+            for (const QString& v : column)
+                put<qint64>(b, v.isNull() ? 0 : v.toLongLong());
+        } else if (type == Float64) {
+            for (const QString& v : column) {
+                const double d = v.isNull() ? 0.0 : v.toDouble();
+                quint64 bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                put<quint64>(b, bits);
+            }
+        } else {
+            QByteArray data;
+            put<quint32>(b, 0);
+            for (const QString& v : column) {
+                data += v.toUtf8();
+                put<quint32>(b, quint32(data.size()));
+            }
+            b += data;
+        }
+    }
+
+    QStringList m_names;
+    ColumnMatcher m_matcher;
+    QVector<QVector<QString>> m_columns; //values of the current row group, null = missing
+    int m_rows = 0;
+};
+
+std::unique_ptr<FormatWriter> makeWriter(SessionExporter::Format format, const QStringList& columns)
+{
+    switch (format) {
+    case SessionExporter::Format::Csv:
+        return std::make_unique<CsvWriter>(columns);
+    case SessionExporter::Format::Ndjson:
+        return std::make_unique<NdjsonWriter>(columns);
+    case SessionExporter::Format::Columnar:
+        return std::make_unique<ColumnarWriter>(columns);
+    }
+    return nullptr;
+}
+
+}
+
+SessionExporter::SessionExporter(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(1);
+    m_progressTimer.setInterval(100);
+    connect(&m_progressTimer, &QTimer::timeout, this, [this] { emit progressChanged(written(), m_total); });
+}
+
+SessionExporter::~SessionExporter()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+bool SessionExporter::parseFormat(const QString& name, Format* format)
+{
+    const QString n = name.trimmed().toLower();
+    if (n == "csv")
+        *format = Format::Csv;
+    else if (n == "ndjson" || n == "jsonl")
+        *format = Format::Ndjson;
+    else if (n == "columnar" || n == "zvcols")
+        *format = Format::Columnar;
+    else
+        return false;
+    return true;
+}
+
+const QStringList& SessionExporter::defaultColumns()
+{
+    static const QStringList t = {
+        "FileName", "FileSize", "FileType", "ImageWidth", "ImageHeight", "DateTimeOriginal",
+        "Make", "Model", "LensModel", "FNumber", "ExposureTime", "ISO", "FocalLength", "Duration",
+    };
+    return t;
+}
+
+bool SessionExporter::start(const QString& path, Format format, const QStringList& columns, int fileCount, RecordSource source)
+{
+    if (m_running) {
+        qWarning() << "SessionExporter: an export is already running";
+        return false;
+    }
+    if (fileCount <= 0 || !source || path.isEmpty())
+        return false;
+
+    QStringList selected = columns;
+    selected.removeAll(QString());
+    selected.removeDuplicates();
+    if (selected.isEmpty() && format != Format::Ndjson)
+        selected = defaultColumns();
+
+    m_source = std::move(source);
+    m_path = path;
+    m_total = fileCount;
+    m_next = 0;
+    m_queue.clear();
+    m_producerDone = false;
+    m_producerWaiting = false;
+    m_cancelled = false;
+    m_written = 0;
+    m_running = true;
+
+    m_pool.start([this, path, format, selected] { writerLoop(path, format, selected); });
+    QTimer::singleShot(0, this, &SessionExporter::feed);
+    m_progressTimer.start();
+    emit runningChanged();
+    emit progressChanged(0, m_total);
+    return true;
+}
+
+void SessionExporter::cancel()
+{
+    if (!m_running)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+    }
+    m_wake.notify_one();
+}
+
+//GUI thread: records are built where the session lives, until the queue is full or the slice is used up
+void SessionExporter::feed()
+{
+    if (!m_running || m_cancelled)
+        return;
+    QElapsedTimer slice;
+    slice.start();
+    while (m_next < m_total) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (int(m_queue.size()) >= kQueueFiles) {
+                m_producerWaiting = true; //the writer calls feed again
+                return;
+            }
+        }
+        Record record = m_source(m_next++);
+        if (record.filePath.isEmpty())
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(record));
+        }
+        m_wake.notify_one();
+        if (slice.elapsed() >= kSliceMs) {
+            QTimer::singleShot(0, this, &SessionExporter::feed); //keep the UI responsive
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_producerDone = true;
+    }
+    m_wake.notify_one();
+}
+
+void SessionExporter::writerLoop(QString path, Format format, QStringList columns)
+{
+    const std::unique_ptr<FormatWriter> writer = makeWriter(format, columns);
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        const QString error = file.errorString();
+        QMetaObject::invokeMethod(this, [this, error] { onWriterDone(false, error); }, Qt::QueuedConnection);
+        return;
+    }
+    writer->begin(file);
+
+    QString error;
+    for (;;) {
+        Record record;
+        bool wakeProducer = false;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_cancelled || m_producerDone || !m_queue.empty(); });
+            if (m_cancelled) {
+                error = "cancelled";
+                break;
+            }
+            if (m_queue.empty())
+                break; //all records written
+            record = std::move(m_queue.front());
+            m_queue.pop_front();
+            if (m_producerWaiting && int(m_queue.size()) <= kQueueFiles / 2) {
+                m_producerWaiting = false;
+                wakeProducer = true;
+            }
+        }
+        if (wakeProducer)
+            QMetaObject::invokeMethod(this, &SessionExporter::feed, Qt::QueuedConnection);
+
+        writer->write(file, record);
+        if (file.error() != QFileDevice::NoError) {
+            error = file.errorString();
+            break;
+        }
+        m_written.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool ok = false;
+    if (error.isEmpty()) {
+        writer->end(file);
+        ok = file.commit();
+        if (!ok)
+            error = file.errorString();
+    } else {
+        file.cancelWriting();
+    }
+    QMetaObject::invokeMethod(this, [this, ok, error] { onWriterDone(ok, error); }, Qt::QueuedConnection);
+}
+
+void SessionExporter::onWriterDone(bool ok, const QString& error)
+{
+    m_running = false;
+    m_progressTimer.stop();
+    m_source = nullptr; //release what the source captured
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.clear();
+    }
+    if (!ok)
+        qWarning() << "SessionExporter: export to" << m_path << "failed:" << error;
+    emit progressChanged(written(), m_total);
+    emit runningChanged();
+    emit finished(ok, m_path, written());
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "getExif.h"
+
+/*
+This file contains the SessionExporter class, the bulk export of session
+metadata to a file.
+
+1. Records are pulled from the session one file at a time on the GUI thread,
+in short time slices, and handed to a single background writer through a
+queue of at most 64 files. The producer stops while the queue is full, so an
+export of any session size holds the metadata of a few dozen files at once
+and never a copy of the session. Entries that are shared with the session
+(QVector implicit sharing) are not copied at all.
+
+2. Formats:
+Csv: wide table, one row per file, "SourceFile" and one column per selected
+tag. A column is "Group:Tag" (e.g. "EXIF:ISO") or a bare tag name, which
+takes the first entry of that tag in any group. Missing values are empty.
+Without columns, defaultColumns() (file, camera and exposure basics) are used.
+Ndjson: one JSON object per file with all entries, the record format of
+zviewer_cli: {"file": path, "entries": [{"group", "tag", "value"}, ...]}.
+Columns, if given, restrict the entries.
+Columnar: binary, the selected columns in row groups of up to 4096 files.
+All integers little endian.
+    header:    "ZVCOLS01", u32 version (1), u32 column count,
+               per column: u32 byte length + UTF-8 name ("SourceFile" first)
+    row group: u32 row count (> 0), then per column:
+               u8 type (0 string, 1 int64, 2 float64),
+               validity bitmap, (rows + 7) / 8 bytes, bit i of byte i / 8 set = present,
+               int64/float64: rows values, 0 where missing,
+               string: rows + 1 u32 offsets into the UTF-8 data that follows
+    end:       u32 0
+The type of a column is chosen per row group: int64 if every present value
+is an integer, float64 if every present value is a number, string otherwise.
+
+3. The file is written through QSaveFile, a cancelled or failed export leaves
+an existing file at the path untouched.
+*/
+
+class SessionExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Format {
+        Csv,
+        Ndjson,
+        Columnar
+    };
+
+    //one file of the session, an empty path skips the file (e.g. removed meanwhile)
+    struct Record {
+        QString filePath;
+        QVector<TagEntry> entries;
+    };
+    //called on the GUI thread for index 0 .. fileCount - 1, in order
+    using RecordSource = std::function<Record(int index)>;
+
+    explicit SessionExporter(QObject* parent = nullptr);
+    ~SessionExporter() override; //cancel and wait for the writer
+
+    //"csv", "ndjson" or "columnar", case insensitive
+    static bool parseFormat(const QString& name, Format* format);
+
+    //columns of csv and columnar exports when none are given
+    static const QStringList& defaultColumns();
+
+    //false if an export is running or there is nothing to export
+    bool start(const QString& path, Format format, const QStringList& columns, int fileCount, RecordSource source);
+    void cancel(); //finished(false, ...) follows
+
+    bool isRunning() const { return m_running; }
+    int written() const { return m_written.load(std::memory_order_relaxed); }
+    int total() const { return m_total; }
+
+signals:
+    //GUI thread, at most every 100 ms while running
+    void progressChanged(int written, int total);
+    void runningChanged();
+    void finished(bool ok, const QString& path, int files);
+
+private:
+    void feed(); //producer time slice
+    void writerLoop(QString path, Format format, QStringList columns); //writer thread
+    void onWriterDone(bool ok, const QString& error);
+
+    static constexpr int kQueueFiles = 64;
+    static constexpr int kSliceMs = 8; //producer time per event loop pass
+
+    QThreadPool m_pool; //single thread, the writer
+    QTimer m_progressTimer;
+    RecordSource m_source;
+    QString m_path;
+    bool m_running = false;
+    int m_total = 0;
+    int m_next = 0; //next index for the producer
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Record> m_queue;
+    bool m_producerDone = false; //all records queued
+    bool m_producerWaiting = false; //queue was full, writer wakes the producer
+    std::atomic<bool> m_cancelled{ false };
+    std::atomic<int> m_written{ 0 };
+};
@@ -0,0 +1,402 @@
+#include "sessionSnapshot.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <vector>
+
+//"ZVSS", written in native byte order, a swapped magic means another byte order
+static constexpr quint32 kMagic = 0x5A565353;
+static constexpr quint32 kVersion = 2;
+//strings up to this length are deduplicated, longer values are mostly unique
+static constexpr int kDedupMaxBytes = 48;
+//FileRec flags
+static constexpr quint32 kFlagPartial = 0x1;
+static constexpr quint32 kFlagRestricted = 0x2;
+
+//on-disk records, plain data read in place from the mapping
+struct SessionSnapshot::Header {
+    quint32 magic;
+    quint32 version;
+    quint32 fileCount;
+    quint32 entryCount;
+    quint32 foldCount;
+    quint32 rootCount;
+    quint32 stringCount;
+    qint32 currentIndex;
+    quint32 profile; //string id
+    quint32 reserved;
+    quint64 fileTableOffset;
+    quint64 entryTableOffset;
+    quint64 foldTableOffset; //u32 string ids
+    quint64 rootTableOffset; //u32 string ids
+    quint64 stringIndexOffset;
+    quint64 stringDataOffset;
+    quint64 totalSize;
+};
+
+struct SessionSnapshot::FileRec {
+    quint32 path;
+    quint32 entryFirst;
+    quint32 entryCount;
+    quint32 foldFirst;
+    quint32 foldCount;
+    qint32 viewX;
+    qint32 viewY;
+    quint32 flags; //kFlagPartial, kFlagRestricted
+    qint64 size;
+    qint64 mtime;
+};
+
+struct SessionSnapshot::EntryRec {
+    quint32 group;
+    quint32 tag;
+    quint32 value;
+};
+
+struct SessionSnapshot::StringRef {
+    quint32 offset; //into string data
+    quint32 length; //bytes of UTF-8
+};
+
+//writer side string pool
+namespace {
+class StringPool
+{
+public:
+    quint32 add(const QString& s)
+    {
+        const QByteArray utf8 = s.toUtf8();
+        const bool dedup = utf8.size() <= kDedupMaxBytes;
+        if (dedup) {
+            auto it = m_ids.constFind(utf8);
+            if (it != m_ids.constEnd())
+                return it.value();
+        }
+        const quint32 id = static_cast<quint32>(m_refs.size());
+        m_refs.push_back({ static_cast<quint32>(m_data.size()), static_cast<quint32>(utf8.size()) });
+        m_data.append(utf8);
+        if (dedup)
+            m_ids.insert(utf8, id);
+        return id;
+    }
+    const std::vector<std::pair<quint32, quint32>>& refs() const { return m_refs; }
+    const QByteArray& data() const { return m_data; }
+
+private:
+    QHash<QByteArray, quint32> m_ids;
+    std::vector<std::pair<quint32, quint32>> m_refs;
+    QByteArray m_data;
+};
+}
+
+bool SessionSnapshot::write(const QString& path, int fileCount, const FileSource& source,
+                            int currentIndex, const QStringList& roots, const QString& profile)
+{
+    //layout is read in place, sizes must not depend on the compiler
+    static_assert(sizeof(Header) == 96 && sizeof(FileRec) == 48, "unexpected snapshot layout");
+    static_assert(sizeof(EntryRec) == 12 && sizeof(StringRef) == 8, "unexpected snapshot layout");
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile out(path);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "SessionSnapshot: cannot write" << path;
+        return false;
+    }
+
+    //sections are streamed, each 8 byte aligned; the header is written last, in front of them
+    //entries go first, file by file, so no table of all entries is ever held in memory
+    quint64 offset = sizeof(Header);
+    auto writeRaw = [&out, &offset](const void* data, size_t bytes) {
+        if (bytes == 0)
+            return;
+        out.write(static_cast<const char*>(data), static_cast<qint64>(bytes));
+        offset += bytes;
+    };
+    auto pad = [&writeRaw, &offset] {
+        static const char zeros[8] = {};
+        if (offset % 8 != 0)
+            writeRaw(zeros, 8 - offset % 8);
+    };
+    Header h{};
+    out.write(reinterpret_cast<const char*>(&h), sizeof(Header)); //placeholder, filled in at the end
+
+    StringPool pool;
+    std::vector<FileRec> files;
+    std::vector<quint32> folds;
+    std::vector<EntryRec> fileEntries; //of one file, reused
+    files.reserve(fileCount);
+    quint32 entryCount = 0;
+
+    h.entryTableOffset = offset;
+    for (int i = 0; i < fileCount; ++i) {
+        const FileData d = source(i);
+        const QFileInfo fi(d.filePath);
+
+        FileRec rec{};
+        rec.path = pool.add(d.filePath);
+        rec.entryFirst = entryCount;
+        rec.entryCount = static_cast<quint32>(d.entries.size());
+        rec.foldFirst = static_cast<quint32>(folds.size());
+        rec.foldCount = static_cast<quint32>(d.foldedGroups.size());
+        rec.viewX = d.viewX;
+        rec.viewY = d.viewY;
+        rec.flags = (d.partial ? kFlagPartial : 0) | (d.restricted ? kFlagRestricted : 0);
+        rec.size = fi.exists() ? fi.size() : -1;
+        rec.mtime = fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : 0;
+        files.push_back(rec);
+
+        fileEntries.clear();
+        for (const TagEntry& e : d.entries)
+            fileEntries.push_back({ pool.add(e.group), pool.add(e.tag), pool.add(e.value) });
+        writeRaw(fileEntries.data(), sizeof(EntryRec) * fileEntries.size());
+        entryCount += rec.entryCount;
+        for (const QString& g : d.foldedGroups)
+            folds.push_back(pool.add(g));
+    }
+    pad();
+
+    std::vector<quint32> rootIds;
+    for (const QString& r : roots)
+        rootIds.push_back(pool.add(r));
+    const quint32 profileId = pool.add(profile);
+
+    h.fileTableOffset = offset;
+    writeRaw(files.data(), sizeof(FileRec) * files.size());
+    pad();
+    h.foldTableOffset = offset;
+    writeRaw(folds.data(), sizeof(quint32) * folds.size());
+    pad();
+    h.rootTableOffset = offset;
+    writeRaw(rootIds.data(), sizeof(quint32) * rootIds.size());
+    pad();
+    h.stringIndexOffset = offset;
+    std::vector<StringRef> refs;
+    refs.reserve(pool.refs().size());
+    for (const auto& [off, len] : pool.refs())
+        refs.push_back({ off, len });
+    writeRaw(refs.data(), sizeof(StringRef) * refs.size());
+    pad();
+    h.stringDataOffset = offset;
+    writeRaw(pool.data().constData(), size_t(pool.data().size()));
+
+    h.magic = kMagic;
+    h.version = kVersion;
+    h.fileCount = static_cast<quint32>(files.size());
+    h.entryCount = entryCount;
+    h.foldCount = static_cast<quint32>(folds.size());
+    h.rootCount = static_cast<quint32>(rootIds.size());
+    h.stringCount = static_cast<quint32>(refs.size());
+    h.currentIndex = currentIndex;
+    h.profile = profileId;
+    h.totalSize = offset;
+    out.seek(0);
+    out.write(reinterpret_cast<const char*>(&h), sizeof(Header));
+
+    if (!out.commit()) {
+        qWarning() << "SessionSnapshot: saving failed" << path;
+        return false;
+    }
+    qDebug() << "SessionSnapshot: saved" << h.fileCount << "files," << h.entryCount << "entries,"
+             << h.totalSize / 1024 << "KiB to" << path;
+    return true;
+}
+
+bool SessionSnapshot::replace(const QString& written, const QString& target)
+{
+    const QString previous = target + ".old";
+    const bool hadTarget = QFile::exists(target);
+    QFile::remove(previous); //left by an interrupted replace
+    if (hadTarget && !QFile::rename(target, previous))
+        return false;
+    if (!QFile::rename(written, target)) {
+        if (hadTarget)
+            QFile::rename(previous, target);
+        return false;
+    }
+    if (hadTarget)
+        QFile::remove(previous);
+    return true;
+}
+
+QString SessionSnapshot::defaultPath()
+{
+    //next to the thumbnail cache, portable like the rest of the app
+    return QCoreApplication::applicationDirPath() + "/cache/session.zvs";
+}
+
+bool SessionSnapshot::open(const QString& path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false; //no saved session
+
+    m_size = m_file.size();
+    if (m_size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        qWarning() << "SessionSnapshot: mapping failed" << path;
+        close();
+        return false;
+    }
+
+    //header and table bounds only, records are checked on access
+    const Header* h = header();
+    auto within = [this](quint64 off, quint64 bytes) {
+        return off % 8 == 0 && off <= quint64(m_size) && bytes <= quint64(m_size) - off;
+    };
+    const bool valid = h->magic == kMagic && h->version == kVersion
+        && h->totalSize == quint64(m_size)
+        && within(h->fileTableOffset, quint64(h->fileCount) * sizeof(FileRec))
+        && within(h->entryTableOffset, quint64(h->entryCount) * sizeof(EntryRec))
+        && within(h->foldTableOffset, quint64(h->foldCount) * sizeof(quint32))
+        && within(h->rootTableOffset, quint64(h->rootCount) * sizeof(quint32))
+        && within(h->stringIndexOffset, quint64(h->stringCount) * sizeof(StringRef))
+        && h->stringDataOffset <= quint64(m_size);
+    if (!valid) {
+        qWarning() << "SessionSnapshot: unknown or damaged snapshot ignored" << path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SessionSnapshot::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_data = nullptr;
+    m_size = 0;
+    if (m_file.isOpen())
+        m_file.close();
+}
+
+const SessionSnapshot::Header* SessionSnapshot::header() const
+{
+    return reinterpret_cast<const Header*>(m_data);
+}
+
+const SessionSnapshot::FileRec* SessionSnapshot::fileRec(int index) const
+{
+    if (!m_data || index < 0 || quint32(index) >= header()->fileCount)
+        return nullptr;
+    return reinterpret_cast<const FileRec*>(m_data + header()->fileTableOffset) + index;
+}
+
+QString SessionSnapshot::string(quint32 id) const
+{
+    const Header* h = header();
+    if (!m_data || id >= h->stringCount)
+        return {};
+    const StringRef& ref = reinterpret_cast<const StringRef*>(m_data + h->stringIndexOffset)[id];
+    const quint64 begin = h->stringDataOffset + ref.offset;
+    if (begin + ref.length > quint64(m_size))
+        return {};
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_data + begin), ref.length);
+}
+
+int SessionSnapshot::fileCount() const
+{
+    return m_data ? static_cast<int>(header()->fileCount) : 0;
+}
+
+int SessionSnapshot::currentIndex() const
+{
+    return m_data ? header()->currentIndex : -1;
+}
+
+QStringList SessionSnapshot::roots() const
+{
+    QStringList out;
+    if (!m_data)
+        return out;
+    const quint32* ids = reinterpret_cast<const quint32*>(m_data + header()->rootTableOffset);
+    for (quint32 i = 0; i < header()->rootCount; ++i)
+        out << string(ids[i]);
+    return out;
+}
+
+QString SessionSnapshot::profile() const
+{
+    return m_data ? string(header()->profile) : QString();
+}
+
+QString SessionSnapshot::filePath(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r ? string(r->path) : QString();
+}
+
+qint64 SessionSnapshot::fileSize(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r ? r->size : -1;
+}
+
+qint64 SessionSnapshot::fileMtime(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r ? r->mtime : 0;
+}
+
+int SessionSnapshot::viewX(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r ? r->viewX : 0;
+}
+
+int SessionSnapshot::viewY(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r ? r->viewY : 0;
+}
+
+bool SessionSnapshot::isPartial(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r && (r->flags & kFlagPartial);
+}
+
+bool SessionSnapshot::isRestricted(int index) const
+{
+    const FileRec* r = fileRec(index);
+    return r && (r->flags & kFlagRestricted);
+}
+
+QStringList SessionSnapshot::foldedGroups(int index) const
+{
+    QStringList out;
+    const FileRec* r = fileRec(index);
+    if (!r || quint64(r->foldFirst) + r->foldCount > header()->foldCount)
+        return out;
+    const quint32* ids = reinterpret_cast<const quint32*>(m_data + header()->foldTableOffset) + r->foldFirst;
+    for (quint32 i = 0; i < r->foldCount; ++i)
+        out << string(ids[i]);
+    return out;
+}
+
+QVector<TagEntry> SessionSnapshot::entries(int index) const
+{
+    QVector<TagEntry> out;
+    const FileRec* r = fileRec(index);
+    if (!r || quint64(r->entryFirst) + r->entryCount > header()->entryCount)
+        return out;
+    const EntryRec* recs = reinterpret_cast<const EntryRec*>(m_data + header()->entryTableOffset) + r->entryFirst;
+    out.reserve(r->entryCount);
+    for (quint32 i = 0; i < r->entryCount; ++i) {
+        TagEntry e;
+        e.group = string(recs[i].group);
+        e.tag = string(recs[i].tag);
+        e.value = string(recs[i].value);
+        out.push_back(std::move(e));
+    }
+    return out;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+#include "getExif.h"
+
+/*
+This file contains the SessionSnapshot class, the binary file of a saved
+session (file list, metadata entries, fold state and view positions).
+
+1. The file is laid out for memory-mapped loading. A fixed header points to
+flat tables of plain records (files, entries, folded groups, folder roots)
+and to one string pool. Opening a snapshot maps the file and checks the
+header, nothing is parsed. Entries of a file are decoded from the mapping
+only when its models are built, so restoring a large session costs little
+more than the page faults of the file table. The writer streams the entry
+table file by file and the other tables after it, only the string pool and
+the per-file records are held in memory while saving.
+
+2. Strings are stored once in UTF-8. Short strings (groups, tags and common
+values) are deduplicated across the whole session.
+
+3. The format is versioned; a snapshot with another magic, version or byte
+order is rejected as a whole and the session starts empty.
+
+4. The writer may record the extraction profile the entries were read with
+(empty for the full profile), so a reader can tell that tags are missing.
+Files read under a restricted profile are flagged one by one, a session may
+hold files of several profiles.
+
+Basic info is not stored, it is derived from the entries when the ExifModel
+is built.
+*/
+
+class SessionSnapshot
+{
+public:
+    //one file as handed to the writer
+    struct FileData {
+        QString filePath;
+        QVector<TagEntry> entries;
+        QStringList foldedGroups;
+        int viewX = 0;
+        int viewY = 0;
+        bool partial = false; //fast import pass only, full metadata still to be read
+        bool restricted = false; //read under a restricted extraction profile, tags outside it are missing
+    };
+    //pulls the data of file i, called once per file in row order
+    using FileSource = std::function<FileData(int index)>;
+
+    SessionSnapshot() = default;
+    ~SessionSnapshot() { close(); }
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+
+    //session file used by auto save and restore
+    static QString defaultPath();
+
+    //map a snapshot file, false if missing, truncated or of another format
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    QString path() const { return m_file.fileName(); }
+
+    //session level
+    int fileCount() const;
+    int currentIndex() const; //-1 if none
+    QStringList roots() const; //imported folders, watched again after restore
+    QString profile() const; //as given to write()
+
+    //file level, index < fileCount()
+    QString filePath(int index) const;
+    qint64 fileSize(int index) const; //source file size when saved, to detect changes
+    qint64 fileMtime(int index) const; //ms since epoch
+    int viewX(int index) const;
+    int viewY(int index) const;
+    QStringList foldedGroups(int index) const;
+    bool isPartial(int index) const;
+    bool isRestricted(int index) const;
+    QVector<TagEntry> entries(int index) const; //decoded from the mapping, copies
+
+    //write a snapshot (QSaveFile, the old file stays intact on failure)
+    static bool write(const QString& path, int fileCount, const FileSource& source,
+                      int currentIndex, const QStringList& roots, const QString& profile = QString());
+    //move a snapshot written aside over target, which must not be mapped
+    //the old target is renamed away first and put back if the move fails, so one of them always exists
+    static bool replace(const QString& written, const QString& target);
+
+private:
+    struct Header;
+    struct FileRec;
+    struct EntryRec;
+    struct StringRef;
+
+    const Header* header() const;
+    const FileRec* fileRec(int index) const; //nullptr if out of range
+    QString string(quint32 id) const; //empty for invalid ids
+
+    QFile m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+};
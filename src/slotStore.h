@@ -0,0 +1,162 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QHashFunctions>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/*
+This file contains SlotStore, the chunked storage of per-file records.
+
+1. Records live in fixed size chunks that are never reallocated, so a record
+never moves in memory once it is stored. Pointers and references to records
+(e.g. ExifModel objects referenced by QML) stay valid while other files are
+added or removed.
+
+2. Every record gets a FileId (slot + generation). Ids stay valid for the
+life of the record and are never confused with a later record in the same
+slot, because freeing a slot bumps its generation.
+
+3. The display order is a separate row -> id vector. Rows are what list
+models and QML see; ids are what background jobs and lookups hold on to.
+Removing a range of rows frees the slots and shifts only the small id vector.
+*/
+
+//stable handle of a file in the session, generation 0 is never used, so a default id is invalid
+struct FileId
+{
+    quint32 slot = 0;
+    quint32 generation = 0;
+
+    bool isValid() const { return generation != 0; }
+    //packed form for QVariant, signals and hashing
+    quint64 toInt() const { return (quint64(generation) << 32) | slot; }
+    static FileId fromInt(quint64 v) { return FileId{ quint32(v & 0xffffffffu), quint32(v >> 32) }; }
+
+    bool operator==(const FileId& o) const { return slot == o.slot && generation == o.generation; }
+    bool operator!=(const FileId& o) const { return !(*this == o); }
+};
+
+inline size_t qHash(const FileId& id, size_t seed = 0) noexcept
+{
+    return ::qHash(id.toInt(), seed);
+}
+
+template <typename T, int ChunkSize = 1024>
+class SlotStore
+{
+public:
+    SlotStore() = default;
+    SlotStore(const SlotStore&) = delete; //records are referenced by address, no copies
+    SlotStore& operator=(const SlotStore&) = delete;
+
+    int size() const { return static_cast<int>(m_order.size()); }
+    bool empty() const { return m_order.empty(); }
+
+    //append a record at the last row, returns its id
+    FileId push_back(T&& value)
+    {
+        quint32 index;
+        if (!m_free.empty()) {
+            index = m_free.back(); //reuse freed slot, generation was bumped on free
+            m_free.pop_back();
+        } else {
+            index = m_slotCount++;
+            if (size_t(index / ChunkSize) >= m_chunks.size())
+                m_chunks.push_back(std::make_unique<Slot[]>(ChunkSize));
+        }
+        Slot& s = slot(index);
+        s.value.emplace(std::move(value));
+        s.row = size();
+        const FileId id{ index, s.generation };
+        m_order.push_back(id);
+        return id;
+    }
+
+    //access by row, row must be valid
+    T& operator[](int row) { return *slot(m_order[row].slot).value; }
+    const T& operator[](int row) const { return *constSlot(m_order[row].slot).value; }
+    T& back() { return (*this)[size() - 1]; }
+
+    //access by id, nullptr if the record was removed
+    T* get(FileId id)
+    {
+        if (!contains(id))
+            return nullptr;
+        return &*slot(id.slot).value;
+    }
+    const T* get(FileId id) const
+    {
+        if (!contains(id))
+            return nullptr;
+        return &*constSlot(id.slot).value;
+    }
+
+    bool contains(FileId id) const
+    {
+        return id.isValid() && id.slot < m_slotCount
+            && constSlot(id.slot).generation == id.generation
+            && constSlot(id.slot).value.has_value();
+    }
+
+    FileId idAt(int row) const
+    {
+        if (row < 0 || row >= size())
+            return {};
+        return m_order[row];
+    }
+
+    //current row of a record, -1 if removed
+    int rowOf(FileId id) const
+    {
+        return contains(id) ? constSlot(id.slot).row : -1;
+    }
+
+    //remove rows [first, last], records of other rows are not touched
+    void removeRows(int first, int last)
+    {
+        if (first < 0 || last >= size() || first > last)
+            return;
+        for (int r = first; r <= last; ++r)
+            freeSlot(m_order[r].slot);
+        m_order.erase(m_order.begin() + first, m_order.begin() + last + 1);
+        for (int r = first; r < size(); ++r)
+            slot(m_order[r].slot).row = r;
+    }
+
+    void clear()
+    {
+        for (const FileId& id : m_order)
+            freeSlot(id.slot);
+        m_order.clear();
+    }
+
+    void reserve(int rows) { m_order.reserve(rows); }
+
+private:
+    struct Slot {
+        std::optional<T> value;
+        quint32 generation = 1;
+        int row = -1;
+    };
+
+    Slot& slot(quint32 index) { return m_chunks[index / ChunkSize][index % ChunkSize]; }
+    const Slot& constSlot(quint32 index) const { return m_chunks[index / ChunkSize][index % ChunkSize]; }
+
+    void freeSlot(quint32 index)
+    {
+        Slot& s = slot(index);
+        s.value.reset();
+        s.row = -1;
+        if (++s.generation == 0) //skip the invalid generation on wrap
+            s.generation = 1;
+        m_free.push_back(index);
+    }
+
+    std::vector<std::unique_ptr<Slot[]>> m_chunks; //never reallocated chunks, records never move
+    std::vector<quint32> m_free; //freed slots, reused last in first out
+    std::vector<FileId> m_order; //row -> id
+    quint32 m_slotCount = 0; //slots ever handed out
+};
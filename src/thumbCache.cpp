@@ -0,0 +1,480 @@
+#include "thumbCache.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <vector>
+
+#include "thumbImage.h"
+
+//index file format
+static constexpr quint32 kIndexMagic = 0x5A565443; //"ZVTC"
+static constexpr quint32 kIndexVersion = 1;
+static const char* kIndexName = "index.dat";
+
+//default quota, override with env ZVIEWER_THUMB_CACHE_MB
+static constexpr qint64 kDefaultQuotaMB = 1024;
+//eviction goes below quota to avoid evicting on every new thumbnail
+static constexpr double kLowWatermark = 0.9;
+//unindexed files younger than this may belong to a running thumbnail job
+static constexpr qint64 kStrayGraceMs = 10 * 60 * 1000;
+
+static qint64 nowMs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+ThumbCacheManager::ThumbCacheManager(const QString& cacheDir, QObject* parent)
+    : QObject{parent}
+    , m_cacheDir(QDir::cleanPath(cacheDir))
+    , m_indexPath(QDir(cacheDir).filePath(kIndexName))
+{
+    bool ok = false;
+    const qint64 mb = qEnvironmentVariable("ZVIEWER_THUMB_CACHE_MB").toLongLong(&ok);
+    m_quotaBytes = (ok && mb > 0 ? mb : kDefaultQuotaMB) * 1024 * 1024;
+
+    m_notifyTimer.setSingleShot(true);
+    m_notifyTimer.setInterval(250);
+    connect(&m_notifyTimer, &QTimer::timeout, this, &ThumbCacheManager::statsChanged);
+
+    //index is read right away for placeholders, checking and clean up run in background
+    readIndex();
+    m_maintenance.setMaxThreadCount(1);
+    m_maintenance.start([this] {
+        reconcileIndex();
+        sweepOrphans();
+        enforceQuota();
+    });
+}
+
+ThumbCacheManager::~ThumbCacheManager()
+{
+    m_maintenance.clear();
+    m_maintenance.waitForDone();
+    saveIndex();
+}
+
+bool ThumbCacheManager::ownsFile(const QString& path) const
+{
+    return QDir::cleanPath(QFileInfo(path).absolutePath()) == m_cacheDir;
+}
+
+void ThumbCacheManager::removeFiles(const QStringList& files)
+{
+    for (const QString& f : files)
+        QFile::remove(f);
+}
+
+//called from thumbnail workers
+bool ThumbCacheManager::lookup(const QString& sourcePath, Entry* out)
+{
+    Entry entry;
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.constFind(sourcePath);
+        if (it == m_entries.constEnd()) {
+            lock.unlock();
+            ++m_misses;
+            scheduleStatsNotify();
+            return false;
+        }
+        entry = it.value();
+    }
+
+    //validate outside the lock: thumbnail must exist and be newer than source
+    const QFileInfo top(entry.topPath);
+    bool valid = top.exists() && top.lastModified() >= QFileInfo(sourcePath).lastModified();
+    for (int i = 0; valid && i < entry.files.size(); ++i)
+        valid = QFileInfo::exists(entry.files[i]);
+
+    if (!valid) {
+        ++m_misses;
+        scheduleStatsNotify();
+        return false;
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find(sourcePath);
+        if (it != m_entries.end())
+            it->lastAccess = nowMs(); //refresh LRU position
+    }
+    ++m_hits;
+    scheduleStatsNotify();
+    if (out)
+        *out = entry;
+    return true;
+}
+
+//called from the GUI thread when rows are built, and from thumbnail workers
+QString ThumbCacheManager::placeholder(const QString& sourcePath) const
+{
+    QMutexLocker lock(&m_mutex);
+    const auto it = m_entries.constFind(sourcePath);
+    return it != m_entries.constEnd() ? it->placeholder : QString();
+}
+
+//called from thumbnail workers
+void ThumbCacheManager::record(const QString& sourcePath, const QString& topPath, const QString& placeholder)
+{
+    if (sourcePath.isEmpty() || topPath.isEmpty())
+        return;
+
+    Entry entry;
+    entry.topPath = topPath;
+    entry.placeholder = placeholder;
+    entry.lastAccess = nowMs();
+
+    //collect files owned by cache dir
+    QStringList candidates;
+    candidates << topPath;
+    for (int edge : ThumbLevels::Edges) {
+        if (edge < ThumbLevels::TopEdge)
+            candidates << ThumbLevels::levelPath(topPath, edge);
+    }
+    for (const QString& f : candidates) {
+        const QFileInfo fi(f);
+        if (fi.exists() && ownsFile(f)) {
+            entry.files << fi.absoluteFilePath();
+            entry.bytes += fi.size();
+        }
+    }
+
+    qint64 total = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        auto it = m_entries.find(sourcePath);
+        if (it != m_entries.end())
+            m_totalBytes -= it->bytes; //regenerated, replace old entry
+        m_entries.insert(sourcePath, entry);
+        m_totalBytes += entry.bytes;
+        total = m_totalBytes;
+    }
+
+    if (total > m_quotaBytes.load())
+        queueEviction();
+    scheduleStatsNotify();
+}
+
+void ThumbCacheManager::rename(const QVector<QPair<QString, QString>>& moves)
+{
+    QStringList doomedFiles;
+    {
+        QMutexLocker lock(&m_mutex);
+        //all renamed entries are taken first, so swaps and chains keep their thumbnails
+        QVector<QPair<QString, Entry>> moved;
+        QSet<QString> kept;
+        for (const auto& [oldPath, newPath] : moves) {
+            auto it = m_entries.find(oldPath);
+            if (it == m_entries.end())
+                continue;
+            for (const QString& f : std::as_const(it->files))
+                kept.insert(f);
+            moved.push_back({ newPath, std::move(it.value()) });
+            m_entries.erase(it);
+        }
+        for (auto& [newPath, entry] : moved) {
+            auto replaced = m_entries.find(newPath);
+            if (replaced != m_entries.end()) {
+                //the rename replaced a file that was not renamed itself
+                m_totalBytes -= replaced->bytes;
+                for (const QString& f : std::as_const(replaced->files)) {
+                    if (!kept.contains(f))
+                        doomedFiles << f;
+                }
+                m_entries.erase(replaced);
+            }
+            m_entries.insert(newPath, std::move(entry));
+        }
+    }
+    removeFiles(doomedFiles);
+    scheduleStatsNotify();
+}
+
+void ThumbCacheManager::queueEviction()
+{
+    bool expected = false;
+    if (!m_evictionQueued.compare_exchange_strong(expected, true))
+        return; //already queued
+    m_maintenance.start([this] {
+        m_evictionQueued = false;
+        enforceQuota();
+    });
+}
+
+void ThumbCacheManager::cleanUp()
+{
+    m_maintenance.start([this] {
+        sweepOrphans();
+        enforceQuota();
+    });
+}
+
+void ThumbCacheManager::enforceQuota()
+{
+    const qint64 target = qint64(m_quotaBytes.load() * kLowWatermark);
+
+    QStringList doomedFiles;
+    qint64 evicted = 0;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_totalBytes <= m_quotaBytes.load())
+            return;
+
+        //least recently used first
+        std::vector<std::pair<qint64, QString>> order;
+        order.reserve(m_entries.size());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+            order.emplace_back(it->lastAccess, it.key());
+        std::sort(order.begin(), order.end());
+
+        for (const auto& [lastAccess, source] : order) {
+            if (m_totalBytes <= target)
+                break;
+            Q_UNUSED(lastAccess);
+            const Entry e = m_entries.take(source);
+            m_totalBytes -= e.bytes;
+            doomedFiles << e.files;
+            ++evicted;
+        }
+    }
+
+    removeFiles(doomedFiles); //file system work outside the lock
+    m_evictions += evicted;
+    saveIndex();
+    scheduleStatsNotify();
+    qDebug() << "ThumbCacheManager: evicted" << evicted << "entries";
+}
+
+void ThumbCacheManager::sweepOrphans()
+{
+    //snapshot sources, existence checks run without the lock
+    QStringList sources;
+    {
+        QMutexLocker lock(&m_mutex);
+        sources = m_entries.keys();
+    }
+
+    QStringList orphans;
+    for (const QString& s : sources) {
+        if (!QFileInfo::exists(s))
+            orphans << s;
+    }
+
+    QStringList doomedFiles;
+    QSet<QString> knownFiles;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const QString& s : orphans) {
+            auto it = m_entries.find(s);
+            if (it == m_entries.end())
+                continue;
+            m_totalBytes -= it->bytes;
+            doomedFiles << it->files;
+            m_entries.erase(it);
+        }
+        for (const Entry& e : std::as_const(m_entries)) {
+            for (const QString& f : e.files)
+                knownFiles.insert(f);
+        }
+    }
+    removeFiles(doomedFiles);
+    m_evictions += orphans.size();
+
+    //files nobody references, e.g. left by older versions or crashed jobs
+    const qint64 now = nowMs();
+    QDirIterator it(m_cacheDir, QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        const QFileInfo fi(it.nextFileInfo());
+        if (fi.fileName() == QLatin1String(kIndexName))
+            continue;
+        if (knownFiles.contains(fi.absoluteFilePath()))
+            continue;
+        if (now - fi.lastModified().toMSecsSinceEpoch() < kStrayGraceMs)
+            continue;
+        QFile::remove(fi.absoluteFilePath());
+    }
+
+    saveIndex();
+    scheduleStatsNotify();
+}
+
+void ThumbCacheManager::readIndex()
+{
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly))
+        return; //first run or cleared
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0, version = 0, count = 0;
+    in >> magic >> version >> count;
+    if (magic != kIndexMagic || version != kIndexVersion) {
+        qWarning() << "ThumbCacheManager: unknown index format, ignored";
+        return;
+    }
+
+    //no file system access here, sizes and existence are checked by reconcileIndex()
+    QMutexLocker lock(&m_mutex);
+    m_entries.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString source;
+        Entry e;
+        in >> source >> e.topPath >> e.placeholder >> e.files >> e.lastAccess;
+        e.unchecked = true;
+        m_entries.insert(source, std::move(e));
+    }
+}
+
+void ThumbCacheManager::reconcileIndex()
+{
+    //snapshot unchecked entries, sizes may have changed since last run
+    //keyed by top path, which stays the same when a source file is renamed meanwhile
+    QHash<QString, QStringList> unchecked;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const Entry& e : std::as_const(m_entries)) {
+            if (e.unchecked)
+                unchecked.insert(e.topPath, e.files);
+        }
+    }
+
+    QHash<QString, qint64> bytesOf; //top path -> bytes, missing if the top level is gone
+    for (auto it = unchecked.constBegin(); it != unchecked.constEnd(); ++it) {
+        if (!QFileInfo::exists(it.key()))
+            continue;
+        qint64 bytes = 0;
+        for (const QString& f : it.value())
+            bytes += QFileInfo(f).size();
+        bytesOf.insert(it.key(), bytes);
+    }
+
+    //entries recorded meanwhile are checked already, keep them
+    QMutexLocker lock(&m_mutex);
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (!it->unchecked || !unchecked.contains(it->topPath)) {
+            ++it;
+            continue;
+        }
+        const auto bytes = bytesOf.constFind(it->topPath);
+        if (bytes == bytesOf.constEnd()) {
+            it = m_entries.erase(it);
+            continue;
+        }
+        it->bytes = bytes.value();
+        it->unchecked = false;
+        m_totalBytes += it->bytes;
+        ++it;
+    }
+    lock.unlock();
+    scheduleStatsNotify();
+}
+
+void ThumbCacheManager::saveIndex() const
+{
+    QDir dir(m_cacheDir);
+    if (!dir.exists() && !dir.mkpath("."))
+        return;
+
+    QSaveFile file(m_indexPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    {
+        QMutexLocker lock(&m_mutex);
+        out << kIndexMagic << kIndexVersion << quint32(m_entries.size());
+        for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it)
+            out << it.key() << it->topPath << it->placeholder << it->files << it->lastAccess;
+    }
+    if (!file.commit())
+        qWarning() << "ThumbCacheManager: saving index failed" << m_indexPath;
+}
+
+bool ThumbCacheManager::clearNow()
+{
+    m_maintenance.clear();
+    m_evictionQueued = false; //a dropped eviction job never resets it
+    m_maintenance.waitForDone(); //no maintenance job may write the index afterwards
+
+    if (m_cacheDir.isEmpty()) {
+        qWarning() << "Cache directory path is empty.";
+        return false;
+    }
+
+    QDir dir(m_cacheDir);
+
+    // avoid deleting program main dir
+    if (dir.absolutePath() == QCoreApplication::applicationDirPath()) {
+        qCritical() << "Refusing to delete application directory!";
+        return false;
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_evictions += m_entries.size();
+        m_entries.clear();
+        m_totalBytes = 0;
+    }
+
+    if (dir.exists() && !dir.removeRecursively()) {//delete all files in dir
+        qWarning() << "Failed to remove cache directory:" << m_cacheDir;
+        return false;
+    }
+
+    //recreate empty dir for further use
+    if (!dir.mkpath(".")) {
+        qWarning() << "Failed to recreate cache directory:" << m_cacheDir;
+        return false;
+    }
+
+    scheduleStatsNotify();
+    qDebug() << "Cache folder cleared:" << m_cacheDir;
+    return true;
+}
+
+void ThumbCacheManager::scheduleStatsNotify()
+{
+    //may be called from any thread, timer lives on GUI thread
+    QMetaObject::invokeMethod(this, [this] {
+        if (!m_notifyTimer.isActive())
+            m_notifyTimer.start();
+    }, Qt::QueuedConnection);
+}
+
+qint64 ThumbCacheManager::totalBytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_totalBytes;
+}
+
+int ThumbCacheManager::entryCount() const
+{
+    QMutexLocker lock(&m_mutex);
+    return static_cast<int>(m_entries.size());
+}
+
+double ThumbCacheManager::hitRate() const
+{
+    const qint64 h = m_hits.load();
+    const qint64 total = h + m_misses.load();
+    return total > 0 ? double(h) / double(total) : 0.0;
+}
+
+void ThumbCacheManager::setQuotaBytes(qint64 bytes)
+{
+    if (bytes <= 0 || bytes == m_quotaBytes.load())
+        return;
+    m_quotaBytes = bytes;
+    emit quotaBytesChanged();
+    queueEviction(); //shrinking quota takes effect right away
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QObject>
+#include <QtCore>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+
+/*
+This file contains the ThumbCacheManager class, the governance service of the
+application thumbnail cache (thumbCacheDir()).
+
+1. It keeps an index of cache entries (source file -> top level thumbnail,
+lower levels, placeholder, size, last access), persisted as index.dat in the
+cache directory. Thumbnail jobs ask lookup() before generating anything, so
+placeholders and thumbnails of known files are reused across sessions. The
+index file is read in the constructor, so placeholder() answers right away
+when rows are built; checking its entries against the disk runs in the
+background.
+
+2. It enforces a byte quota with LRU eviction and sweeps entries whose source
+files no longer exist. All maintenance runs in its own background thread,
+never on the GUI thread.
+
+3. Cache statistics are exposed as Q_PROPERTY for the About window.
+
+lookup() and record() are thread-safe and called from thumbnail workers.
+Files outside the cache directory (e.g. the freedesktop shared store) are
+referenced but never counted, evicted or deleted.
+*/
+
+class ThumbCacheManager : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(qint64 totalBytes READ totalBytes NOTIFY statsChanged) //bytes of indexed files in cache dir
+    Q_PROPERTY(int entryCount READ entryCount NOTIFY statsChanged) //number of indexed source files
+    Q_PROPERTY(double hitRate READ hitRate NOTIFY statsChanged) //0..1, lookups of this session
+    Q_PROPERTY(qint64 hits READ hits NOTIFY statsChanged)
+    Q_PROPERTY(qint64 misses READ misses NOTIFY statsChanged)
+    Q_PROPERTY(qint64 evictions READ evictions NOTIFY statsChanged) //entries removed by quota or sweep
+    Q_PROPERTY(qint64 quotaBytes READ quotaBytes WRITE setQuotaBytes NOTIFY quotaBytesChanged)
+
+public:
+    //one cached source file
+    struct Entry {
+        QString topPath; //top level thumbnail, may be outside cache dir
+        QString placeholder; //BlurHash
+        QStringList files; //files owned by the cache dir (top if inside, levels)
+        qint64 bytes = 0; //sum of files
+        qint64 lastAccess = 0; //ms since epoch, for LRU
+        bool unchecked = false; //read from index.dat, files not checked on disk yet, bytes unknown
+    };
+
+    explicit ThumbCacheManager(const QString& cacheDir, QObject* parent = nullptr);
+    ~ThumbCacheManager() override; //wait for maintenance, save index
+
+    //thread-safe: valid entry for source file, counts hit/miss and refreshes LRU
+    bool lookup(const QString& sourcePath, Entry* out);
+    //thread-safe: placeholder of the source file from the index only, no disk access
+    //it may be of an older version of the file, the thumbnail job replaces it then
+    QString placeholder(const QString& sourcePath) const;
+    //thread-safe: register a generated thumbnail and its levels
+    void record(const QString& sourcePath, const QString& topPath, const QString& placeholder);
+    //thread-safe: source files renamed (old, new path), their thumbnails are kept under the new paths
+    void rename(const QVector<QPair<QString, QString>>& moves);
+
+    //queue background maintenance: orphan sweep, then quota enforcement
+    Q_INVOKABLE void cleanUp();
+
+    //synchronous removal of the whole cache, used by "Clear cache and quit"
+    bool clearNow();
+
+    qint64 totalBytes() const;
+    int entryCount() const;
+    double hitRate() const;
+    qint64 hits() const { return m_hits.load(); }
+    qint64 misses() const { return m_misses.load(); }
+    qint64 evictions() const { return m_evictions.load(); }
+
+    qint64 quotaBytes() const { return m_quotaBytes.load(); }
+    void setQuotaBytes(qint64 bytes);
+
+signals:
+    void statsChanged();
+    void quotaBytesChanged();
+
+private:
+    //maintenance jobs, only run in m_maintenance
+    void sweepOrphans(); //remove entries of deleted sources and unindexed files
+    void enforceQuota(); //LRU eviction down to low watermark
+    void readIndex(); //constructor: read index.dat, entries stay unchecked
+    void reconcileIndex(); //background: check unchecked entries on disk, count their bytes
+    void saveIndex() const;
+    void scheduleStatsNotify(); //thread-safe, coalesced statsChanged on GUI thread
+    void queueEviction(); //thread-safe, at most one queued eviction
+    bool ownsFile(const QString& path) const; //true if path is inside cache dir
+    static void removeFiles(const QStringList& files);
+
+    const QString m_cacheDir;
+    const QString m_indexPath;
+
+    mutable QMutex m_mutex; //guards m_entries and m_totalBytes
+    QHash<QString, Entry> m_entries; //source path -> entry
+    qint64 m_totalBytes = 0;
+
+    std::atomic<qint64> m_hits{ 0 };
+    std::atomic<qint64> m_misses{ 0 };
+    std::atomic<qint64> m_evictions{ 0 };
+    std::atomic<qint64> m_quotaBytes;
+    std::atomic<bool> m_evictionQueued{ false };
+
+    QThreadPool m_maintenance; //single thread, maintenance jobs run in order
+    QTimer m_notifyTimer; //GUI thread, coalesces statsChanged
+};
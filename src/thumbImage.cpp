@@ -2,6 +2,13 @@
 #include <qstandardpaths.h>
 #include <qDebug>
 #include <QCryptographicHash>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <iterator>
+
+#include "areaScaler.h"
+#include "trace.h"
 
 //----工具函数：SHA256 Hash文件名生成————
 //Tool function: SHA256 safe hash name generator to avoid hash collision
@@ -13,15 +20,43 @@ QString hashFileName(const QString& filePath)
 }
 
 
+QString thumbCacheDir()
+{
+    return QCoreApplication::applicationDirPath() + "/cache/zviewer_thumbs";
+}
+
+bool scalesWhileDecoding(const QImageReader& reader)
+{
+    return reader.format() == "jpeg";
+}
+
+//Tool function: decode with aspect preserving fit into bound
+//only the JPEG decoder is asked for the final size, it scales the DCT while decoding.
+//PNG and WebP handlers accept ScaledSize as well, but decode in full and run
+//QImage::scaled afterwards, so they and everything else (TIFF...) are decoded in
+//full here and reduced by AreaScaler, which is much cheaper on large inputs.
+QImage readThumbImage(QImageReader& reader, const QSize& bound)
+{
+    ZV_TRACE_SCOPE("thumb.decode");
+    if (bound.isValid() && scalesWhileDecoding(reader)) {
+        const QSize fit = AreaScaler::fitSize(reader.size(), bound);
+        if (fit.isValid() && !fit.isEmpty())
+            reader.setScaledSize(fit);
+    }
+
+    QImage img = reader.read();
+    if (img.isNull() || !bound.isValid())
+        return img;
+    return AreaScaler::downscale(img, bound); //no-op when decoder already scaled
+}
+
 //Use Qt API to load thumbnails (fallback solution)
 QString QtThumbProvider::makeThumbnail(const QString &filePath, const QSize &targetSize, const QString &cacheDir)
 {
     QString result;
     QImageReader reader(filePath);
-    if (targetSize.isValid())
-        reader.setScaledSize(targetSize);
 
-    QImage img = reader.read();
+    QImage img = readThumbImage(reader, targetSize);
     if (img.isNull()) {
         return QString();
     }
@@ -48,9 +83,72 @@ QString QtThumbProvider::makeThumbnail(const QString &filePath, const QSize &tar
         QString::number(qHash(filePath)) + ".jpg";
     result = dir.filePath(thumbFileName);//make result path
 
+    ZV_TRACE_SCOPE("thumb.encode");
     if (!img.save(result, "JPG")) { //save image to result path, if failed, return null
         qWarning() << "QtThumbProvider: saving thumbnail failed!" << result;
         return QString();
     }
     return result;
 }
+
+//Thumbnail levels
+namespace ThumbLevels {
+
+int nearest(int requestedEdge)
+{
+    for (int edge : Edges) {
+        if (edge >= requestedEdge)
+            return edge;
+    }
+    return TopEdge;
+}
+
+QString levelPath(const QString& topPath, int edge)
+{
+    if (topPath.isEmpty() || edge >= TopEdge)
+        return topPath;
+    //top base name is already a unique hash for every provider
+    const QString base = QFileInfo(topPath).completeBaseName();
+    return QDir(thumbCacheDir()).filePath(base + "_" + QString::number(edge) + ".png");
+}
+
+bool writeLevels(const QImage& top, const QString& topPath, const QString& sourcePath)
+{
+    ZV_TRACE_SCOPE("thumb.levels");
+    if (top.isNull() || topPath.isEmpty())
+        return false;
+
+    QDir dir(thumbCacheDir());
+    if (!dir.exists() && !dir.mkpath("."))
+        return false;
+
+    //cascade from large to small, each written level reduced from the last one reduced
+    const QDateTime sourceModified = sourcePath.isEmpty() ? QDateTime() : QFileInfo(sourcePath).lastModified();
+    bool ok = true;
+    QImage current = top;
+    for (int i = int(std::size(Edges)) - 1; i >= 0; --i) {
+        const int edge = Edges[i];
+        if (edge >= TopEdge)
+            continue;
+        const QFileInfo level(levelPath(topPath, edge));
+        if (sourceModified.isValid() && level.exists() && level.lastModified() >= sourceModified)
+            continue; //still current, the next level is reduced from the larger image instead
+        current = AreaScaler::downscale(current, QSize(edge, edge));
+        if (!current.save(level.filePath(), "PNG")) {
+            qWarning() << "ThumbLevels: saving level failed" << edge << topPath;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+QString toUrl(const QString& topPath, int version)
+{
+    if (topPath.isEmpty())
+        return {};
+    return QStringLiteral("image://thumb/%1/%2")
+        .arg(version)
+        .arg(QString::fromLatin1(topPath.toUtf8().toHex()));
+}
+
+}
@@ -46,3 +46,40 @@ public:
 };
 
 QString hashFileName(const QString& filePath);
+
+//application thumbnail cache: for portable version, put under path of the executable
+QString thumbCacheDir();
+
+//true if the reader's decoder scales while decoding (JPEG DCT scaling)
+//others report ScaledSize too but decode in full and scale afterwards (PNG, WebP)
+bool scalesWhileDecoding(const QImageReader& reader);
+
+//decode image from reader, aspect preserving fit into bound (never upscale)
+QImage readThumbImage(QImageReader& reader, const QSize& bound);
+
+/*Multi-resolution thumbnail levels (mip-style, long edge in pixels).
+The platform provider renders the top level once, lower levels are reduced
+from that single image and stored next to each other in thumbCacheDir() as
+<top base name>_<edge>.png. QML asks for a level through ThumbImageProvider
+by setting sourceSize, so small tiles never upload large textures.
+*/
+namespace ThumbLevels {
+
+inline constexpr int Edges[] = { 96, 192, 384 }; //ascending
+inline constexpr int TopEdge = 384;
+
+//smallest level covering requested long edge, top level if none
+int nearest(int requestedEdge);
+
+//cache path of a level, top level is the provider output itself
+QString levelPath(const QString& topPath, int edge);
+
+//reduce top image into the lower levels and save them, return false if any write fails
+//levels already on disk and newer than the source file (if given) are kept as they are
+bool writeLevels(const QImage& top, const QString& topPath, const QString& sourcePath = QString());
+
+//QML url of a thumbnail, served by ThumbImageProvider ("image://thumb/<version>/<hex of top path>"), empty if no thumbnail
+//version is only there to invalidate QML pixmap cache when a thumbnail is regenerated
+QString toUrl(const QString& topPath, int version);
+
+}
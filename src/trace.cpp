@@ -0,0 +1,149 @@
+#include "trace.h"
+
+#ifdef ZVIEWER_TRACING
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QSaveFile>
+#include <QThread>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+std::atomic<bool> g_enabled{ !qEnvironmentVariableIsEmpty("ZVIEWER_TRACE") };
+
+namespace {
+
+struct Event {
+    const char* name;
+    qint64 startNs;
+    qint64 durNs;
+};
+
+//written by its thread only, read by the dump
+struct ThreadBuffer {
+    static constexpr quint64 kCapacity = 1 << 16;
+    std::unique_ptr<Event[]> events{ new Event[kCapacity] };
+    std::atomic<quint64> written{ 0 };
+    int tid = 0;
+    QByteArray threadName;
+};
+
+//buffers outlive their threads, spans of finished pool threads are still dumped
+std::mutex g_buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+
+const std::chrono::steady_clock::time_point g_origin = std::chrono::steady_clock::now();
+
+ThreadBuffer* threadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer)
+        return buffer;
+
+    auto b = std::make_unique<ThreadBuffer>();
+    QThread* thread = QThread::currentThread();
+    const bool isMain = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+    b->threadName = isMain ? QByteArray("main") : thread->objectName().toUtf8();
+
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    b->tid = int(g_buffers.size()) + 1;
+    if (b->threadName.isEmpty())
+        b->threadName = "worker " + QByteArray::number(b->tid);
+    buffer = b.get();
+    g_buffers.push_back(std::move(b));
+    return buffer;
+}
+
+//names are literals from our own code, only quotes and backslashes need care
+void appendString(QByteArray& out, const char* s)
+{
+    out += '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\')
+            out += '\\';
+        out += *s;
+    }
+    out += '"';
+}
+
+}
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_origin).count();
+}
+
+void record(const char* name, qint64 startNs, qint64 endNs)
+{
+    ThreadBuffer* b = threadBuffer();
+    const quint64 n = b->written.load(std::memory_order_relaxed);
+    b->events[n % ThreadBuffer::kCapacity] = { name, startNs, endNs - startNs };
+    b->written.store(n + 1, std::memory_order_release); //event complete before it is counted
+}
+
+bool writeChromeTrace(const QString& path)
+{
+    QByteArray out;
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&] {
+        if (!first)
+            out += ",\n";
+        first = false;
+    };
+
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    qint64 spans = 0;
+    for (const auto& b : g_buffers) {
+        separator();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + QByteArray::number(b->tid)
+            + ",\"args\":{\"name\":";
+        appendString(out, b->threadName.constData());
+        out += "}}";
+
+        //spans still being written by a running thread may be torn, the oldest are overwritten
+        const quint64 n = b->written.load(std::memory_order_acquire);
+        const quint64 begin = n > ThreadBuffer::kCapacity ? n - ThreadBuffer::kCapacity : 0;
+        for (quint64 i = begin; i < n; ++i) {
+            const Event& e = b->events[i % ThreadBuffer::kCapacity];
+            const char* dot = std::strchr(e.name, '.');
+            separator();
+            out += "{\"name\":";
+            appendString(out, e.name);
+            out += ",\"cat\":\"" + QByteArray(e.name, dot ? int(dot - e.name) : int(std::strlen(e.name)))
+                + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(b->tid)
+                + ",\"ts\":" + QByteArray::number(e.startNs / 1000.0, 'f', 3)
+                + ",\"dur\":" + QByteArray::number(e.durNs / 1000.0, 'f', 3) + "}";
+            ++spans;
+        }
+    }
+    out += "\n]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        qWarning() << "Trace: cannot write" << path;
+        return false;
+    }
+    qInfo().noquote() << "Trace:" << spans << "spans written to" << path;
+    return true;
+}
+
+bool writeRequested()
+{
+    const QString path = qEnvironmentVariable("ZVIEWER_TRACE");
+    return !path.isEmpty() && writeChromeTrace(path);
+}
+
+}
+
+#endif // ZVIEWER_TRACING
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+/*
+This file contains the scoped trace spans of the import and thumbnail paths.
+
+ZV_TRACE_SCOPE("stage") records the time from the macro to the end of the
+enclosing scope. Spans go into a ring buffer of the calling thread (the last
+65536 spans of every thread are kept), so recording takes no lock and never
+allocates after the first span of a thread.
+
+Tracing is compiled in only with the CMake option ZVIEWER_TRACING; without it
+the macro expands to nothing and the functions below are empty inline stubs.
+In a tracing build, spans are recorded when environment variable
+ZVIEWER_TRACE is set to a file name, and writeRequested() (called when the
+app or zviewer_cli exits) writes them there in Chrome trace event JSON, which
+opens in Perfetto (ui.perfetto.dev) and chrome://tracing.
+
+Span names are "<category>.<stage>", e.g. "exiftool.run"; the category is the
+part before the dot. Names must be string literals, only the pointer is kept.
+*/
+
+namespace Trace {
+
+#ifdef ZVIEWER_TRACING
+
+extern std::atomic<bool> g_enabled;
+
+inline bool isEnabled() { return g_enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool enabled);
+
+qint64 nowNs(); //monotonic
+void record(const char* name, qint64 startNs, qint64 endNs);
+
+//write all buffered spans in Chrome trace event JSON, false if the file cannot be written
+bool writeChromeTrace(const QString& path);
+
+//write to the file of ZVIEWER_TRACE if set, false if nothing was written
+bool writeRequested();
+
+class Scope
+{
+public:
+    explicit Scope(const char* name) : m_name(name), m_startNs(isEnabled() ? nowNs() : -1) {}
+    ~Scope()
+    {
+        if (m_startNs >= 0)
+            record(m_name, m_startNs, nowNs());
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_name;
+    qint64 m_startNs;
+};
+
+#else
+
+inline bool isEnabled() { return false; }
+inline void setEnabled(bool) {}
+inline bool writeChromeTrace(const QString&) { return false; }
+inline bool writeRequested() { return false; }
+
+#endif
+
+}
+
+#ifdef ZVIEWER_TRACING
+#define ZV_TRACE_CONCAT_(a, b) a##b
+#define ZV_TRACE_CONCAT(a, b) ZV_TRACE_CONCAT_(a, b)
+#define ZV_TRACE_SCOPE(name) const Trace::Scope ZV_TRACE_CONCAT(zvTraceScope_, __LINE__)(name)
+#else
+#define ZV_TRACE_SCOPE(name) ((void)0)
+#endif
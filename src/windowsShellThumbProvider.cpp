@@ -1,6 +1,7 @@
 #ifdef _WIN32
 
 #include "windowsShellThumbProvider.h"
+#include "trace.h"
 
 #include <windows.h>
 #include <shobjidl.h>   // IShellItem, IShellItemImageFactory
@@ -153,7 +154,10 @@ QString WindowsShellThumbProvider::makeThumbnail(const QString &filePath,
     //  - SIIGBF_ICONONLY         : 某些非图片类型返回图标
     SIIGBF flags = SIIGBF_RESIZETOFIT | SIIGBF_BIGGERSIZEOK;
 
-    hr = factory->GetImage(size, flags, &hBmp);
+    {
+        ZV_TRACE_SCOPE("thumb.shellImage");
+        hr = factory->GetImage(size, flags, &hBmp);
+    }
     factory->Release();
 
     if (FAILED(hr) || !hBmp) { //in either case hBmp would not exist
@@ -193,6 +197,7 @@ QString WindowsShellThumbProvider::makeThumbnail(const QString &filePath,
     const QString thumbFileName = hashFileName(filePath) + ".png";
     result = dir.filePath(thumbFileName);
 
+    ZV_TRACE_SCOPE("thumb.encode");
     if (!img.save(result, "PNG")) { //save cache file, if fail, return null. 
         qWarning() << "WindowsShellThumbProvider: save thumbnail failed" << result;
         return QString();